@@ -0,0 +1,26 @@
+#include "host_server.h"
+#include "tcp_server.h"
+#include "tcp_data_handle.h"
+#include "power.h"
+#include "mailbox.h"
+#include "recorder.h"
+
+#include "esp_log.h"
+
+namespace HostServer {
+
+static const char TAG[] = "host_server";
+
+int start(uint16_t port) {
+    if (Power::init() < 0 || TcpServer::init(port) < 0 || TcpDataHandle::init() < 0
+        || Mailbox::init() < 0 || Recorder::init() < 0) {
+        ESP_LOGE(TAG, "server init failed");
+        return -1;
+    }
+    TcpServer::registerRecvCallback(TcpDataHandle::response);
+    TcpServer::registerCloseCallback(TcpDataHandle::disconnect);
+    TcpServer::registerRejectCallback(TcpDataHandle::rejectFrame);
+    return 0;
+}
+
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace HostServer {
+
+// 按app_main()的顺序启动服务器各模块(没有WiFi, GUI与TF卡), 每个进程只能调用一次
+int start(uint16_t port);
+
+}
@@ -0,0 +1,323 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+
+#include <pthread.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * 任务: 每个任务一个分离的pthread, 控制块在任务删除后不回收(主机上任务数有限).
+ * 任务通知, 挂起与删除都通过控制块内的条件变量实现.
+ */
+struct tskTaskControlBlock {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notify_value = 0;
+    eTaskState state = eReady;
+    bool delete_requested = false;
+    TaskFunction_t fn = nullptr;
+    void* arg = nullptr;
+    std::string name;
+};
+
+static thread_local TaskHandle_t _current = nullptr;
+
+using Clock = std::chrono::steady_clock;
+static const Clock::time_point _boot = Clock::now();
+
+static Clock::time_point deadline_after(TickType_t ticks) {
+    return Clock::now() + std::chrono::milliseconds(pdTICKS_TO_MS(ticks));
+}
+
+static void* task_entry(void* param) {
+    TaskHandle_t task = (TaskHandle_t)param;
+    _current = task;
+    pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+    task->state = eRunning;
+    task->fn(task->arg);
+    // FreeRTOS任务函数不应返回, 按删除自身处理
+    vTaskDelete(nullptr);
+    return nullptr;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* arg,
+                       UBaseType_t priority, TaskHandle_t* out) {
+    TaskHandle_t task = new tskTaskControlBlock;
+    task->fn = fn;
+    task->arg = arg;
+    task->name = name != nullptr ? name : "";
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, task_entry, task) != 0) {
+        delete task;
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (out != nullptr) *out = task;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* arg,
+                               UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb) {
+    TaskHandle_t task = nullptr;
+    xTaskCreate(fn, name, stack_depth, arg, priority, &task);
+    return task;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    // 非本shim创建的线程(如main)首次调用时补建控制块
+    if (_current == nullptr) {
+        _current = new tskTaskControlBlock;
+        _current->state = eRunning;
+        _current->name = "main";
+    }
+    return _current;
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    // 只支持挂起自身, 挂起期间可被vTaskDelete()结束
+    assert(task == nullptr || task == xTaskGetCurrentTaskHandle());
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> guard(self->lock);
+    self->state = eSuspended;
+    self->cv.notify_all();
+    self->cv.wait(guard, [self] { return self->delete_requested; });
+    self->state = eDeleted;
+    guard.unlock();
+    pthread_exit(nullptr);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (task == nullptr || task == self) {
+        std::lock_guard<std::mutex> guard(self->lock);
+        self->state = eDeleted;
+    } else {
+        std::lock_guard<std::mutex> guard(task->lock);
+        assert(task->state == eSuspended || task->state == eDeleted);
+        task->delete_requested = true;
+        task->cv.notify_all();
+        return;
+    }
+    pthread_exit(nullptr);
+}
+
+eTaskState eTaskGetState(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    return task->state;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)pdMS_TO_TICKS(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _boot).count());
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notify_value++;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> guard(self->lock);
+    auto ready = [self] { return self->notify_value > 0; };
+    if (ticks == portMAX_DELAY) {
+        self->cv.wait(guard, ready);
+    } else if (!self->cv.wait_until(guard, deadline_after(ticks), ready)) {
+        return 0;
+    }
+    uint32_t value = self->notify_value;
+    self->notify_value = clear ? 0 : value - 1;
+    return value;
+}
+
+/*
+ * 队列: 定长环形缓冲, 收发均可带超时. 元素长度为0时即计数信号量.
+ */
+struct QueueDefinition {
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::vector<uint8_t> items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head = 0;
+    UBaseType_t count = 0;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    if (length == 0) return nullptr;
+    QueueHandle_t queue = new QueueDefinition;
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->items.resize((size_t)length * item_size);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+template <typename Pred>
+static bool wait_for(std::condition_variable& cv, std::unique_lock<std::mutex>& guard, TickType_t ticks, Pred pred) {
+    if (ticks == 0) return pred();
+    if (ticks == portMAX_DELAY) {
+        cv.wait(guard, pred);
+        return true;
+    }
+    return cv.wait_until(guard, deadline_after(ticks), pred);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!wait_for(queue->not_full, guard, ticks, [queue] { return queue->count < queue->length; })) {
+        return pdFALSE;
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    if (queue->item_size > 0) {
+        memcpy(&queue->items[(size_t)tail * queue->item_size], item, queue->item_size);
+    }
+    queue->count++;
+    queue->not_empty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!wait_for(queue->not_empty, guard, ticks, [queue] { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+    if (queue->item_size > 0) {
+        memcpy(item, &queue->items[(size_t)queue->head * queue->item_size], queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->not_full.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    // 不支持优先级继承与递归, 主机上不需要
+    SemaphoreHandle_t sem = xSemaphoreCreateBinary();
+    if (sem != nullptr) xSemaphoreGive(sem);
+    return sem;
+}
+
+/*
+ * 软件定时器: 一个服务线程按到期时刻轮询全部定时器, 回调在服务线程中执行
+ */
+struct tmrTimerControl {
+    std::string name;
+    TickType_t period;
+    bool auto_reload;
+    void* id;
+    TimerCallbackFunction_t callback;
+    bool active = false;
+    Clock::time_point expiry;
+};
+
+// 服务线程在进程退出时仍在运行, 这些对象不析构
+static std::mutex& _timer_lock = *new std::mutex;
+static std::condition_variable& _timer_cv = *new std::condition_variable;
+static std::vector<TimerHandle_t>& _timers = *new std::vector<TimerHandle_t>;
+
+static void timer_service(void* arg) {
+    std::unique_lock<std::mutex> guard(_timer_lock);
+    while (1) {
+        Clock::time_point now = Clock::now();
+        Clock::time_point next = now + std::chrono::hours(1);
+        TimerHandle_t due = nullptr;
+        for (TimerHandle_t timer : _timers) {
+            if (!timer->active) continue;
+            if (timer->expiry <= now) {
+                due = timer;
+                break;
+            }
+            if (timer->expiry < next) next = timer->expiry;
+        }
+        if (due == nullptr) {
+            _timer_cv.wait_until(guard, next);
+            continue;
+        }
+        if (due->auto_reload) {
+            due->expiry += std::chrono::milliseconds(pdTICKS_TO_MS(due->period));
+        } else {
+            due->active = false;
+        }
+        guard.unlock();
+        due->callback(due);
+        guard.lock();
+    }
+}
+
+TimerHandle_t xTimerCreate(const char* name, TickType_t period, UBaseType_t auto_reload, void* id,
+                           TimerCallbackFunction_t callback) {
+    static std::once_flag service_started;
+    std::call_once(service_started, [] { xTaskCreate(timer_service, "Tmr Svc", 0, nullptr, 1, nullptr); });
+    if (period == 0) return nullptr;
+    TimerHandle_t timer = new tmrTimerControl;
+    timer->name = name != nullptr ? name : "";
+    timer->period = period;
+    timer->auto_reload = auto_reload;
+    timer->id = id;
+    timer->callback = callback;
+    std::lock_guard<std::mutex> guard(_timer_lock);
+    _timers.push_back(timer);
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks) {
+    std::lock_guard<std::mutex> guard(_timer_lock);
+    timer->active = true;
+    timer->expiry = Clock::now() + std::chrono::milliseconds(pdTICKS_TO_MS(timer->period));
+    _timer_cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks) {
+    return xTimerStart(timer, ticks);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks) {
+    std::lock_guard<std::mutex> guard(_timer_lock);
+    timer->active = false;
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks) {
+    {
+        std::lock_guard<std::mutex> guard(_timer_lock);
+        timer->period = period;
+    }
+    return xTimerStart(timer, ticks);
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer) {
+    return timer->id;
+}
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - _boot).count();
+}
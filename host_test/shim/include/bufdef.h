@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+using OBuf = std::basic_string<uint8_t>;
+using IBuf = std::basic_string_view<uint8_t>;
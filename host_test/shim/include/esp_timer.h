@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// 自进程启动起的单调时间(us)
+int64_t esp_timer_get_time(void);
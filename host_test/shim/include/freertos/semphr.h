@@ -0,0 +1,13 @@
+#pragma once
+
+#include "queue.h"
+
+/* 与FreeRTOS相同, 信号量是元素长度为0的队列 */
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+
+#define xSemaphoreTake(sem, ticks)      xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)             xQueueSend(sem, NULL, 0)
+#define vSemaphoreDelete(sem)           vQueueDelete(sem)
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace Wrapper {
+
+/**
+ * 只读JSON对象, 支持对象, 数组, 字符串, 数值与字面量.
+ * 访问不存在的键或越界下标时返回无效对象, 其is*()均为false.
+*/
+class JsonObject {
+public:
+    JsonObject() = default;
+    explicit JsonObject(const std::string& text);
+
+    bool isObject() const;
+    bool isArray() const;
+    bool isString() const;
+    int getArraySize() const;
+    std::string getString() const;
+    JsonObject operator[](const char* key) const;
+    JsonObject operator[](int index) const;
+
+    struct Node;
+
+private:
+    explicit JsonObject(std::shared_ptr<const Node> node) : _node(std::move(node)) {}
+    std::shared_ptr<const Node> _node;
+};
+
+}
@@ -0,0 +1,14 @@
+/*
+ * 主机(linux)构建使用的配置, 只包含main中用到的项.
+ * 套接字数默认与设备的sdkconfig一致, 使TCP_MAX_CLIENTS等派生容量相同;
+ * 多客户端负载测试在编译选项中定义更大的值.
+ */
+#pragma once
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+#ifndef CONFIG_LWIP_MAX_SOCKETS
+#define CONFIG_LWIP_MAX_SOCKETS 16
+#endif
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
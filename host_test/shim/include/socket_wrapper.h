@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include "bufdef.h"
+
+namespace Wrapper {
+namespace Socket {
+
+/* 只提供接收任务用到的部分 */
+class Socket {
+public:
+    explicit Socket(int fd) : _fd(fd) {}
+    int fd() const { return _fd; }
+    int recv(void* buf, size_t len) { return ::recv(_fd, buf, len, 0); }
+
+private:
+    int _fd;
+};
+
+}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include "bufdef.h"
+
+namespace Wrapper {
+namespace Utility {
+
+constexpr uint32_t BKDR_hash(const char* str) {
+    uint32_t hash = 0;
+    while (*str) {
+        hash = hash * 131 + (uint8_t)*str++;
+    }
+    return hash & 0x7FFFFFFF;
+}
+
+}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace Wrapper {
+namespace WiFi {
+
+enum class State {
+    DISCONNECTED,
+    CONNECTING,
+    CONNECTED,
+};
+
+namespace Apsta {
+// 主机上没有STA接口: 模拟一次关联所需的时间后返回CONNECTED
+State provision(const char* ssid, const char* password);
+}
+
+}
+}
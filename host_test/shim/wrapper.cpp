@@ -0,0 +1,203 @@
+#include "wifi_wrapper.h"
+#include "json_wrapper.h"
+#include "tf_card.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+namespace Wrapper {
+
+namespace WiFi {
+namespace Apsta {
+
+// 设备上连接路由器通常需要一到数秒, 期间调用者被阻塞
+constexpr int PROVISION_MS = 1000;
+
+State provision(const char* ssid, const char* password) {
+    vTaskDelay(pdMS_TO_TICKS(PROVISION_MS));
+    return ssid[0] != '\0' ? State::CONNECTED : State::DISCONNECTED;
+}
+
+}
+}
+
+struct JsonObject::Node {
+    enum Type { OBJECT, ARRAY, STRING, OTHER } type;
+    std::string text;
+    std::map<std::string, std::shared_ptr<const Node>> members;
+    std::vector<std::shared_ptr<const Node>> items;
+};
+
+/* 递归下降解析, 出错时返回空指针 */
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : _p(text.c_str()), _end(text.c_str() + text.size()) {}
+
+    std::shared_ptr<const JsonObject::Node> document() {
+        auto node = value(0);
+        skip();
+        return _p == _end ? node : nullptr;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 32;
+    using Node = JsonObject::Node;
+
+    void skip() {
+        while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\r' || *_p == '\n')) _p++;
+    }
+
+    bool string(std::string& out) {
+        if (_p >= _end || *_p != '"') return false;
+        for (_p++; _p < _end && *_p != '"'; _p++) {
+            if (*_p != '\\') {
+                out += *_p;
+                continue;
+            }
+            if (++_p >= _end) return false;
+            switch (*_p) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                // 只解码单字节范围, 其余原样保留
+                if (_end - _p < 5) return false;
+                unsigned code = strtoul(std::string(_p + 1, 4).c_str(), nullptr, 16);
+                if (code < 0x80) {
+                    out += (char)code;
+                } else {
+                    out.append(_p - 1, 6);
+                }
+                _p += 4;
+                break;
+            }
+            default: out += *_p; break;
+            }
+        }
+        if (_p >= _end) return false;
+        _p++;
+        return true;
+    }
+
+    std::shared_ptr<const Node> value(int depth) {
+        skip();
+        if (_p >= _end || depth > MAX_DEPTH) return nullptr;
+        auto node = std::make_shared<Node>();
+        if (*_p == '{') {
+            node->type = Node::OBJECT;
+            _p++;
+            skip();
+            if (_p < _end && *_p == '}') {
+                _p++;
+                return node;
+            }
+            while (1) {
+                std::string key;
+                skip();
+                if (!string(key)) return nullptr;
+                skip();
+                if (_p >= _end || *_p++ != ':') return nullptr;
+                auto member = value(depth + 1);
+                if (member == nullptr) return nullptr;
+                node->members[key] = member;
+                skip();
+                if (_p < _end && *_p == ',') {
+                    _p++;
+                    continue;
+                }
+                if (_p < _end && *_p == '}') {
+                    _p++;
+                    return node;
+                }
+                return nullptr;
+            }
+        }
+        if (*_p == '[') {
+            node->type = Node::ARRAY;
+            _p++;
+            skip();
+            if (_p < _end && *_p == ']') {
+                _p++;
+                return node;
+            }
+            while (1) {
+                auto item = value(depth + 1);
+                if (item == nullptr) return nullptr;
+                node->items.push_back(item);
+                skip();
+                if (_p < _end && *_p == ',') {
+                    _p++;
+                    continue;
+                }
+                if (_p < _end && *_p == ']') {
+                    _p++;
+                    return node;
+                }
+                return nullptr;
+            }
+        }
+        if (*_p == '"') {
+            node->type = Node::STRING;
+            return string(node->text) ? node : nullptr;
+        }
+        // 数值与true/false/null只保留原文
+        node->type = Node::OTHER;
+        const char* start = _p;
+        while (_p < _end && strchr(",]} \t\r\n", *_p) == nullptr) _p++;
+        if (_p == start) return nullptr;
+        node->text.assign(start, _p - start);
+        return node;
+    }
+
+    const char* _p;
+    const char* _end;
+};
+
+JsonObject::JsonObject(const std::string& text) : _node(JsonParser(text).document()) {}
+
+bool JsonObject::isObject() const {
+    return _node != nullptr && _node->type == Node::OBJECT;
+}
+
+bool JsonObject::isArray() const {
+    return _node != nullptr && _node->type == Node::ARRAY;
+}
+
+bool JsonObject::isString() const {
+    return _node != nullptr && _node->type == Node::STRING;
+}
+
+int JsonObject::getArraySize() const {
+    return isArray() ? (int)_node->items.size() : 0;
+}
+
+std::string JsonObject::getString() const {
+    return _node != nullptr && _node->type != Node::OBJECT && _node->type != Node::ARRAY ? _node->text : "";
+}
+
+JsonObject JsonObject::operator[](const char* key) const {
+    if (!isObject()) return JsonObject();
+    auto it = _node->members.find(key);
+    return it != _node->members.end() ? JsonObject(it->second) : JsonObject();
+}
+
+JsonObject JsonObject::operator[](int index) const {
+    if (!isArray() || index < 0 || index >= getArraySize()) return JsonObject();
+    return JsonObject(_node->items[index]);
+}
+
+}
+
+/* 主机上没有TF卡, 依赖TF卡的功能按未插卡降级 */
+esp_err_t tf_card_mount() {
+    return ESP_ERR_NOT_FOUND;
+}
+
+bool tf_card_mounted() {
+    return false;
+}
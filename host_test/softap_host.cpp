@@ -0,0 +1,24 @@
+/*
+ * 主机上运行的服务器, 监听本机端口, 供tools/下的压测与回放工具在不烧录设备时使用.
+ * 设备按对端IP末字节分配客户端ID, 客户端可绑定127.0.0.2~127.0.0.239得到不同的ID.
+ *
+ *     softap_host [port] [log level 0~5]
+ */
+#include "host_server.h"
+#include "app_config.h"
+
+#include "esp_log.h"
+#include <cstdlib>
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+    uint16_t port = argc > 1 ? atoi(argv[1]) : AppCfg::SERVER_PORT;
+    esp_log_level_set("*", argc > 2 ? (esp_log_level_t)atoi(argv[2]) : ESP_LOG_INFO);
+    if (HostServer::start(port) < 0) {
+        return 1;
+    }
+    ESP_LOGI("softap_host", "listening on port %u", (unsigned)port);
+    while (1) {
+        pause();
+    }
+}
@@ -0,0 +1,291 @@
+/*
+ * 转发基准: 多个客户端按给定速率与负载长度发送CMD, JSON或BINARY帧,
+ * 统计吞吐, 每帧延迟(p50/p99/p999)与全进程的堆申请次数, 逐帧校验内容与顺序.
+ * 只打印数值不设性能下限, 不在默认ctest中运行, 见README.
+ *
+ * bench_relay [types=cmd,json,binary] [sizes=64,1024] [rate=0] [frames=2000] [clients=4]
+ *   rate为每个发送者每秒帧数, 0表示只受在途窗口限制;
+ *   CMD帧是"mark 名称"命令, 由服务器应答; JSON/BINARY帧转发给另一个客户端
+ */
+#include "harness.h"
+#include "frame_pool.h"
+#include "metrics.h"
+#include "power.h"
+#include "app_config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace Harness;
+using TcpDataHandle::SERVER_ID;
+using Bytes = std::vector<uint8_t>;
+
+static constexpr uint16_t PORT = 19005;
+// 每个发送者在途帧数, 小于发送队列深度, 正常情况下不应丢帧
+static constexpr uint32_t WINDOW = AppCfg::TX_QUEUE_DEPTH / 2;
+static constexpr uint32_t JSON_MIN = 20;            // {"seq":00000000,"d":""}
+static constexpr uint32_t CMD_MIN = 6;              // mark x
+static constexpr uint32_t CMD_MAX = 255;            // 同tcp_data_handle.cpp的CMD_ARGS_SIZE减结束符
+
+/* 统计全进程的malloc次数, 只在计数窗口内累加 */
+static std::atomic<bool> _counting(false);
+static std::atomic<uint32_t> _allocs(0);
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    if (_counting.load(std::memory_order_relaxed)) _allocs++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    if (_counting.load(std::memory_order_relaxed)) _allocs++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (_counting.load(std::memory_order_relaxed)) _allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+struct Config {
+    std::vector<FrameType> types = {FrameType::CMD, FrameType::JSON, FrameType::BINARY};
+    std::vector<uint32_t> sizes = {64, 1024};
+    uint32_t rate = 0;
+    uint32_t frames = 2000;
+    int clients = 4;
+};
+
+static const char* type_name(FrameType type) {
+    switch (type) {
+    case FrameType::CMD: return "cmd";
+    case FrameType::JSON: return "json";
+    default: return "binary";
+    }
+}
+
+static std::vector<std::string> split(const char* list) {
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* p = list; ; p++) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) items.push_back(item);
+            item.clear();
+            if (*p == '\0') break;
+        } else {
+            item += *p;
+        }
+    }
+    return items;
+}
+
+static bool parse_args(int argc, char* argv[], Config& cfg) {
+    for (int i = 1; i < argc; i++) {
+        const char* eq = strchr(argv[i], '=');
+        if (eq == nullptr) return false;
+        std::string key(argv[i], eq - argv[i]);
+        const char* value = eq + 1;
+        if (key == "types") {
+            cfg.types.clear();
+            for (const std::string& name : split(value)) {
+                if (name == "cmd") cfg.types.push_back(FrameType::CMD);
+                else if (name == "json") cfg.types.push_back(FrameType::JSON);
+                else if (name == "binary") cfg.types.push_back(FrameType::BINARY);
+                else return false;
+            }
+        } else if (key == "sizes") {
+            cfg.sizes.clear();
+            for (const std::string& size : split(value)) {
+                cfg.sizes.push_back(strtoul(size.c_str(), nullptr, 10));
+            }
+        } else if (key == "rate") {
+            cfg.rate = strtoul(value, nullptr, 10);
+        } else if (key == "frames") {
+            cfg.frames = strtoul(value, nullptr, 10);
+        } else if (key == "clients") {
+            cfg.clients = atoi(value);
+        } else {
+            return false;
+        }
+    }
+    return !cfg.types.empty() && !cfg.sizes.empty() && cfg.frames > 0
+        && cfg.clients > 0 && 2 * cfg.clients <= AppCfg::TCP_MAX_CLIENTS;
+}
+
+/**
+ * 负载: BINARY前4字节为序号, 其余由序号生成; JSON为{"seq":序号,"d":"填充"};
+ * CMD为"mark 名称", 名称由序号生成, 应答只核对帧类型
+*/
+static void fill(FrameType type, uint8_t* data, uint32_t len, uint32_t seq) {
+    if (type == FrameType::BINARY) {
+        memcpy(data, &seq, sizeof(seq));
+        for (uint32_t i = sizeof(seq); i < len; i++) {
+            data[i] = (uint8_t)(seq * 31 + i);
+        }
+    } else if (type == FrameType::JSON) {
+        char head[24];
+        snprintf(head, sizeof(head), "{\"seq\":%08u,\"d\":\"", (unsigned)seq);
+        memcpy(data, head, 18);
+        for (uint32_t i = 18; i < len - 2; i++) {
+            data[i] = 'a' + (seq + i) % 26;
+        }
+        memcpy(data + len - 2, "\"}", 2);
+    } else {
+        memcpy(data, "mark ", 5);
+        for (uint32_t i = 5; i < len; i++) {
+            data[i] = 'a' + (seq + i) % 26;
+        }
+    }
+}
+
+struct Sender {
+    Client tx, rx;
+    Client* dest;                   // 接收者, CMD时为自己
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    std::vector<int64_t> sent_at;
+};
+
+struct Result {
+    double seconds;
+    std::vector<int64_t> latency;   // 发出到收齐的耗时, us
+    uint32_t allocs;
+    uint32_t drops;
+};
+
+static double percentile(const std::vector<int64_t>& sorted, int per_mille) {
+    return sorted[std::min(sorted.size() - 1, sorted.size() * per_mille / 1000)] / 1000.0;
+}
+
+static void run(const Config& cfg, FrameType type, uint32_t size) {
+    if (type == FrameType::JSON) size = std::max(size, JSON_MIN);
+    if (type == FrameType::CMD) size = std::min(std::max(size, CMD_MIN), CMD_MAX);
+
+    std::vector<std::unique_ptr<Sender>> senders;
+    for (int i = 0; i < cfg.clients; i++) {
+        senders.emplace_back(new Sender);
+        Sender& s = *senders.back();
+        CHECK(s.tx.connect(PORT, 10 + 2 * i));
+        CHECK(!s.tx.command("mark x").empty());
+        if (type == FrameType::CMD) {
+            s.dest = &s.tx;
+        } else {
+            CHECK(s.rx.connect(PORT, 11 + 2 * i));
+            CHECK(!s.rx.command("mark x").empty());
+            s.dest = &s.rx;
+        }
+        s.sent_at.resize(cfg.frames);
+    }
+
+    Result result;
+    result.latency.reserve(cfg.clients * cfg.frames);
+    uint32_t cap = std::max(size, (uint32_t)AppCfg::CMD_REPLY_MAX);
+    Bytes data(size), expect(size), got(cap);
+    FrameHeader header;
+    uint32_t len = 0;
+    uint32_t drops = Metrics::get(Metrics::TX_DROPS);
+    _allocs = 0;
+    _counting = true;
+    int64_t start = now();
+    bool busy = true;
+    while (busy) {
+        busy = false;
+        bool waiting = false;
+        int64_t t = now();
+        for (auto& sender : senders) {
+            Sender& s = *sender;
+            while (s.sent < cfg.frames && s.sent - s.received < WINDOW) {
+                // 限速时第n帧在start + n/rate时刻之后发出, 落后时在窗口内连续补发
+                if (cfg.rate > 0 && t < start + (int64_t)s.sent * 1000000 / cfg.rate) {
+                    waiting = true;
+                    break;
+                }
+                fill(type, data.data(), size, s.sent);
+                s.sent_at[s.sent] = now();
+                uint8_t goal = type == FrameType::CMD ? SERVER_ID : s.rx.id();
+                CHECK(s.tx.send(goal, type, data.data(), size));
+                s.sent++;
+            }
+            if (s.received < s.sent) {
+                CHECK(s.dest->recv(header, got.data(), got.size(), len));
+                result.latency.push_back(now() - s.sent_at[s.received]);
+                if (type == FrameType::CMD) {
+                    CHECK_EQ(header.type, FrameType::CMD);
+                    CHECK(len > 0 && got[0] == '{');
+                } else {
+                    CHECK_EQ(header.type, type);
+                    CHECK_EQ(header.source, s.tx.id());
+                    CHECK_EQ(len, size);
+                    fill(type, expect.data(), size, s.received);
+                    CHECK(memcmp(got.data(), expect.data(), size) == 0);
+                }
+                s.received++;
+            }
+            if (s.received < cfg.frames) busy = true;
+        }
+        if (waiting) usleep(50);
+    }
+    result.seconds = (now() - start) / 1e6;
+    _counting = false;
+    result.allocs = _allocs;
+    result.drops = Metrics::get(Metrics::TX_DROPS) - drops;
+
+    uint32_t total = cfg.clients * cfg.frames;
+    double fps = total / result.seconds;
+    std::sort(result.latency.begin(), result.latency.end());
+    printf("%-6s %4u B x %u", type_name(type), (unsigned)size, (unsigned)total);
+    if (cfg.rate > 0) {
+        printf(" @ %u/s", (unsigned)(cfg.rate * cfg.clients));
+    }
+    printf(": %.0f frames/s, %.2f MB/s, latency p50 %.3f p99 %.3f p999 %.3f max %.3f ms, %.2f allocs/frame\n",
+           fps, fps * size / 1e6, percentile(result.latency, 500), percentile(result.latency, 990),
+           percentile(result.latency, 999), result.latency.back() / 1000.0, (double)result.allocs / total);
+    CHECK_EQ(result.drops, 0);
+}
+
+// 空闲(超过PM_BUSY_HOLD_MS)后的第一帧: 处理耗时被记录且不超过PM_FIRST_FRAME_MAX_US
+static void bench_first_frame(int rounds) {
+    Client a, b;
+    CHECK(a.connect(PORT, 4) && b.connect(PORT, 5));
+    CHECK(!a.command("mark x").empty() && !b.command("mark x").empty());
+
+    FrameHeader header;
+    std::string payload;
+    for (int n = 0; n < rounds; n++) {
+        sleepMs(AppCfg::PM_BUSY_HOLD_MS + 100);
+        CHECK(a.send(b.id(), FrameType::BINARY, "wake"));
+        CHECK(b.recv(header, payload));
+    }
+    Power::Report power;
+    Power::read(power);
+    printf("first frame after idle: max %u us\n", (unsigned)power.first_frame_max_us);
+    CHECK(power.first_frame_max_us > 0);
+    CHECK_EQ(power.first_frame_over, 0);
+}
+
+int main(int argc, char* argv[]) {
+    Config cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        fprintf(stderr, "usage: %s [types=cmd,json,binary] [sizes=64,1024] [rate=0] [frames=2000] [clients=1~%d]\n",
+                argv[0], AppCfg::TCP_MAX_CLIENTS / 2);
+        return 2;
+    }
+    startServer(PORT);
+    for (FrameType type : cfg.types) {
+        for (uint32_t size : cfg.sizes) {
+            run(cfg, type, size);
+        }
+    }
+    bench_first_frame(3);
+    CHECK(waitFor([] { return FramePool::available() == AppCfg::FRAME_POOL_SIZE; }));
+    printf("bench_relay passed\n");
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include "fake_panel.h"
+#include "harness.h"
+#include "lcd_st7735.h"
+#include "app_config.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+
+#include <cstring>
+#include <deque>
+
+struct spi_device_t {
+    spi_device_interface_config_t config;
+};
+
+namespace FakePanel {
+
+constexpr uint8_t CMD_CASET = 0x2A;
+constexpr uint8_t CMD_RASET = 0x2B;
+constexpr uint8_t CMD_RAMWR = 0x2C;
+
+struct InFlight {
+    spi_transaction_t* trans;
+    uint32_t seq;
+    const uint8_t* buf;         // DMA缓冲, 数据在事务内时为nullptr
+    uint32_t len;
+    uint32_t sum;
+};
+
+static spi_device_t _device;
+static std::deque<InFlight> _queued;        // 已入队未发送
+static std::deque<InFlight> _done;          // 已发送未取回
+static uint32_t _seq = 0;
+static uint32_t _max_in_flight = 0;
+static uint32_t _sent_bytes = 0;
+static uint32_t _levels[64];
+
+/* 屏幕状态 */
+static uint16_t _vram[LCD_HEIGHT][LCD_WIDTH];
+static uint8_t _cmd = 0;
+static uint8_t _params[4];
+static uint32_t _param_count = 0;
+static Window _window = {0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1};
+static int _wx = 0, _wy = 0;
+static uint8_t _half[2];
+static uint32_t _half_count = 0;
+static std::vector<Window> _windows;
+
+static uint32_t checksum(const uint8_t* data, uint32_t len) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void panel_command(uint8_t cmd) {
+    _cmd = cmd;
+    _param_count = 0;
+    _half_count = 0;
+    if (cmd == CMD_RAMWR) {
+        _wx = _window.x0;
+        _wy = _window.y0;
+        _windows.push_back(_window);
+    }
+}
+
+static void panel_data(uint8_t byte) {
+    if (_cmd == CMD_CASET || _cmd == CMD_RASET) {
+        if (_param_count < 4) _params[_param_count++] = byte;
+        if (_param_count == 4) {
+            // 与lcd_set_window()的屏幕偏移对应
+            if (_cmd == CMD_CASET) {
+                _window.x0 = _params[1] - 2;
+                _window.x1 = _params[3] - 2;
+            } else {
+                _window.y0 = _params[1] - 3;
+                _window.y1 = _params[3] - 3;
+            }
+        }
+    } else if (_cmd == CMD_RAMWR) {
+        _half[_half_count++] = byte;
+        if (_half_count < 2) return;
+        _half_count = 0;
+        CHECK(_wy <= _window.y1);
+        CHECK(_wx >= 0 && _wx < LCD_WIDTH && _wy >= 0 && _wy < LCD_HEIGHT);
+        memcpy(&_vram[_wy][_wx], _half, 2);
+        if (++_wx > _window.x1) {
+            _wx = _window.x0;
+            _wy++;
+        }
+    }
+}
+
+// 在SPI总线上发出一笔事务
+static void transmit(const InFlight& item) {
+    spi_transaction_t* t = item.trans;
+    if (item.buf != nullptr && checksum(item.buf, item.len) != item.sum) {
+        fprintf(stderr, "transaction %u: DMA buffer %p modified before it was sent\n",
+                (unsigned)item.seq, (const void *)item.buf);
+        exit(1);
+    }
+    if (_device.config.pre_cb != nullptr) {
+        _device.config.pre_cb(t);
+    }
+    int dc = _levels[AppCfg::LCD_PIN_DC];
+    const uint8_t* data = (t->flags & SPI_TRANS_USE_TXDATA) ? t->tx_data : (const uint8_t *)t->tx_buffer;
+    _sent_bytes += t->length / 8;
+    for (uint32_t i = 0; i < t->length / 8; i++) {
+        if (dc == 0) {
+            panel_command(data[i]);
+        } else {
+            panel_data(data[i]);
+        }
+    }
+}
+
+static InFlight describe(spi_transaction_t* t) {
+    InFlight item = {t, _seq++, nullptr, (uint32_t)(t->length / 8), 0};
+    CHECK(t->length % 8 == 0);
+    if (!(t->flags & SPI_TRANS_USE_TXDATA)) {
+        CHECK(t->tx_buffer != nullptr);
+        CHECK(item.len <= (uint32_t)AppCfg::LCD_MAXTRANS_SIZE);
+        item.buf = (const uint8_t *)t->tx_buffer;
+        item.sum = checksum(item.buf, item.len);
+    } else {
+        CHECK(item.len <= 4);
+    }
+    return item;
+}
+
+static bool overlaps(const InFlight& a, const InFlight& b) {
+    if (a.buf == nullptr || b.buf == nullptr) return false;
+    return a.buf < b.buf + b.len && b.buf < a.buf + a.len;
+}
+
+void finish() {
+    while (!_queued.empty()) {
+        transmit(_queued.front());
+        _done.push_back(_queued.front());
+        _queued.pop_front();
+    }
+}
+
+const std::vector<Window>& windows() {
+    return _windows;
+}
+
+void clearWindows() {
+    _windows.clear();
+}
+
+uint16_t pixel(int x, int y) {
+    return _vram[y][x];
+}
+
+uint32_t queued() {
+    return _seq;
+}
+
+uint32_t maxInFlight() {
+    return _max_in_flight;
+}
+
+uint32_t sentBytes() {
+    return _sent_bytes;
+}
+
+}
+
+using namespace FakePanel;
+
+esp_err_t gpio_config(const gpio_config_t* config) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) {
+    CHECK(gpio >= 0 && gpio < 64);
+    _levels[gpio] = level;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio) {
+    return _levels[gpio];
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* config, spi_dma_chan_t dma) {
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* config,
+                             spi_device_handle_t* handle) {
+    _device.config = *config;
+    *handle = &_device;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans, TickType_t ticks) {
+    InFlight item = describe(trans);
+    // 驱动队列满时调用者会一直阻塞(无人取回结果)
+    CHECK(_queued.size() + _done.size() < (size_t)_device.config.queue_size);
+    for (const std::deque<InFlight>* list : {&_queued, &_done}) {
+        for (const InFlight& other : *list) {
+            if (other.trans == trans) {
+                fprintf(stderr, "transaction %u reuses the descriptor of %u before its result was taken\n",
+                        (unsigned)item.seq, (unsigned)other.seq);
+                exit(1);
+            }
+            if (overlaps(item, other)) {
+                fprintf(stderr, "transaction %u reuses DMA buffer %p of %u before its result was taken\n",
+                        (unsigned)item.seq, (const void *)other.buf, (unsigned)other.seq);
+                exit(1);
+            }
+        }
+    }
+    _queued.push_back(item);
+    uint32_t in_flight = _queued.size() + _done.size();
+    if (in_flight > _max_in_flight) _max_in_flight = in_flight;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans, TickType_t ticks) {
+    if (_done.empty()) {
+        // 没有待发送的事务时驱动会永远等待
+        CHECK(!_queued.empty());
+        transmit(_queued.front());
+        _done.push_back(_queued.front());
+        _queued.pop_front();
+    }
+    InFlight item = _done.front();
+    _done.pop_front();
+    if (item.buf != nullptr && checksum(item.buf, item.len) != item.sum) {
+        fprintf(stderr, "transaction %u: DMA buffer %p modified before its result was taken\n",
+                (unsigned)item.seq, (const void *)item.buf);
+        exit(1);
+    }
+    *trans = item.trans;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* trans) {
+    // 阻塞传输取回的会是更早排队的事务
+    CHECK(_queued.empty() && _done.empty());
+    transmit(describe(trans));
+    return ESP_OK;
+}
@@ -0,0 +1,32 @@
+/*
+ * ST7735假屏幕: 实现SPI主机驱动与GPIO替身, 解码CASET/RASET/RAMWR写入显存.
+ *
+ * 排队的事务直到驱动取回结果(或调用finish())时才"发送", 尽量推迟以暴露缓冲区复用:
+ * 每笔事务入队时记下序号与DMA缓冲的校验和, 发送与取回时缓冲内容必须不变,
+ * 未取回结果的缓冲不得再次入队, 阻塞传输不得与排队事务交错. 违反时直接报错退出.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace FakePanel {
+
+struct Window {
+    int x0, y0, x1, y1;         // 含端点
+};
+
+// 发送所有已排队的事务(硬件完成), 结果仍等驱动取回
+void finish();
+// 自上次clearWindows()以来每次RAMWR使用的窗口
+const std::vector<Window>& windows();
+void clearWindows();
+// 显存中的像素, 字节序同帧缓冲
+uint16_t pixel(int x, int y);
+// 已入队的事务数与同时未取回结果的事务数峰值
+uint32_t queued();
+uint32_t maxInFlight();
+// 已在总线上发出的字节数(命令, 参数与像素)
+uint32_t sentBytes();
+
+}
@@ -0,0 +1,133 @@
+#include "harness.h"
+#include "host_server.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Harness {
+
+void startServer(uint16_t port) {
+    esp_log_level_set("*", ESP_LOG_WARN);
+    CHECK(HostServer::start(port) == 0);
+}
+
+int64_t now() {
+    return esp_timer_get_time();
+}
+
+void sleepMs(int ms) {
+    usleep(ms * 1000);
+}
+
+bool Client::connect(uint16_t port, uint8_t id) {
+    close();
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0) return false;
+    int opt = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(0x7F000000 | id);
+    if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close();
+        return false;
+    }
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (::connect(_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close();
+        return false;
+    }
+    _id = id;
+    return true;
+}
+
+void Client::close() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+void Client::shutdownWrite() {
+    shutdown(_fd, SHUT_WR);
+}
+
+bool Client::sendRaw(const void* data, uint32_t len) {
+    const uint8_t* p = (const uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = ::send(_fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool Client::send(uint8_t goal, FrameType type, const void* payload, uint32_t len) {
+    FrameHeader header = {TcpDataHandle::FRAME_HEAD, type, goal, _id, len};
+    return sendRaw(&header, sizeof(header)) && sendRaw(payload, len);
+}
+
+bool Client::recvRaw(void* data, uint32_t len, int timeout_ms) {
+    uint8_t* p = (uint8_t *)data;
+    int64_t deadline = now() + (int64_t)timeout_ms * 1000;
+    while (len > 0) {
+        int left = (int)((deadline - now()) / 1000);
+        struct pollfd pfd = {_fd, POLLIN, 0};
+        if (left < 0 || poll(&pfd, 1, left) <= 0) return false;
+        ssize_t n = ::recv(_fd, p, len, 0);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool Client::recv(FrameHeader& header, uint8_t* buf, uint32_t cap, uint32_t& len, int timeout_ms) {
+    if (!recvRaw(&header, sizeof(header), timeout_ms)) return false;
+    if (header.head != TcpDataHandle::FRAME_HEAD || header.length > cap) return false;
+    len = header.length;
+    return recvRaw(buf, len, timeout_ms);
+}
+
+bool Client::recv(FrameHeader& header, std::string& payload, int timeout_ms) {
+    if (!recvRaw(&header, sizeof(header), timeout_ms)) return false;
+    if (header.head != TcpDataHandle::FRAME_HEAD) return false;
+    payload.resize(header.length);
+    return recvRaw(&payload[0], header.length, timeout_ms);
+}
+
+bool Client::waitClosed(int timeout_ms) {
+    uint8_t buf[1024];
+    int64_t deadline = now() + (int64_t)timeout_ms * 1000;
+    while (1) {
+        int left = (int)((deadline - now()) / 1000);
+        struct pollfd pfd = {_fd, POLLIN, 0};
+        if (left < 0 || poll(&pfd, 1, left) <= 0) return false;
+        ssize_t n = ::recv(_fd, buf, sizeof(buf), 0);
+        if (n == 0 || (n < 0 && errno == ECONNRESET)) return true;
+        if (n < 0) return false;
+    }
+}
+
+std::string Client::command(const std::string& line, int timeout_ms) {
+    FrameHeader header;
+    std::string reply;
+    if (!send(TcpDataHandle::SERVER_ID, FrameType::CMD, line)) return "";
+    if (!recv(header, reply, timeout_ms) || header.type != FrameType::CMD) return "";
+    return reply;
+}
+
+}
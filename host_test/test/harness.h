@@ -0,0 +1,93 @@
+/*
+ * 主机测试的公共部分: 断言宏, 进程内服务器与回环客户端
+ */
+#pragma once
+
+#include "tcp_data_handle.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#define CHECK(cond) do {                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(a, b) do {                                                         \
+        long long a_ = (long long)(a), b_ = (long long)(b);                         \
+        if (a_ != b_) {                                                             \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",       \
+                    __FILE__, __LINE__, #a, #b, a_, b_);                            \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+namespace Harness {
+
+using TcpDataHandle::FrameHeader;
+using TcpDataHandle::FrameType;
+
+// 启动进程内服务器, 日志只输出警告以上; 每个测试程序使用不同端口
+void startServer(uint16_t port);
+
+// 单调时间(us)
+int64_t now();
+// 等待条件成立, 超时返回false
+template <typename Pred>
+bool waitFor(Pred pred, int timeout_ms = 2000);
+void sleepMs(int ms);
+
+/**
+ * 回环客户端: 绑定127.0.0.id后连接, 服务器按IP末字节把它登记为设备id.
+ * 收发都是阻塞的, 接收带超时.
+*/
+class Client {
+public:
+    Client() = default;
+    ~Client() { close(); }
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    bool connect(uint16_t port, uint8_t id);
+    void close();
+    // 关闭写方向(发送FIN), 仍可接收
+    void shutdownWrite();
+    int fd() const { return _fd; }
+    uint8_t id() const { return _id; }
+
+    bool sendRaw(const void* data, uint32_t len);
+    bool send(uint8_t goal, FrameType type, const void* payload, uint32_t len);
+    bool send(uint8_t goal, FrameType type, const std::string& payload) {
+        return send(goal, type, payload.data(), payload.size());
+    }
+    // 接收恰好len字节, 超时或连接关闭返回false
+    bool recvRaw(void* data, uint32_t len, int timeout_ms = 2000);
+    // 接收一帧到buf, 负载长度超过cap或超时返回false
+    bool recv(FrameHeader& header, uint8_t* buf, uint32_t cap, uint32_t& len, int timeout_ms = 2000);
+    bool recv(FrameHeader& header, std::string& payload, int timeout_ms = 2000);
+    // 对端已关闭连接(在timeout_ms内读到EOF或连接重置), 期间收到的数据被丢弃
+    bool waitClosed(int timeout_ms = 2000);
+
+    // 发送文本命令并等待应答, 失败返回空串
+    std::string command(const std::string& line, int timeout_ms = 2000);
+
+private:
+    int _fd = -1;
+    uint8_t _id = 0;
+};
+
+template <typename Pred>
+bool waitFor(Pred pred, int timeout_ms) {
+    int64_t deadline = now() + (int64_t)timeout_ms * 1000;
+    while (!pred()) {
+        if (now() > deadline) return false;
+        sleepMs(1);
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,95 @@
+/*
+ * 连接接入: 客户端满员后新连接进入等待队列, 槽位释放时按到达顺序接入,
+ * 排队期间发出的命令在接入后应答; 等待队列也满时回复原因帧后关闭
+ */
+#include "harness.h"
+#include "app_config.h"
+#include "metrics.h"
+#include "tcp_server.h"
+
+#include <memory>
+
+using namespace Harness;
+
+static constexpr uint16_t PORT = 19009;
+static constexpr int QUEUED_MS = 300;       // 排队连接在此期间不应收到任何数据
+
+static std::unique_ptr<Client> _clients[AppCfg::TCP_MAX_CLIENTS];
+
+// 被拒绝的连接先收到{"status":"failed","reason":...}再被关闭
+static void expect_rejected(Client& client, const char* reason) {
+    FrameHeader header;
+    std::string reply;
+    CHECK(client.recv(header, reply));
+    CHECK_EQ(header.type, FrameType::CMD);
+    CHECK_EQ(header.goal, 0);
+    CHECK(reply.find("\"status\":\"failed\"") != std::string::npos);
+    CHECK(reply.find(std::string("\"reason\":\"") + reason + "\"") != std::string::npos);
+    CHECK(client.waitClosed(2000));
+}
+
+static void test_queue_and_reject() {
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        _clients[i].reset(new Client);
+        CHECK(_clients[i]->connect(PORT, 2 + i));
+        CHECK(!_clients[i]->command("mark x").empty());
+    }
+    CHECK_EQ(TcpServer::clientCount(), AppCfg::TCP_MAX_CLIENTS);
+    uint32_t rejects = Metrics::get(Metrics::REJECTS);
+
+    // 排满等待队列, 排队期间发出的命令留在套接字中
+    int id = 2 + AppCfg::TCP_MAX_CLIENTS;
+    std::unique_ptr<Client> queued[AppCfg::TCP_ACCEPT_QUEUE];
+    for (auto& client : queued) {
+        client.reset(new Client);
+        CHECK(client->connect(PORT, id++));
+        CHECK(client->send(TcpDataHandle::SERVER_ID, FrameType::CMD, "mark x"));
+    }
+
+    // 超出等待队列的连接被拒绝
+    Client extra[3];
+    for (Client& client : extra) {
+        CHECK(client.connect(PORT, id++));
+    }
+    for (Client& client : extra) {
+        expect_rejected(client, "server full");
+    }
+    CHECK_EQ(Metrics::get(Metrics::REJECTS) - rejects, 3);
+
+    FrameHeader header;
+    std::string reply;
+    CHECK(!queued[0]->recv(header, reply, QUEUED_MS));
+    CHECK_EQ(TcpServer::clientCount(), AppCfg::TCP_MAX_CLIENTS);
+
+    // 每释放一个槽位接入最早排队的一个连接, 接入后应答排队期间的命令
+    for (int i = 0; i < AppCfg::TCP_ACCEPT_QUEUE; i++) {
+        _clients[i].reset();
+        CHECK(queued[i]->recv(header, reply));
+        CHECK_EQ(header.type, FrameType::CMD);
+        CHECK(reply.find("\"mark\":") != std::string::npos);
+        CHECK(TcpServer::findSocketById(queued[i]->id()) >= 0);
+        for (int j = i + 1; j < AppCfg::TCP_ACCEPT_QUEUE; j++) {
+            CHECK(!queued[j]->recv(header, reply, QUEUED_MS));
+            CHECK(TcpServer::findSocketById(queued[j]->id()) < 0);
+        }
+    }
+    CHECK_EQ(TcpServer::clientCount(), AppCfg::TCP_MAX_CLIENTS);
+    CHECK_EQ(Metrics::get(Metrics::REJECTS) - rejects, 3);
+
+    // 等待队列空出后又可以排队, 不再拒绝
+    Client late;
+    CHECK(late.connect(PORT, id++));
+    CHECK(late.send(TcpDataHandle::SERVER_ID, FrameType::CMD, "mark x"));
+    CHECK(!late.recv(header, reply, QUEUED_MS));
+    _clients[AppCfg::TCP_ACCEPT_QUEUE].reset();
+    CHECK(late.recv(header, reply));
+    CHECK(reply.find("\"mark\":") != std::string::npos);
+    CHECK_EQ(Metrics::get(Metrics::REJECTS) - rejects, 3);
+}
+
+int main() {
+    startServer(PORT);
+    test_queue_and_reject();
+    printf("test_admission passed\n");
+    return 0;
+}
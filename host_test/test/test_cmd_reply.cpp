@@ -0,0 +1,132 @@
+/*
+ * 命令应答路径: 客户端满员且设备名最长时list/stats不超出应答帧;
+ * 预热后文本与二进制命令, PING与转发全程不申请堆内存
+ */
+#include "harness.h"
+#include "cmds.h"
+#include "app_config.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+using namespace Harness;
+using TcpDataHandle::SERVER_ID;
+
+static constexpr uint16_t PORT = 19004;
+static constexpr int ROUNDS = 200;
+
+/* 统计全进程的malloc次数, 只在计数窗口内累加 */
+static std::atomic<bool> _counting(false);
+static std::atomic<uint32_t> _allocs(0);
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    if (_counting.load(std::memory_order_relaxed)) _allocs++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    if (_counting.load(std::memory_order_relaxed)) _allocs++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (_counting.load(std::memory_order_relaxed)) _allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+static std::unique_ptr<Client> _clients[AppCfg::TCP_MAX_CLIENTS];
+
+// 不申请内存的收发: 发送后等待一帧应答, 应答留在buf中
+static uint8_t _reply[8 + AppCfg::CMD_REPLY_MAX];
+static uint32_t _reply_len;
+
+static bool request(Client& client, FrameType type, const void* payload, uint32_t len, FrameType reply_type) {
+    FrameHeader header;
+    if (!client.send(SERVER_ID, type, payload, len)) return false;
+    if (!client.recv(header, _reply, sizeof(_reply), _reply_len)) return false;
+    return header.type == reply_type;
+}
+
+static bool reply_has(const char* text) {
+    return memmem(_reply, _reply_len, text, strlen(text)) != nullptr;
+}
+
+// 全部客户端登录最长且需转义的设备名
+static void connect_all() {
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        _clients[i].reset(new Client);
+        CHECK(_clients[i]->connect(PORT, 2 + i));
+        char name[32];
+        memset(name, '"', 31);
+        snprintf(name, sizeof(name), "%02d", i);
+        name[2] = '"';
+        uint8_t login[3 + 31] = {cmds::OP_LOGIN, TcpDataHandle::TLV_STR, 31};
+        memcpy(login + 3, name, 31);
+        CHECK(request(*_clients[i], FrameType::BCMD, login, sizeof(login), FrameType::BCMD));
+        CHECK(reply_has("succeed"));
+    }
+    // 控制字符的设备名被拒绝
+    uint8_t bad[] = {cmds::OP_LOGIN, TcpDataHandle::TLV_STR, 3, 'a', '\n', 'b'};
+    CHECK(request(*_clients[0], FrameType::BCMD, bad, sizeof(bad), FrameType::BCMD));
+    CHECK(reply_has("assert failed"));
+}
+
+static void test_reply_size() {
+    Client& client = *_clients[0];
+    CHECK(request(client, FrameType::CMD, "list", 4, FrameType::CMD));
+    CHECK(!reply_has("respond too long"));
+    CHECK_EQ(_reply[_reply_len - 2], ']');
+    printf("list reply %u bytes for %d clients\n", (unsigned)_reply_len, AppCfg::TCP_MAX_CLIENTS);
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        char mark[16];
+        snprintf(mark, sizeof(mark), "\"mark\":%d", 2 + i);
+        CHECK(reply_has(mark));
+    }
+
+    CHECK(request(client, FrameType::CMD, "stats", 5, FrameType::CMD));
+    CHECK(!reply_has("respond too long"));
+    CHECK_EQ(_reply[_reply_len - 2], '}');
+    printf("stats reply %u bytes for %d clients\n", (unsigned)_reply_len, AppCfg::TCP_MAX_CLIENTS);
+}
+
+static void run_commands(int rounds) {
+    static const uint8_t bmark[] = {cmds::OP_MARK, TcpDataHandle::TLV_STR, 2, '0', '1'};
+    static const uint8_t bstats[] = {cmds::OP_STATS};
+    FrameHeader header;
+    for (int n = 0; n < rounds; n++) {
+        Client& a = *_clients[n % AppCfg::TCP_MAX_CLIENTS];
+        Client& b = *_clients[(n + 1) % AppCfg::TCP_MAX_CLIENTS];
+        CHECK(request(a, FrameType::CMD, "mark nobody", 11, FrameType::CMD));
+        CHECK(request(a, FrameType::CMD, "group join 2", 12, FrameType::CMD));
+        CHECK(request(a, FrameType::CMD, "list", 4, FrameType::CMD));
+        CHECK(request(a, FrameType::BCMD, bmark, sizeof(bmark), FrameType::BCMD));
+        CHECK(request(a, FrameType::BCMD, bstats, sizeof(bstats), FrameType::BCMD));
+        CHECK(request(a, FrameType::PING, "ping", 4, FrameType::PONG));
+        CHECK(a.send(b.id(), FrameType::BINARY, "relay", 5));
+        CHECK(b.recv(header, _reply, sizeof(_reply), _reply_len));
+    }
+}
+
+static void test_no_alloc() {
+    run_commands(AppCfg::TCP_MAX_CLIENTS);
+    _allocs = 0;
+    _counting = true;
+    run_commands(ROUNDS);
+    _counting = false;
+    printf("%u allocations in %d command rounds\n", (unsigned)_allocs.load(), ROUNDS);
+    CHECK_EQ(_allocs.load(), 0);
+}
+
+int main() {
+    startServer(PORT);
+    connect_all();
+    test_reply_size();
+    test_no_alloc();
+    printf("test_cmd_reply passed\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * 命令表与JsonWriter: 每个命令名独占一个桶且能按名称找回, 操作码唯一;
+ * 写入器的溢出标志与缓冲内容一致(未溢出时内容完整, 溢出后不越界)
+ */
+#include "harness.h"
+#include "cmds.h"
+#include "cmd_table.h"
+#include "json_writer.h"
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace Harness;
+using cmds::Command;
+using cmds::CommandSet;
+using cmds::JsonWriter;
+
+static std::set<uint8_t> _opcodes;
+static int _commands = 0;
+
+static void check_set(const CommandSet& set, const std::string& path) {
+    std::set<uint32_t> buckets;
+    CHECK(set.count > 0 && set.count <= (1u << set.bits));
+    for (uint16_t i = 0; i < set.count; i++) {
+        const Command& cmd = set.cmds[i];
+        std::string name = path + cmd.name;
+        // 编译期哈希与运行期一致, 桶互不相同且指回本命令
+        CHECK_EQ(cmd.hash, cmds::hash(cmd.name));
+        uint32_t b = cmds::bucket(cmd.hash, set.seed, set.bits);
+        CHECK(b < (1u << set.bits));
+        if (!buckets.insert(b).second) {
+            fprintf(stderr, "'%s' shares bucket %u\n", name.c_str(), (unsigned)b);
+            exit(1);
+        }
+        CHECK_EQ(set.slots[b], i);
+        _commands++;
+
+        if (cmd.sub != nullptr) {
+            CHECK(cmd.handler == nullptr);
+            check_set(*cmd.sub, name + " ");
+        } else {
+            CHECK(cmd.handler != nullptr);
+            if (cmd.opcode != 0) {
+                CHECK(_opcodes.insert(cmd.opcode).second);
+                CHECK(cmd.opcode < cmds::OP_COUNT);
+            }
+        }
+    }
+    // 其余桶为空
+    int used = 0;
+    for (uint32_t b = 0; b < (1u << set.bits); b++) {
+        if (set.slots[b] >= 0) used++;
+    }
+    CHECK_EQ(used, set.count);
+}
+
+static std::string run(std::vector<std::string> words) {
+    std::vector<char*> argv;
+    for (std::string& word : words) argv.push_back(&word[0]);
+    uint8_t buf[256];
+    JsonWriter out(buf, sizeof(buf));
+    cmds::respond(argv.size(), argv.data(), out);
+    return std::string((const char *)buf, out.size());
+}
+
+static void test_table() {
+    check_set(cmds::table(), "");
+    CHECK(_commands > 0);
+    // 每个操作码都有命令
+    CHECK_EQ(_opcodes.size(), cmds::OP_COUNT - 1);
+
+    // 同桶但名称不同的查找失败(哈希相同也要比较名称)
+    CHECK(run({"lisx"}).find("unknown option 'lisx'") == 0);
+    CHECK(run({"group", "joim", "1"}).find("unknown option 'joim'") == 0);
+    CHECK(run({"mark"}).find("'mark' expects 1~1 args, got 0") == 0);
+    CHECK(run({"group", "join", "99"}).find("failed") != std::string::npos);
+    CHECK(cmds::blocking(cmds::OP_WIFI));
+    CHECK(!cmds::blocking(cmds::OP_MARK));
+}
+
+// 写入器的结果: 未溢出时必须与期望完全一致, 溢出时长度不超过容量且不越界
+static void expect(JsonWriter& out, const uint8_t* buf, uint32_t cap, const std::string& full) {
+    CHECK(out.size() <= cap);
+    CHECK_EQ(buf[cap], 0xEE);
+    if (full.size() <= cap) {
+        CHECK(!out.overflow());
+        CHECK(std::string((const char *)buf, out.size()) == full);
+    } else {
+        CHECK(out.overflow());
+    }
+}
+
+template <typename Fill>
+static void each_capacity(const std::string& full, Fill fill) {
+    for (uint32_t cap = 0; cap <= full.size() + 2; cap++) {
+        std::vector<uint8_t> buf(cap + 1, 0xEE);
+        JsonWriter out(buf.data(), cap);
+        fill(out);
+        expect(out, buf.data(), cap, full);
+    }
+}
+
+static void test_writer_overflow() {
+    // 对象, 数组, 转义与数字, 在每种容量下逐字节检查
+    std::string json = "{\"name\":\"a\\\"b\\u0001\",\"list\":[1,-2,3],\"n\":4294967295}";
+    each_capacity(json, [](JsonWriter& out) {
+        out.object()
+            .add("name", "a\"b\x01")
+            .key("list").array().value(1).value(-2).value(3).end()
+            .add("n", (uint32_t)4294967295u)
+            .end();
+    });
+    each_capacity("raw bytes", [](JsonWriter& out) { out.raw("raw ", 4).raw("bytes", 5); });
+
+    // printf需要结束符位置, 恰好写满剩余空间也按溢出处理, 少一字节时不溢出
+    uint8_t buf[17];
+    memset(buf, 0xEE, sizeof(buf));
+    JsonWriter out(buf, 16);
+    out.printf("%s", "123456789012345");
+    CHECK(!out.overflow());
+    CHECK_EQ(out.size(), 15);
+    out.clear();
+    out.printf("%s", "1234567890123456");
+    CHECK(out.overflow());
+    CHECK_EQ(out.size(), 16);
+    CHECK_EQ(buf[16], 0xEE);
+
+    // 溢出后继续写入被忽略; clear()清除溢出标志
+    out.clear();
+    out.raw("0123456789abcdef", 16);
+    CHECK(!out.overflow());
+    out.byte('x');
+    CHECK(out.overflow());
+    out.printf("more").object().value("more").end();
+    CHECK_EQ(out.size(), 16);
+    CHECK_EQ(buf[16], 0xEE);
+    out.clear(1);
+    CHECK(!out.overflow());
+    CHECK_EQ(out.size(), 1);
+
+    // 嵌套超过MAX_DEPTH按溢出处理
+    uint8_t deep[256];
+    JsonWriter nested(deep, sizeof(deep));
+    for (int i = 0; i < JsonWriter::MAX_DEPTH - 1; i++) nested.array();
+    CHECK(!nested.overflow());
+    nested.array();
+    CHECK(nested.overflow());
+}
+
+int main() {
+    test_table();
+    test_writer_overflow();
+    printf("test_cmds passed\n");
+    return 0;
+}
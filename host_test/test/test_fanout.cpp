@@ -0,0 +1,130 @@
+/*
+ * 广播/组播扇出: 每个订阅者恰好收到一份, 共享的缓冲池帧在最后一个发送队列释放后归还,
+ * 包括不读取数据的订阅者积压后断开的情况.
+ */
+#include "harness.h"
+#include "frame_pool.h"
+#include "app_config.h"
+
+#include <cstring>
+#include <memory>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace Harness;
+using TcpDataHandle::GROUP_ID_BASE;
+using TcpDataHandle::BROADCAST_ID;
+
+static constexpr uint16_t PORT = 19003;
+static constexpr int READERS = 6;
+static constexpr uint8_t GROUP = 3;
+
+static bool pool_full() {
+    return FramePool::available() == AppCfg::FRAME_POOL_SIZE;
+}
+
+// 100ms内没有收到任何数据
+static bool silent(Client& client) {
+    uint8_t byte;
+    return !client.recvRaw(&byte, 1, 100);
+}
+
+struct Clients {
+    Client source;
+    Client outsider;            // 未订阅
+    std::unique_ptr<Client> readers[READERS];
+};
+
+static void connect_all(Clients& c) {
+    CHECK(c.source.connect(PORT, 2));
+    CHECK(c.outsider.connect(PORT, 3));
+    CHECK(!c.source.command("mark x").empty());
+    CHECK(!c.outsider.command("mark x").empty());
+    for (int i = 0; i < READERS; i++) {
+        c.readers[i].reset(new Client);
+        CHECK(c.readers[i]->connect(PORT, 10 + i));
+        CHECK(c.readers[i]->command("group join 3").find("succeed") != std::string::npos);
+    }
+}
+
+static void test_multicast(Clients& c) {
+    FrameHeader header;
+    std::string payload;
+    for (int n = 0; n < 20; n++) {
+        std::string data = "group frame " + std::to_string(n);
+        CHECK(c.source.send(GROUP_ID_BASE + GROUP, FrameType::BINARY, data));
+        for (auto& reader : c.readers) {
+            CHECK(reader->recv(header, payload));
+            CHECK_EQ(header.goal, GROUP_ID_BASE + GROUP);
+            CHECK_EQ(header.source, c.source.id());
+            CHECK(payload == data);
+        }
+    }
+    CHECK(silent(c.outsider));
+    CHECK(silent(c.source));
+    CHECK(waitFor(pool_full));
+}
+
+static void test_broadcast(Clients& c) {
+    FrameHeader header;
+    std::string payload;
+    CHECK(c.source.send(BROADCAST_ID, FrameType::BINARY, "to all"));
+    for (auto& reader : c.readers) {
+        CHECK(reader->recv(header, payload));
+        CHECK(payload == "to all");
+    }
+    CHECK(c.outsider.recv(header, payload));
+    CHECK(payload == "to all");
+    CHECK(silent(c.source));
+    CHECK(waitFor(pool_full));
+}
+
+/**
+ * 一个订阅者停止读取: 其套接字缓冲写满后发送队列积压, 持有共享帧的引用;
+ * 其余订阅者照常收到, 该订阅者断开后引用全部释放.
+*/
+static void test_stalled_reader(Clients& c) {
+    Client& stalled = *c.readers[0];
+    int small = 4096;
+    setsockopt(stalled.fd(), SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+    FrameHeader header;
+    std::vector<uint8_t> data(TcpServer::SOCK_BUF_SIZE, 0x5A);
+    std::vector<uint8_t> got(data.size());
+    uint32_t len = 0;
+    bool held = false;
+    for (int n = 0; n < 20000 && !held; n++) {
+        CHECK(c.source.send(GROUP_ID_BASE + GROUP, FrameType::BINARY, data.data(), data.size()));
+        for (int i = 1; i < READERS; i++) {
+            CHECK(c.readers[i]->recv(header, got.data(), got.size(), len));
+            CHECK_EQ(len, data.size());
+        }
+        // 其余订阅者都已收到, 仍未归还的帧只能由积压的发送队列持有
+        held = !waitFor(pool_full, 20);
+    }
+    CHECK(held);
+    CHECK(FramePool::available() >= AppCfg::FRAME_POOL_SIZE - AppCfg::TX_QUEUE_DEPTH - 1);
+
+    stalled.close();
+    CHECK(waitFor(pool_full));
+
+    // 剩余订阅者不受影响
+    CHECK(c.source.send(GROUP_ID_BASE + GROUP, FrameType::BINARY, "after"));
+    std::string payload;
+    for (int i = 1; i < READERS; i++) {
+        CHECK(c.readers[i]->recv(header, payload));
+        CHECK(payload == "after");
+    }
+    CHECK(waitFor(pool_full));
+}
+
+int main() {
+    startServer(PORT);
+    Clients clients;
+    connect_all(clients);
+    test_multicast(clients);
+    test_broadcast(clients);
+    test_stalled_reader(clients);
+    printf("test_fanout passed\n");
+    return 0;
+}
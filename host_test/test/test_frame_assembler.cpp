@@ -0,0 +1,181 @@
+/*
+ * 帧重组器: 拆分与合并的帧, 跨环尾的帧, 伪帧头重同步, 流模式阈值
+ */
+#include "harness.h"
+#include "frame_assembler.h"
+#include "metrics.h"
+#include "app_config.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace Harness;
+using TcpDataHandle::FrameAssembler;
+using Bytes = std::vector<uint8_t>;
+
+static FrameAssembler _asm;
+
+static Bytes make_frame(FrameType type, uint32_t len, uint8_t seed = 0) {
+    Bytes frame(sizeof(FrameHeader) + len);
+    FrameHeader header = {TcpDataHandle::FRAME_HEAD, type, 2, 3, len};
+    memcpy(frame.data(), &header, sizeof(header));
+    for (uint32_t i = 0; i < len; i++) {
+        // 负载中不出现FRAME_HEAD, 重同步测试才能确定丢弃的字节数
+        frame[sizeof(FrameHeader) + i] = (uint8_t)((seed + i) % 0xA0);
+    }
+    return frame;
+}
+
+static void push_all(const Bytes& data) {
+    CHECK_EQ(_asm.push(IBuf(data.data(), data.size())), data.size());
+}
+
+static bool pop_equals(const Bytes& expect) {
+    IBuf frame;
+    if (!_asm.pop(frame)) return false;
+    return frame.size() == expect.size() && memcmp(frame.data(), expect.data(), expect.size()) == 0;
+}
+
+static void test_coalesced() {
+    _asm.reset();
+    Bytes a = make_frame(FrameType::CMD, 5, 1);
+    Bytes b = make_frame(FrameType::BINARY, 0);
+    Bytes c = make_frame(FrameType::JSON, 300, 7);
+    Bytes all = a;
+    all.insert(all.end(), b.begin(), b.end());
+    all.insert(all.end(), c.begin(), c.end());
+    push_all(all);
+    CHECK(pop_equals(a));
+    CHECK(pop_equals(b));
+    CHECK(pop_equals(c));
+    IBuf frame;
+    CHECK(!_asm.pop(frame));
+    CHECK_EQ(_asm.dropped(), 0);
+}
+
+// 逐字节到达: 帧头不完整与负载不完整时都不返回
+static void test_split() {
+    _asm.reset();
+    Bytes a = make_frame(FrameType::CMD, 20, 3);
+    IBuf frame;
+    for (uint32_t i = 0; i + 1 < a.size(); i++) {
+        push_all(Bytes{a[i]});
+        CHECK(!_asm.pop(frame));
+    }
+    push_all(Bytes{a.back()});
+    CHECK(pop_equals(a));
+}
+
+// 帧跨越环尾时取出线性拷贝, 内容不变
+static void test_wrap() {
+    _asm.reset();
+    for (int i = 0; i < 40; i++) {
+        Bytes a = make_frame(FrameType::BINARY, 100 + i * 17, i);
+        // 每帧分两次到达, 使写位置不与帧边界对齐
+        Bytes first(a.begin(), a.begin() + a.size() / 3);
+        Bytes rest(a.begin() + a.size() / 3, a.end());
+        push_all(first);
+        push_all(rest);
+        CHECK(pop_equals(a));
+    }
+    CHECK_EQ(_asm.dropped(), 0);
+}
+
+static void test_resync() {
+    _asm.reset();
+    uint32_t metric = Metrics::get(Metrics::RESYNC_BYTES);
+    Bytes good = make_frame(FrameType::CMD, 10, 5);
+
+    // 非帧头字节
+    Bytes junk = {0x00, 0x11, 0x55, 0xFF};
+    // 帧头正确但类型非法
+    Bytes bad_type = make_frame(FrameType::UNKNOWN, 4);
+    Bytes bad_type2 = make_frame(FrameType::FRAME_TYPE_COUNT, 4);
+    // 非BINARY帧长度超过整帧上限
+    Bytes bad_len = make_frame(FrameType::CMD, 0);
+    uint32_t too_long = TcpServer::SOCK_BUF_SIZE + 1;
+    memcpy(&bad_len[4], &too_long, sizeof(too_long));
+
+    uint32_t junk_bytes = 0;
+    for (const Bytes* part : {&junk, &bad_type, &bad_type2, &bad_len}) {
+        push_all(*part);
+        junk_bytes += part->size();
+    }
+    push_all(good);
+    CHECK(pop_equals(good));
+    CHECK_EQ(_asm.dropped(), junk_bytes);
+    CHECK_EQ(Metrics::get(Metrics::RESYNC_BYTES) - metric, junk_bytes);
+}
+
+static void test_stream_threshold() {
+    IBuf frame;
+
+    // 恰好SOCK_BUF_SIZE的BINARY帧整帧处理
+    _asm.reset();
+    Bytes whole = make_frame(FrameType::BINARY, TcpServer::SOCK_BUF_SIZE, 9);
+    push_all(whole);
+    CHECK(pop_equals(whole));
+    CHECK(!_asm.streaming());
+
+    // 多一字节进入流模式, 数据按到达分段取出, 首段含帧头
+    _asm.reset();
+    Bytes big = make_frame(FrameType::BINARY, 3 * FrameAssembler::RING_SIZE, 4);
+    Bytes next = make_frame(FrameType::CMD, 6, 2);
+    Bytes data = big;
+    data.insert(data.end(), next.begin(), next.end());
+    Bytes out;
+    uint32_t fed = 0;
+    while (out.size() < big.size()) {
+        fed += _asm.push(IBuf(data.data() + fed, std::min<uint32_t>(700, data.size() - fed)));
+        if (!_asm.streaming()) {
+            CHECK(!_asm.pop(frame));
+            CHECK(_asm.streaming());
+            CHECK_EQ(_asm.streamHeader().length, big.size() - sizeof(FrameHeader));
+            CHECK_EQ(_asm.streamOffset(), 0);
+        }
+        while (_asm.streaming()) {
+            IBuf chunk = _asm.streamPeek(FrameAssembler::FRAME_MAX);
+            if (chunk.empty()) break;
+            CHECK(chunk.size() <= FrameAssembler::FRAME_MAX);
+            out.insert(out.end(), chunk.begin(), chunk.end());
+            _asm.streamConsume(chunk.size());
+        }
+    }
+    CHECK(out == big);
+    CHECK(!_asm.streaming());
+    fed += _asm.push(IBuf(data.data() + fed, data.size() - fed));
+    CHECK_EQ(fed, data.size());
+    CHECK(pop_equals(next));
+
+    // 超过STREAM_FRAME_MAX的BINARY帧按伪帧头丢弃
+    _asm.reset();
+    Bytes huge = make_frame(FrameType::BINARY, 0);
+    uint32_t huge_len = AppCfg::STREAM_FRAME_MAX + 1;
+    memcpy(&huge[4], &huge_len, sizeof(huge_len));
+    push_all(huge);
+    push_all(next);
+    CHECK(pop_equals(next));
+    CHECK_EQ(_asm.dropped(), huge.size());
+}
+
+// 环形缓冲满时push只写入空闲部分
+static void test_ring_full() {
+    _asm.reset();
+    Bytes fill(FrameAssembler::RING_SIZE + 100, 0x01);
+    CHECK_EQ(_asm.push(IBuf(fill.data(), fill.size())), FrameAssembler::RING_SIZE);
+    CHECK_EQ(_asm.space(), 0);
+    IBuf frame;
+    CHECK(!_asm.pop(frame));
+    CHECK_EQ(_asm.space(), FrameAssembler::RING_SIZE);
+}
+
+int main() {
+    test_coalesced();
+    test_split();
+    test_wrap();
+    test_resync();
+    test_stream_threshold();
+    test_ring_full();
+    printf("test_frame_assembler passed\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * 空闲断开(空闲超时编译为2秒): 不发数据的连接被时间轮关闭, 定时发PING的连接
+ * 跨越多个超时周期仍保持; 接入的连接开启TCP keepalive
+ */
+#include "harness.h"
+#include "app_config.h"
+#include "metrics.h"
+#include "tcp_server.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+using namespace Harness;
+using TcpDataHandle::SERVER_ID;
+
+static constexpr uint16_t PORT = 19010;
+static constexpr int PING_MS = 250;
+static constexpr int TIMEOUT_MS = AppCfg::TCP_IDLE_TIMEOUT_S * 1000;
+static_assert(AppCfg::TCP_IDLE_TIMEOUT_S == 2, "test_idle expects APP_TCP_IDLE_TIMEOUT_S=2");
+
+static int sock_option(int fd, int level, int name) {
+    int value = -1;
+    socklen_t len = sizeof(value);
+    CHECK(getsockopt(fd, level, name, &value, &len) == 0);
+    return value;
+}
+
+// 服务器端套接字(同一进程)的keepalive参数
+static void test_keepalive() {
+    Client a;
+    CHECK(a.connect(PORT, 2));
+    CHECK(!a.command("mark x").empty());
+    int fd = TcpServer::findSocketById(a.id());
+    CHECK(fd >= 0);
+    CHECK_EQ(sock_option(fd, SOL_SOCKET, SO_KEEPALIVE), 1);
+    CHECK_EQ(sock_option(fd, IPPROTO_TCP, TCP_KEEPIDLE), AppCfg::TCP_KEEPALIVE_IDLE_S);
+    CHECK_EQ(sock_option(fd, IPPROTO_TCP, TCP_KEEPINTVL), AppCfg::TCP_KEEPALIVE_INTERVAL_S);
+    CHECK_EQ(sock_option(fd, IPPROTO_TCP, TCP_KEEPCNT), AppCfg::TCP_KEEPALIVE_COUNT);
+}
+
+static bool ping(Client& client) {
+    FrameHeader header;
+    std::string payload;
+    return client.send(SERVER_ID, FrameType::PING, "ping") && client.recv(header, payload)
+        && header.type == FrameType::PONG && payload == "ping";
+}
+
+/**
+ * 按秒计时, 沉默的连接在超时后1秒内被关闭; 活跃的连接在三个超时周期内一直保持,
+ * 停止发送后同样被关闭
+*/
+static void test_reap() {
+    uint32_t reaped = Metrics::get(Metrics::IDLE_REAPED);
+    Client silent, active;
+    CHECK(silent.connect(PORT, 3) && active.connect(PORT, 4));
+    CHECK(!silent.command("mark x").empty() && !active.command("mark x").empty());
+
+    int64_t start = now();
+    bool closed = false;
+    while ((now() - start) / 1000 < 3 * TIMEOUT_MS) {
+        CHECK(ping(active));
+        if (!closed && TcpServer::findSocketById(silent.id()) < 0) {
+            int64_t idle_ms = (now() - start) / 1000;
+            CHECK(idle_ms >= TIMEOUT_MS - 1000 && idle_ms <= TIMEOUT_MS + 1000 + PING_MS);
+            closed = true;
+        }
+        sleepMs(PING_MS);
+    }
+    CHECK(closed);
+    CHECK(silent.waitClosed(100));
+    CHECK_EQ(Metrics::get(Metrics::IDLE_REAPED) - reaped, 1);
+    CHECK(TcpServer::findSocketById(active.id()) >= 0);
+    CHECK(!active.command("mark x").empty());
+
+    CHECK(waitFor([&active] { return TcpServer::findSocketById(active.id()) < 0; }, TIMEOUT_MS + 1500));
+    CHECK(active.waitClosed(100));
+    CHECK_EQ(Metrics::get(Metrics::IDLE_REAPED) - reaped, 2);
+}
+
+int main() {
+    startServer(PORT);
+    test_keepalive();
+    test_reap();
+    printf("test_idle passed\n");
+    return 0;
+}
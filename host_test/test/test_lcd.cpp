@@ -0,0 +1,292 @@
+/*
+ * LCD帧缓冲与刷新: 脏矩形合并(上限与合并阈值), 画线标记整个包围盒,
+ * 乒乓DMA缓冲在事务完成前不被改写(由fake_panel检查), 刷新后屏幕与模型一致,
+ * GUI页面每次刷新的窗口数, SPI事务数与字节数
+ */
+#include "harness.h"
+#include "fake_panel.h"
+#include "lcd_st7735.h"
+
+#include <cstring>
+
+using namespace Harness;
+using FakePanel::Window;
+
+static constexpr int DIRTY_MAX = 8;         // 同lcd_st7735.cpp
+static uint16_t _model[LCD_HEIGHT][LCD_WIDTH];
+
+static void fill(int x0, int y0, int x1, int y1, uint16_t color) {
+    lcd_data_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = LCD_REC;
+    frame.x = x0;
+    frame.y = y0;
+    frame.x_end = x1;
+    frame.y_end = y1;
+    frame.color = color;
+    lcd_frame_display_data(&frame);
+    for (int y = y0; y <= y1 && y < LCD_HEIGHT; y++) {
+        for (int x = x0; x <= x1 && x < LCD_WIDTH; x++) {
+            _model[y][x] = color;
+        }
+    }
+}
+
+static void line(int x0, int y0, int x1, int y1, uint16_t color) {
+    lcd_data_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = LCD_LINE;
+    frame.x = x0;
+    frame.y = y0;
+    frame.x_end = x1;
+    frame.y_end = y1;
+    frame.color = color;
+    lcd_frame_display_data(&frame);
+}
+
+// 刷新并让假屏幕发送完所有事务, 返回本次刷新用到的窗口
+static std::vector<Window> flush() {
+    FakePanel::clearWindows();
+    lcd_flush();
+    FakePanel::finish();
+    return FakePanel::windows();
+}
+
+static bool screen_matches() {
+    for (int y = 0; y < LCD_HEIGHT; y++) {
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            if (FakePanel::pixel(x, y) != _model[y][x]) {
+                fprintf(stderr, "pixel (%d, %d): screen %04x, expected %04x\n",
+                        x, y, FakePanel::pixel(x, y), _model[y][x]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool contains(const Window& w, int x0, int y0, int x1, int y1) {
+    return w.x0 <= x0 && w.y0 <= y0 && w.x1 >= x1 && w.y1 >= y1;
+}
+
+static void test_full_screen() {
+    fill(0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1, COLOR_BLUE);
+    std::vector<Window> windows = flush();
+    CHECK_EQ(windows.size(), 1);
+    CHECK(contains(windows[0], 0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1));
+    CHECK(screen_matches());
+}
+
+// 合并多出的像素不超过LCD_MERGE_SLACK(256)时合并为一个窗口
+static void test_merge_slack() {
+    // 两条16像素的横线相隔17行: 并集16x18, 多出256像素, 合并
+    fill(0, 0, 15, 0, COLOR_RED);
+    fill(0, 17, 15, 17, COLOR_RED);
+    std::vector<Window> windows = flush();
+    CHECK_EQ(windows.size(), 1);
+    CHECK(contains(windows[0], 0, 0, 15, 17));
+    CHECK(screen_matches());
+
+    // 相隔18行多出272像素, 分开发送
+    fill(0, 0, 15, 0, COLOR_GREEN);
+    fill(0, 18, 15, 18, COLOR_GREEN);
+    windows = flush();
+    CHECK_EQ(windows.size(), 2);
+    CHECK(screen_matches());
+
+    // 相邻与重叠的矩形直接合并
+    fill(40, 40, 49, 49, COLOR_YELLOW);
+    fill(50, 40, 59, 49, COLOR_YELLOW);
+    fill(45, 45, 54, 54, COLOR_CYAN);
+    windows = flush();
+    CHECK_EQ(windows.size(), 1);
+    CHECK(screen_matches());
+}
+
+// 分散的像素超过上限时强制合并, 窗口数不超过DIRTY_MAX且都被发送
+static void test_dirty_max() {
+    for (int i = 0; i < 3 * DIRTY_MAX; i++) {
+        int x = (i * 37) % LCD_WIDTH;
+        int y = (i * 53) % LCD_HEIGHT;
+        fill(x, y, x, y, COLOR_WHITE);
+    }
+    std::vector<Window> windows = flush();
+    CHECK(windows.size() <= (size_t)DIRTY_MAX);
+    CHECK(screen_matches());
+}
+
+// 画线标记起止点的整个包围盒, 与方向无关
+static void test_line_bounds() {
+    struct { int x0, y0, x1, y1; } lines[] = {
+        {100, 90, 20, 10},      // 从右下到左上
+        {10, 120, 12, 5},       // 陡峭, 自下而上
+        {5, 60, 120, 61},       // 平缓
+        {127, 0, 0, 127},       // 对角线
+    };
+    for (auto& l : lines) {
+        fill(0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1, COLOR_BLACK);
+        flush();
+        line(l.x0, l.y0, l.x1, l.y1, COLOR_ORANGE);
+        std::vector<Window> windows = flush();
+        CHECK_EQ(windows.size(), 1);
+        CHECK(contains(windows[0], std::min(l.x0, l.x1), std::min(l.y0, l.y1),
+                       std::max(l.x0, l.x1), std::max(l.y0, l.y1)));
+        CHECK_EQ(FakePanel::pixel(l.x0, l.y0), COLOR_ORANGE);
+        CHECK_EQ(FakePanel::pixel(l.x1, l.y1), COLOR_ORANGE);
+        // 包围盒外不变
+        Window box = {std::min(l.x0, l.x1), std::min(l.y0, l.y1), std::max(l.x0, l.x1), std::max(l.y0, l.y1)};
+        for (int y = 0; y < LCD_HEIGHT; y++) {
+            for (int x = 0; x < LCD_WIDTH; x++) {
+                if (contains(box, x, y, x, y)) continue;
+                CHECK_EQ(FakePanel::pixel(x, y), COLOR_BLACK);
+            }
+        }
+    }
+    fill(0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1, COLOR_BLACK);
+    flush();
+}
+
+/**
+ * 随机绘制: 多数刷新不等假屏幕发送完就继续绘制, 两块DMA缓冲与排队事务跨刷新轮转,
+ * 任一缓冲在事务完成前被改写都会由fake_panel报错
+*/
+static void test_random() {
+    uint32_t seed = 12345;
+    auto next = [&seed](uint32_t n) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 8) % n;
+    };
+    for (int round = 0; round < 300; round++) {
+        int count = 1 + next(12);
+        for (int i = 0; i < count; i++) {
+            int x0 = next(LCD_WIDTH), y0 = next(LCD_HEIGHT);
+            int x1 = x0 + next(LCD_WIDTH - x0), y1 = y0 + next(LCD_HEIGHT - y0);
+            fill(x0, y0, x1, y1, (uint16_t)next(0x10000));
+        }
+        if (round % 10 == 9) {
+            flush();
+            CHECK(screen_matches());
+        } else {
+            lcd_flush();
+        }
+    }
+    flush();
+    CHECK(screen_matches());
+}
+
+/* GUI页面: 与gui.cpp的page_render相同, 6行15列8x16字符, 只重画变化的字符段 */
+static constexpr int PAGE_ROWS = 6;
+static constexpr int PAGE_COLS = 15;
+static char _shown[PAGE_ROWS][PAGE_COLS + 1];
+
+struct FlushCost {
+    size_t windows;
+    uint32_t transactions;
+    uint32_t bytes;
+};
+
+static FlushCost page_render(const char* const rows[PAGE_ROWS]) {
+    lcd_data_frame_t frame;
+    uint8_t text[PAGE_COLS + 1];
+    memset(&frame, 0, sizeof(frame));
+    frame.data = text;
+    for (int r = 0; r < PAGE_ROWS; r++) {
+        int col = 0;
+        while (col < PAGE_COLS) {
+            if (rows[r][col] == _shown[r][col]) {
+                col++;
+                continue;
+            }
+            int start = col;
+            while (col < PAGE_COLS && rows[r][col] != _shown[r][col]) col++;
+            memcpy(frame.data, &rows[r][start], col - start);
+            frame.data[col - start] = '\0';
+            frame.len = col - start;
+            frame.type = LCD_STRING;
+            frame.font = LCD_FONT_8X16;
+            frame.color = COLOR_GREEN;
+            frame.back_color = COLOR_BLACK;
+            frame.x = 3 + 8 * start;
+            frame.y = 24 + 16 * r;
+            lcd_frame_display_data(&frame);
+        }
+        memcpy(_shown[r], rows[r], PAGE_COLS);
+    }
+    uint32_t transactions = FakePanel::queued();
+    uint32_t bytes = FakePanel::sentBytes();
+    size_t windows = flush().size();
+    return {windows, FakePanel::queued() - transactions, FakePanel::sentBytes() - bytes};
+}
+
+/**
+ * 每个窗口5笔命令/参数事务共11字节, 像素按整行分块, 每块不超过LCD_MAXTRANS_SIZE(4096),
+ * 120像素宽的窗口每行240字节, 每块17行
+*/
+static void test_page_render() {
+    // 同gui.cpp: 先清屏, 已显示的页面为空白
+    fill(0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1, COLOR_BLACK);
+    flush();
+    for (int r = 0; r < PAGE_ROWS; r++) {
+        memset(_shown[r], ' ', PAGE_COLS);
+    }
+    const char* page[PAGE_ROWS] = {
+        "1 phone-a   .12",
+        "2 sensor-01 .13",
+        "3 sensor-02 .14",
+        "4 tablet    .15",
+        "rx 1024 tx 980 ",
+        "up 00:12:07    ",
+    };
+    // 首次显示: 前五行合并为120x80(5块), 最后一行只有11个字符, 合并多出512像素, 单独88x16(1块)
+    FlushCost cost = page_render(page);
+    CHECK_EQ(cost.windows, 2);
+    CHECK_EQ(cost.transactions, (5 + 5) + (5 + 1));
+    CHECK_EQ(cost.bytes, 2 * 11 + 120 * 80 * 2 + 88 * 16 * 2);
+    CHECK(contains(FakePanel::windows()[0], 3, 24, 122, 103));
+    CHECK(contains(FakePanel::windows()[1], 3, 104, 90, 119));
+
+    // 内容不变: 不发送任何事务
+    cost = page_render(page);
+    CHECK_EQ(cost.windows, 0);
+    CHECK_EQ(cost.transactions, 0);
+    CHECK_EQ(cost.bytes, 0);
+
+    // 计时只变一个字符: 一个8x16窗口
+    page[5] = "up 00:12:08    ";
+    cost = page_render(page);
+    CHECK_EQ(cost.windows, 1);
+    CHECK_EQ(cost.transactions, 5 + 1);
+    CHECK_EQ(cost.bytes, 11 + 8 * 16 * 2);
+    CHECK(contains(FakePanel::windows()[0], 3 + 8 * 10, 24 + 16 * 5, 3 + 8 * 11 - 1, 24 + 16 * 6 - 1));
+
+    // 同一行相隔较远的两段(rx与tx计数)分开发送, 不合并中间未变的字符
+    page[4] = "rx 1100 tx 999 ";
+    cost = page_render(page);
+    CHECK_EQ(cost.windows, 2);
+    CHECK_EQ(cost.transactions, 2 * (5 + 1));
+    CHECK_EQ(cost.bytes, 2 * 11 + (3 + 2) * 8 * 16 * 2);
+
+    // 页面区域只有黑底绿字
+    for (int r = 0; r < PAGE_ROWS; r++) {
+        for (int x = 3; x < 3 + 8 * PAGE_COLS; x++) {
+            for (int y = 24 + 16 * r; y < 40 + 16 * r; y++) {
+                uint16_t color = FakePanel::pixel(x, y);
+                CHECK(color == COLOR_GREEN || color == COLOR_BLACK);
+            }
+        }
+    }
+}
+
+int main() {
+    lcd_st7735_init();
+    test_full_screen();
+    test_merge_slack();
+    test_dirty_max();
+    test_line_bounds();
+    test_random();
+    test_page_render();
+    printf("%u spi transactions, at most %u in flight\n",
+           (unsigned)FakePanel::queued(), (unsigned)FakePanel::maxInFlight());
+    printf("test_lcd passed\n");
+    return 0;
+}
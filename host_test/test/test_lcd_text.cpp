@@ -0,0 +1,225 @@
+/*
+ * LCD文字: 三种字号的像素与ascii_1608字模逐位一致, 换行与右边界切分,
+ * 每行只标记一个脏矩形, 颜色对展开表缓存被替换后重新生成的颜色正确
+ */
+#include "harness.h"
+#include "fake_panel.h"
+#include "lcd_st7735.h"
+#include "lcd_font.h"
+
+#include <cstring>
+
+using namespace Harness;
+using FakePanel::Window;
+
+static constexpr int WRAP_X = 4;            // 换行后的起始x, 同lcd_show_string_font
+static uint16_t _model[LCD_HEIGHT][LCD_WIDTH];
+
+struct FontSize {
+    int width, height;
+};
+static const FontSize FONTS[] = {{8, 16}, {16, 32}, {8, 8}};     // 按LCD_FONT_*顺序
+
+static void clear_screen() {
+    lcd_data_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = LCD_CLEAR;
+    frame.color = COLOR_BLACK;
+    lcd_frame_display_data(&frame);
+    lcd_flush();
+    FakePanel::finish();
+    for (int y = 0; y < LCD_HEIGHT; y++) {
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            _model[y][x] = COLOR_BLACK;
+        }
+    }
+}
+
+static void draw_text(int x, int y, const char* text, uint8_t font, uint16_t color, uint16_t back_color) {
+    char buf[64];
+    lcd_data_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    strncpy(buf, text, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    frame.type = LCD_STRING;
+    frame.font = font;
+    frame.data = (uint8_t *)buf;
+    frame.len = strlen(buf);
+    frame.color = color;
+    frame.back_color = back_color;
+    frame.x = x;
+    frame.y = y;
+    lcd_frame_display_data(&frame);
+}
+
+// 字模点阵直接取自ascii_1608: 16x32横竖放大2倍, 8x8相邻两行相或
+static bool glyph_bit(char ch, uint8_t font, int px, int py) {
+    unsigned g = (uint8_t)ch - ' ';
+    if (g >= LCD_FONT_GLYPHS) g = 0;
+    switch (font) {
+    case LCD_FONT_16X32: return ascii_1608[g][py / 2] & (0x01 << (px / 2));
+    case LCD_FONT_8X8: return (ascii_1608[g][2 * py] | ascii_1608[g][2 * py + 1]) & (0x01 << px);
+    default: return ascii_1608[g][py] & (0x01 << px);
+    }
+}
+
+// 在模型上画一段字符, 调用者给出期望的位置
+static void model_run(int x, int y, const char* text, uint8_t font, uint16_t color, uint16_t back_color) {
+    const FontSize& size = FONTS[font];
+    for (int i = 0; text[i]; i++) {
+        for (int py = 0; py < size.height && y + py < LCD_HEIGHT; py++) {
+            for (int px = 0; px < size.width; px++) {
+                bool on = glyph_bit(text[i], font, px, py);
+                _model[y + py][x + i * size.width + px] = on ? color : back_color;
+            }
+        }
+    }
+}
+
+static Window run_window(int x, int y, int count, uint8_t font) {
+    const FontSize& size = FONTS[font];
+    return {x, y, x + count * size.width - 1, std::min(y + size.height, (int)LCD_HEIGHT) - 1};
+}
+
+static std::vector<Window> flush() {
+    FakePanel::clearWindows();
+    lcd_flush();
+    FakePanel::finish();
+    return FakePanel::windows();
+}
+
+static bool screen_matches() {
+    for (int y = 0; y < LCD_HEIGHT; y++) {
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            if (FakePanel::pixel(x, y) != _model[y][x]) {
+                fprintf(stderr, "pixel (%d, %d): screen %04x, expected %04x\n",
+                        x, y, FakePanel::pixel(x, y), _model[y][x]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool same(const Window& a, const Window& b) {
+    if (a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1) return true;
+    fprintf(stderr, "window (%d, %d)-(%d, %d), expected (%d, %d)-(%d, %d)\n",
+            a.x0, a.y0, a.x1, a.y1, b.x0, b.y0, b.x1, b.y1);
+    return false;
+}
+
+// 每种字号一行字符串: 一个与字符串等大的窗口, 越界字符显示为空格
+static void test_fonts() {
+    struct { int x, y; const char* text; uint8_t font; } lines[] = {
+        {3, 2, "Ag~0{|}", LCD_FONT_8X16},
+        {10, 30, "W#q", LCD_FONT_16X32},
+        {20, 90, "Hello, 8x8!", LCD_FONT_8X8},
+        {0, 110, "A\x7f\x01z", LCD_FONT_8X16},
+    };
+    for (auto& l : lines) {
+        clear_screen();
+        draw_text(l.x, l.y, l.text, l.font, COLOR_WHITE, COLOR_BLUE);
+        model_run(l.x, l.y, l.text, l.font, COLOR_WHITE, COLOR_BLUE);
+        std::vector<Window> windows = flush();
+        CHECK_EQ(windows.size(), 1);
+        CHECK(same(windows[0], run_window(l.x, l.y, strlen(l.text), l.font)));
+        CHECK(screen_matches());
+    }
+    // 越界字符与空格相同
+    for (int y = 110; y < 126; y++) {
+        for (int x = 8; x < 24; x++) {
+            CHECK_EQ(FakePanel::pixel(x, y), COLOR_BLUE);
+        }
+    }
+}
+
+// 换行后从WRAP_X开始下一行, 空行不标记窗口
+static void test_newline() {
+    clear_screen();
+    draw_text(10, 20, "abcdef\nxy", LCD_FONT_8X16, COLOR_GREEN, COLOR_BLACK);
+    model_run(10, 20, "abcdef", LCD_FONT_8X16, COLOR_GREEN, COLOR_BLACK);
+    model_run(WRAP_X, 36, "xy", LCD_FONT_8X16, COLOR_GREEN, COLOR_BLACK);
+    std::vector<Window> windows = flush();
+    CHECK_EQ(windows.size(), 2);
+    CHECK(same(windows[0], run_window(10, 20, 6, LCD_FONT_8X16)));
+    CHECK(same(windows[1], run_window(WRAP_X, 36, 2, LCD_FONT_8X16)));
+    CHECK(screen_matches());
+
+    clear_screen();
+    draw_text(30, 10, "ab\n\ncd", LCD_FONT_8X8, COLOR_YELLOW, COLOR_BLACK);
+    model_run(30, 10, "ab", LCD_FONT_8X8, COLOR_YELLOW, COLOR_BLACK);
+    model_run(WRAP_X, 26, "cd", LCD_FONT_8X8, COLOR_YELLOW, COLOR_BLACK);
+    windows = flush();
+    CHECK_EQ(windows.size(), 2);
+    CHECK(same(windows[0], run_window(30, 10, 2, LCD_FONT_8X8)));
+    CHECK(same(windows[1], run_window(WRAP_X, 26, 2, LCD_FONT_8X8)));
+    CHECK(screen_matches());
+}
+
+// 放不下下一个字符时在右边界切分; 恰好放满时不切分
+static void test_right_edge() {
+    clear_screen();
+    draw_text(0, 0, "0123456789ABCDEF", LCD_FONT_8X16, COLOR_WHITE, COLOR_BLACK);
+    model_run(0, 0, "0123456789ABCDEF", LCD_FONT_8X16, COLOR_WHITE, COLOR_BLACK);
+    std::vector<Window> windows = flush();
+    CHECK_EQ(windows.size(), 1);
+    CHECK(same(windows[0], run_window(0, 0, 16, LCD_FONT_8X16)));
+    CHECK(screen_matches());
+
+    clear_screen();
+    draw_text(0, 0, "0123456789ABCDEFGHIJ", LCD_FONT_8X16, COLOR_WHITE, COLOR_BLACK);
+    model_run(0, 0, "0123456789ABCDEF", LCD_FONT_8X16, COLOR_WHITE, COLOR_BLACK);
+    model_run(WRAP_X, 16, "GHIJ", LCD_FONT_8X16, COLOR_WHITE, COLOR_BLACK);
+    windows = flush();
+    CHECK_EQ(windows.size(), 2);
+    CHECK(same(windows[0], run_window(0, 0, 16, LCD_FONT_8X16)));
+    CHECK(same(windows[1], run_window(WRAP_X, 16, 4, LCD_FONT_8X16)));
+    CHECK(screen_matches());
+
+    clear_screen();
+    draw_text(20, 40, "ABCDEFGHI", LCD_FONT_16X32, COLOR_CYAN, COLOR_BLACK);
+    model_run(20, 40, "ABCDEF", LCD_FONT_16X32, COLOR_CYAN, COLOR_BLACK);
+    model_run(WRAP_X, 72, "GHI", LCD_FONT_16X32, COLOR_CYAN, COLOR_BLACK);
+    windows = flush();
+    CHECK_EQ(windows.size(), 2);
+    CHECK(same(windows[0], run_window(20, 40, 6, LCD_FONT_16X32)));
+    CHECK(same(windows[1], run_window(WRAP_X, 72, 3, LCD_FONT_16X32)));
+    CHECK(screen_matches());
+}
+
+/**
+ * 展开表只缓存两个颜色对: 轮流使用更多颜色对使展开表反复被替换,
+ * 交换前景与背景也是不同的颜色对, 每段文字的颜色都必须正确
+*/
+static void test_glyph_cache() {
+    struct { uint16_t color, back_color; } pairs[] = {
+        {COLOR_GREEN, COLOR_BLACK},
+        {COLOR_WHITE, COLOR_BLUE},
+        {COLOR_RED, COLOR_YELLOW},
+        {COLOR_BLACK, COLOR_GREEN},
+        {COLOR_GREEN, COLOR_BLUE},
+    };
+    // 命中, 替换, 再命中刚替换的表; 前景相同背景不同的颜色对不得命中
+    const int order[] = {0, 0, 1, 4, 0, 2, 1, 3, 3, 4, 0, 1};
+    clear_screen();
+    int y = 0;
+    for (int i : order) {
+        char text[] = "Cache#0";
+        text[6] = '0' + i;
+        draw_text(2, y, text, LCD_FONT_8X8, pairs[i].color, pairs[i].back_color);
+        model_run(2, y, text, LCD_FONT_8X8, pairs[i].color, pairs[i].back_color);
+        y += 10;
+    }
+    flush();
+    CHECK(screen_matches());
+}
+
+int main() {
+    lcd_st7735_init();
+    test_fonts();
+    test_newline();
+    test_right_edge();
+    test_glyph_cache();
+    printf("test_lcd_text passed\n");
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * 离线信箱(主机上无TF卡, 只用PSRAM): 发往已登录过的离线设备的帧暂存,
+ * 设备重新登录后按原顺序送达, 投递期间新到的帧排在暂存帧之后;
+ * 投递时缓冲池耗尽则等待, 暂存帧不丢失
+ */
+#include "harness.h"
+#include "frame_pool.h"
+#include "mailbox.h"
+#include "app_config.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Harness;
+
+static constexpr uint16_t PORT = 19006;
+static constexpr int OFFLINE_FRAMES = 30;
+static constexpr int ONLINE_FRAMES = 30;   // 合计不超过MAILBOX_FRAMES, 不会因信箱满丢弃
+static constexpr int HELD_FRAMES = 10;
+
+// 登录后让b离线, 直到服务器注销它
+static void go_offline(Client& a, Client& b, const char* name) {
+    CHECK(!a.command("mark x").empty());
+    CHECK(b.command(std::string("login ") + name).find("succeed") != std::string::npos);
+    b.close();
+    CHECK(waitFor([&b] { return TcpServer::findSocketById(b.id()) < 0; }));
+}
+
+static void test_reconnect_order() {
+    Client a, b;
+    CHECK(a.connect(PORT, 20) && b.connect(PORT, 21));
+    go_offline(a, b, "dev");
+
+    Mailbox::Stats before;
+    Mailbox::read(before);
+    for (int i = 0; i < OFFLINE_FRAMES; i++) {
+        CHECK(a.send(21, FrameType::BINARY, "m" + std::to_string(i)));
+    }
+    CHECK(waitFor([&before] {
+        Mailbox::Stats now;
+        Mailbox::read(now);
+        return now.stored - before.stored == OFFLINE_FRAMES;
+    }));
+
+    // 重新登录, 同时继续发送: 新帧不得越过暂存帧
+    CHECK(b.connect(PORT, 21));
+    std::thread sender([&a] {
+        for (int i = OFFLINE_FRAMES; i < OFFLINE_FRAMES + ONLINE_FRAMES; i++) {
+            CHECK(a.send(21, FrameType::BINARY, "m" + std::to_string(i)));
+        }
+    });
+    CHECK(b.send(TcpDataHandle::SERVER_ID, FrameType::CMD, "login dev"));
+    FrameHeader header;
+    std::string payload;
+    int next = 0;
+    bool replied = false;
+    while (next < OFFLINE_FRAMES + ONLINE_FRAMES || !replied) {
+        CHECK(b.recv(header, payload));
+        if (header.type == FrameType::CMD) {
+            CHECK(payload.find("succeed") != std::string::npos);
+            replied = true;
+            continue;
+        }
+        CHECK_EQ(header.source, a.id());
+        if (payload != "m" + std::to_string(next)) {
+            fprintf(stderr, "got '%s', expected 'm%d'\n", payload.c_str(), next);
+            exit(1);
+        }
+        next++;
+    }
+    sender.join();
+
+    Mailbox::Stats after;
+    Mailbox::read(after);
+    CHECK_EQ(after.dropped, before.dropped);
+    CHECK_EQ(after.expired, before.expired);
+    CHECK_EQ(after.pending, 0);
+    CHECK(after.delivered - before.delivered >= OFFLINE_FRAMES);
+    CHECK(waitFor([] { return FramePool::available() == AppCfg::FRAME_POOL_SIZE; }));
+}
+
+// 目标登录时缓冲池已被占满: 投递等待空闲槽位, 暂存帧不计为丢弃, 之后按序送达
+static void test_pool_exhausted() {
+    Client a, b;
+    CHECK(a.connect(PORT, 22) && b.connect(PORT, 23));
+    go_offline(a, b, "held");
+
+    Mailbox::Stats before;
+    Mailbox::read(before);
+    for (int i = 0; i < HELD_FRAMES; i++) {
+        CHECK(a.send(b.id(), FrameType::BINARY, "h" + std::to_string(i)));
+    }
+    CHECK(waitFor([&before] {
+        Mailbox::Stats now;
+        Mailbox::read(now);
+        return now.stored - before.stored == HELD_FRAMES;
+    }));
+
+    std::vector<FramePool::Frame*> held;
+    while (FramePool::Frame* frame = FramePool::alloc()) {
+        held.push_back(frame);
+    }
+    // 登录命令的应答也要占用缓冲池, 直接在服务器上登记设备名触发投递
+    CHECK(b.connect(PORT, 23));
+    CHECK(waitFor([] { return TcpServer::findSocketById(23) >= 0; }));
+    CHECK(TcpServer::setClientName(TcpServer::findSocketById(23), "held"));
+    sleepMs(200);
+    Mailbox::Stats now;
+    Mailbox::read(now);
+    CHECK_EQ(now.dropped, before.dropped);
+    CHECK_EQ(now.delivered, before.delivered);
+    CHECK_EQ(now.pending, HELD_FRAMES);
+
+    for (FramePool::Frame* frame : held) {
+        FramePool::release(frame);
+    }
+    FrameHeader header;
+    std::string payload;
+    for (int i = 0; i < HELD_FRAMES; i++) {
+        CHECK(b.recv(header, payload));
+        CHECK(payload == "h" + std::to_string(i));
+    }
+    Mailbox::read(now);
+    CHECK_EQ(now.dropped, before.dropped);
+    CHECK_EQ(now.delivered - before.delivered, HELD_FRAMES);
+    CHECK_EQ(now.pending, 0);
+    CHECK(waitFor([] { return FramePool::available() == AppCfg::FRAME_POOL_SIZE; }));
+}
+
+int main() {
+    startServer(PORT);
+    test_reconnect_order();
+    test_pool_exhausted();
+    printf("test_mailbox passed\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * 多客户端负载: 注册表填满后每个客户端同时收发, 环形单播, 组播与广播扇出,
+ * 帧内容与顺序逐一校验, 不丢帧, 结束后缓冲池帧全部归还
+ */
+#include "harness.h"
+#include "frame_pool.h"
+#include "metrics.h"
+#include "app_config.h"
+
+#include <memory>
+#include <string>
+
+using namespace Harness;
+using TcpDataHandle::GROUP_ID_BASE;
+using TcpDataHandle::BROADCAST_ID;
+
+static constexpr uint16_t PORT = 19007;
+static constexpr int CLIENTS = AppCfg::TCP_MAX_CLIENTS;
+static constexpr int ROUNDS = 20;
+static constexpr uint8_t GROUP = 5;
+static_assert(CLIENTS >= 100, "built with CONFIG_LWIP_MAX_SOCKETS raised for this test");
+
+static std::unique_ptr<Client> _clients[CLIENTS];
+
+static Client& client(int i) {
+    return *_clients[i % CLIENTS];
+}
+
+static void connect_all() {
+    int64_t start = now();
+    for (int i = 0; i < CLIENTS; i++) {
+        _clients[i].reset(new Client);
+        CHECK(_clients[i]->connect(PORT, 2 + i));
+        CHECK(!_clients[i]->command("mark x").empty());
+    }
+    CHECK_EQ(TcpServer::clientCount(), CLIENTS);
+    printf("%d clients connected in %.1f ms\n", CLIENTS, (now() - start) / 1000.0);
+}
+
+// 每轮每个客户端向下一个发一帧, 再各自收一帧; 发送交错, 服务器同时有CLIENTS个连接可读
+static void ring_relay() {
+    int64_t start = now();
+    FrameHeader header;
+    std::string payload;
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < CLIENTS; i++) {
+            std::string data = std::to_string(i) + ":" + std::to_string(round);
+            CHECK(client(i).send(client(i + 1).id(), FrameType::BINARY, data));
+        }
+        for (int i = 0; i < CLIENTS; i++) {
+            int from = (i + CLIENTS - 1) % CLIENTS;
+            CHECK(client(i).recv(header, payload));
+            CHECK_EQ(header.source, client(from).id());
+            CHECK(payload == std::to_string(from) + ":" + std::to_string(round));
+        }
+    }
+    printf("ring relay %d frames in %.1f ms\n", CLIENTS * ROUNDS, (now() - start) / 1000.0);
+}
+
+// 一半客户端订阅组播, 组播与广播各由不同客户端发出
+static void fanout() {
+    for (int i = 0; i < CLIENTS; i += 2) {
+        CHECK(client(i).command("group join 5").find("succeed") != std::string::npos);
+    }
+    FrameHeader header;
+    std::string payload;
+    for (int n = 0; n < 5; n++) {
+        // 发送者不在组内(奇数), 组播不回送发送者
+        Client& source = client(n * 6 + 1);
+        CHECK(source.send(GROUP_ID_BASE + GROUP, FrameType::BINARY, "group " + std::to_string(n)));
+        for (int i = 0; i < CLIENTS; i += 2) {
+            CHECK(client(i).recv(header, payload));
+            CHECK(payload == "group " + std::to_string(n));
+        }
+        CHECK(source.send(BROADCAST_ID, FrameType::BINARY, "all " + std::to_string(n)));
+        for (int i = 0; i < CLIENTS; i++) {
+            if (&client(i) == &source) continue;
+            CHECK(client(i).recv(header, payload));
+            CHECK_EQ(header.source, source.id());
+            CHECK(payload == "all " + std::to_string(n));
+        }
+    }
+}
+
+int main() {
+    startServer(PORT);
+    uint32_t drops = Metrics::get(Metrics::TX_DROPS);
+    connect_all();
+    ring_relay();
+    fanout();
+    CHECK_EQ(Metrics::get(Metrics::TX_DROPS) - drops, 0);
+    CHECK(waitFor([] { return FramePool::available() == AppCfg::FRAME_POOL_SIZE; }));
+    for (auto& c : _clients) c->close();
+    CHECK(waitFor([] { return TcpServer::clientCount() == 0; }));
+    printf("test_many_clients passed\n");
+    return 0;
+}
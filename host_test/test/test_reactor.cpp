@@ -0,0 +1,181 @@
+/*
+ * 反应堆模式: 会阻塞的命令(wifi, 替身中耗时1秒)交给命令任务执行,
+ * 期间其它连接的命令与转发不受影响, 同一连接的应答保持发送顺序.
+ */
+#include "harness.h"
+#include "frame_pool.h"
+#include "app_config.h"
+#include "cmds.h"
+#include "metrics.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace Harness;
+using TcpDataHandle::SERVER_ID;
+
+static constexpr uint16_t PORT = 19001;
+static constexpr int FAST_MS = 300;         // 非阻塞命令的应答时限, 远小于wifi的1秒
+
+static std::string recv_cmd(Client& client, FrameType type = FrameType::CMD, int timeout_ms = 3000) {
+    FrameHeader header;
+    std::string reply;
+    CHECK(client.recv(header, reply, timeout_ms));
+    CHECK_EQ(header.type, type);
+    return reply;
+}
+
+// 另一连接在wifi执行期间的PING, 命令与转发
+static void check_others_not_blocked(Client& other, Client& peer) {
+    int64_t start = now();
+    CHECK(other.send(SERVER_ID, FrameType::PING, "ping"));
+    CHECK(recv_cmd(other, FrameType::PONG) == "ping");
+    CHECK(other.command("mark nobody").find("\"mark\":0") != std::string::npos);
+
+    FrameHeader header;
+    std::string payload;
+    CHECK(other.send(peer.id(), FrameType::BINARY, "relay"));
+    CHECK(peer.recv(header, payload));
+    CHECK(payload == "relay");
+    CHECK((now() - start) / 1000 < FAST_MS);
+}
+
+static void test_text_command() {
+    Client a, b, c;
+    CHECK(a.connect(PORT, 2) && b.connect(PORT, 3) && c.connect(PORT, 4));
+    // 确认三者都已登记
+    CHECK(!a.command("mark x").empty() && !b.command("mark x").empty() && !c.command("mark x").empty());
+
+    int64_t start = now();
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "wifi router 12345678"));
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "mark nobody"));
+    sleepMs(20);
+    check_others_not_blocked(b, c);
+
+    // a的应答: 先wifi后mark
+    CHECK(recv_cmd(a).find("succeed") != std::string::npos);
+    CHECK((now() - start) / 1000 >= 900);
+    CHECK(recv_cmd(a).find("\"mark\":0") != std::string::npos);
+    // 命令任务执行完后恢复内联处理
+    start = now();
+    CHECK(!a.command("mark x").empty());
+    CHECK((now() - start) / 1000 < FAST_MS);
+}
+
+static void test_binary_command() {
+    Client a, b, c;
+    CHECK(a.connect(PORT, 5) && b.connect(PORT, 6) && c.connect(PORT, 7));
+    CHECK(!a.command("mark x").empty() && !b.command("mark x").empty() && !c.command("mark x").empty());
+
+    uint8_t request[] = {cmds::OP_WIFI, TcpDataHandle::TLV_STR, 1, 'r', TcpDataHandle::TLV_STR, 1, 'p'};
+    CHECK(a.send(SERVER_ID, FrameType::BCMD, request, sizeof(request)));
+    sleepMs(20);
+    check_others_not_blocked(b, c);
+    std::string reply = recv_cmd(a, FrameType::BCMD);
+    CHECK_EQ((uint8_t)reply[0], cmds::OP_WIFI);
+    CHECK(reply.find("succeed") != std::string::npos);
+}
+
+// 命令队列已满时回复忙; 空的BCMD帧的忙应答没有操作码字节
+static void test_busy() {
+    Client a;
+    CHECK(a.connect(PORT, 12));
+    CHECK(!a.command("mark x").empty());
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "wifi router 12345678"));
+    sleepMs(20);
+    for (int i = 0; i < AppCfg::CMD_TASK_QUEUE; i++) {
+        CHECK(a.send(SERVER_ID, FrameType::CMD, "mark x"));
+    }
+    CHECK(a.send(SERVER_ID, FrameType::BCMD, "", 0));
+    std::string reply = recv_cmd(a, FrameType::BCMD, FAST_MS);
+    CHECK(reply[0] == '{' && reply.find("busy") != std::string::npos);
+    CHECK(recv_cmd(a).find("succeed") != std::string::npos);
+    for (int i = 0; i < AppCfg::CMD_TASK_QUEUE; i++) {
+        CHECK(recv_cmd(a).find("\"mark\":") != std::string::npos);
+    }
+}
+
+// 命令排队期间连接断开: 命令被丢弃, 缓冲池帧全部归还, 新连接不受影响
+static void test_disconnect_while_deferred() {
+    Client a, b;
+    CHECK(a.connect(PORT, 8) && b.connect(PORT, 9));
+    CHECK(!a.command("mark x").empty());
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "wifi router 12345678"));
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "wifi router 12345678"));
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "mark x"));
+    sleepMs(20);
+    a.close();
+
+    CHECK(!b.command("mark x").empty());
+    CHECK(waitFor([] { return FramePool::available() == AppCfg::FRAME_POOL_SIZE; }, 3000));
+    CHECK(a.connect(PORT, 8));
+    CHECK(!a.command("mark x", 3000).empty());
+}
+
+// list应答中某个IP的客户端的套接字号
+static int list_sock(Client& client, const std::string& ip) {
+    std::string list = client.command("list");
+    size_t pos = list.find("\"ip\":\"" + ip + "\"");
+    if (pos == std::string::npos) return -1;
+    pos = list.find("\"sock\":", pos);
+    return pos == std::string::npos ? -1 : atoi(list.c_str() + pos + 7);
+}
+
+/**
+ * 命令排队期间断开并立即从同一地址重连: 新连接复用同一槽位与套接字号,
+ * 旧连接排队的命令不得在新连接上执行或应答, 新连接的命令也不排在它们后面
+*/
+static void test_reconnect_while_deferred() {
+    Client a, b;
+    CHECK(a.connect(PORT, 10) && b.connect(PORT, 11));
+    CHECK(!a.command("mark x").empty() && !b.command("mark x").empty());
+    int old_sock = list_sock(b, "127.0.0.10");
+    CHECK(old_sock >= 0);
+
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "wifi router 12345678"));
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "login stale"));
+    CHECK(a.send(SERVER_ID, FrameType::CMD, "mark stale"));
+    sleepMs(20);
+    a.close();
+    CHECK(waitFor([] { return TcpServer::findSocketById(10) < 0; }));
+    CHECK(a.connect(PORT, 10));
+    // 等到新连接登记
+    // 服务器先关闭旧套接字再接受新连接, 取到的是同一个(最小的空闲)套接字号
+    CHECK(waitFor([&b, old_sock] { return list_sock(b, "127.0.0.10") == old_sock; }));
+
+    int64_t start = now();
+    CHECK(a.command("mark x").find("\"mark\":") != std::string::npos);
+    CHECK((now() - start) / 1000 < FAST_MS);
+    // wifi执行完后也没有旧命令的应答, 名称未被改写
+    FrameHeader header;
+    std::string payload;
+    CHECK(!a.recv(header, payload, 1500));
+    CHECK(b.command("list").find("stale") == std::string::npos);
+    CHECK(waitFor([] { return FramePool::available() == AppCfg::FRAME_POOL_SIZE; }, 3000));
+}
+
+// 每个接受的连接计数一次
+static void test_connect_metric() {
+    uint32_t before = Metrics::get(Metrics::CONNECTS);
+    {
+        Client a, b, c;
+        CHECK(a.connect(PORT, 2) && b.connect(PORT, 3) && c.connect(PORT, 4));
+        CHECK(waitFor([before] { return Metrics::get(Metrics::CONNECTS) - before == 3; }));
+        CHECK(!a.command("mark x").empty());
+    }
+    sleepMs(100);
+    CHECK_EQ(Metrics::get(Metrics::CONNECTS) - before, 3);
+}
+
+int main() {
+    startServer(PORT);
+    // 最先运行, 此时服务器没有空闲的低套接字号, 重连必然复用旧连接的套接字号
+    test_reconnect_while_deferred();
+    test_connect_metric();
+    test_text_command();
+    test_binary_command();
+    test_busy();
+    test_disconnect_while_deferred();
+    printf("test_reactor passed\n");
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * 发送队列: 直接发送失败时post()返回错误, 排队深度计入直通转发期间暂存的帧,
+ * 断开后的连接不再接受投递
+ */
+#include "harness.h"
+#include "frame_pool.h"
+#include "tcp_sender.h"
+#include "tcp_server.h"
+#include "app_config.h"
+
+#include <cstring>
+#include <sys/socket.h>
+
+using namespace Harness;
+
+static constexpr uint16_t PORT = 19008;
+
+static bool pool_full() {
+    return FramePool::available() == AppCfg::FRAME_POOL_SIZE;
+}
+
+static FramePool::Frame* make_frame(uint8_t goal, const char* text) {
+    FramePool::Frame* frame = FramePool::alloc();
+    CHECK(frame != nullptr);
+    FrameHeader header = {TcpDataHandle::FRAME_HEAD, FrameType::BINARY, goal, TcpDataHandle::SERVER_ID,
+                          (uint32_t)strlen(text)};
+    memcpy(frame->data, &header, sizeof(header));
+    memcpy(frame->data + sizeof(header), text, strlen(text));
+    frame->len = sizeof(header) + strlen(text);
+    return frame;
+}
+
+// 暂存的帧计入depth, 流结束后按顺序送达
+static void test_deferred_depth() {
+    Client a;
+    CHECK(a.connect(PORT, 2));
+    CHECK(!a.command("mark x").empty());
+    int sock = TcpServer::findSocketById(a.id());
+    int slot = TcpServer::findSlotById(a.id());
+    CHECK(sock >= 0 && slot >= 0);
+
+    constexpr int OWNER = 1000;         // 不存在的源连接
+    CHECK_EQ(TcpSender::streamBegin(sock, OWNER), 0);
+    for (int i = 0; i < 3; i++) {
+        CHECK(TcpSender::post(sock, make_frame(a.id(), "deferred")) > 0);
+    }
+    TcpSender::Stats stats;
+    CHECK(TcpSender::getStats(slot, stats));
+    CHECK_EQ(stats.depth, 3);
+    TcpSender::streamEnd(sock, OWNER);
+
+    FrameHeader header;
+    std::string payload;
+    for (int i = 0; i < 3; i++) {
+        CHECK(a.recv(header, payload));
+        CHECK(payload == "deferred");
+    }
+    CHECK(waitFor(pool_full));
+}
+
+// 连接空闲时直接发送, 发送出错返回-1而不是帧长, 帧已释放
+static void test_send_error() {
+    Client a;
+    CHECK(a.connect(PORT, 3));
+    CHECK(!a.command("mark x").empty());
+    int sock = TcpServer::findSocketById(a.id());
+    CHECK(sock >= 0);
+    // 服务器端关闭写方向, 之后sendmsg()返回EPIPE, 连接仍在注册表中
+    shutdown(sock, SHUT_WR);
+    CHECK_EQ(TcpSender::post(sock, make_frame(a.id(), "lost")), -1);
+    CHECK(pool_full());
+}
+
+// 连接断开后对其套接字号的投递失败, 不重新启用发送队列
+static void test_post_after_close() {
+    Client a;
+    CHECK(a.connect(PORT, 4));
+    CHECK(!a.command("mark x").empty());
+    int sock = TcpServer::findSocketById(a.id());
+    a.close();
+    CHECK(waitFor([] { return TcpServer::findSocketById(4) < 0; }));
+    CHECK_EQ(TcpSender::post(sock, make_frame(4, "late")), -1);
+    CHECK(pool_full());
+}
+
+int main() {
+    startServer(PORT);
+    test_deferred_depth();
+    test_send_error();
+    test_post_after_close();
+    printf("test_sender passed\n");
+    return 0;
+}
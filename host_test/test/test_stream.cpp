@@ -0,0 +1,127 @@
+/*
+ * 大帧直通转发: 数据完整性, 流期间其它帧的顺序, 源连接中途断开
+ */
+#include "harness.h"
+#include "frame_pool.h"
+#include "app_config.h"
+
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace Harness;
+using Bytes = std::vector<uint8_t>;
+
+static constexpr uint16_t PORT = 19002;
+
+static Bytes pattern(uint32_t len, uint32_t seed) {
+    Bytes data(len);
+    uint32_t x = seed * 2654435761u + 1;
+    for (uint32_t i = 0; i < len; i++) {
+        x = x * 1103515245u + 12345u;
+        data[i] = (uint8_t)(x >> 16);
+    }
+    return data;
+}
+
+// 直通转发整帧, 目标收到的帧与发送的逐字节相同, 之后的小帧不受影响
+static void test_round_trip() {
+    Client a, b;
+    CHECK(a.connect(PORT, 2) && b.connect(PORT, 3));
+    CHECK(!a.command("mark x").empty() && !b.command("mark x").empty());
+
+    Bytes data = pattern(512 * 1024, 1);
+    int64_t start = now();
+    // 由另一线程发送, 避免双方套接字缓冲都满时互相等待
+    std::thread sender([&] {
+        CHECK(a.send(b.id(), FrameType::BINARY, data.data(), data.size()));
+        CHECK(a.send(b.id(), FrameType::BINARY, "tail"));
+    });
+    FrameHeader header;
+    Bytes got(data.size());
+    uint32_t len = 0;
+    CHECK(b.recv(header, got.data(), got.size(), len, 5000));
+    sender.join();
+    CHECK_EQ(header.type, FrameType::BINARY);
+    CHECK_EQ(header.source, a.id());
+    CHECK_EQ(len, data.size());
+    CHECK(got == data);
+    printf("stream relay %u KB in %.1f ms\n", (unsigned)(data.size() / 1024), (now() - start) / 1000.0);
+
+    std::string tail;
+    CHECK(b.recv(header, tail));
+    CHECK(tail == "tail");
+}
+
+// 流期间发往同一目标的其它帧暂存, 流结束后送达, 不插入流中间
+static void test_deferred_during_stream() {
+    Client a, b, c;
+    CHECK(a.connect(PORT, 4) && b.connect(PORT, 5) && c.connect(PORT, 6));
+    CHECK(!a.command("mark x").empty() && !b.command("mark x").empty() && !c.command("mark x").empty());
+
+    Bytes data = pattern(64 * 1024, 2);
+    FrameHeader header = {TcpDataHandle::FRAME_HEAD, FrameType::BINARY, b.id(), a.id(), (uint32_t)data.size()};
+    CHECK(a.sendRaw(&header, sizeof(header)));
+    CHECK(a.sendRaw(data.data(), data.size() / 2));
+    sleepMs(50);
+    CHECK(c.send(b.id(), FrameType::BINARY, "from c"));
+    sleepMs(50);
+    CHECK(a.sendRaw(data.data() + data.size() / 2, data.size() - data.size() / 2));
+
+    Bytes got(data.size());
+    uint32_t len = 0;
+    CHECK(b.recv(header, got.data(), got.size(), len));
+    CHECK_EQ(header.source, a.id());
+    CHECK(got == data);
+    std::string payload;
+    CHECK(b.recv(header, payload));
+    CHECK_EQ(header.source, c.id());
+    CHECK(payload == "from c");
+}
+
+/**
+ * 源连接在流中途断开: 目标已收到帧头与部分数据, 此后再发任何帧都会错位,
+ * 因此服务器关闭目标连接而不是补齐或截断, 目标读到的数据少于帧长后即EOF.
+*/
+static void test_source_disconnect() {
+    Client a, b;
+    CHECK(a.connect(PORT, 7) && b.connect(PORT, 8));
+    CHECK(!a.command("mark x").empty() && !b.command("mark x").empty());
+
+    Bytes data = pattern(256 * 1024, 3);
+    FrameHeader header = {TcpDataHandle::FRAME_HEAD, FrameType::BINARY, b.id(), a.id(), (uint32_t)data.size()};
+    CHECK(a.sendRaw(&header, sizeof(header)));
+    CHECK(a.sendRaw(data.data(), 40 * 1024));
+    sleepMs(50);
+    a.close();
+
+    CHECK(b.recvRaw(&header, sizeof(header)));
+    CHECK_EQ(header.length, data.size());
+    Bytes got(data.size());
+    uint32_t received = 0;
+    while (1) {
+        struct pollfd pfd = {b.fd(), POLLIN, 0};
+        CHECK(poll(&pfd, 1, 2000) == 1);
+        ssize_t n = ::recv(b.fd(), got.data() + received, got.size() - received, 0);
+        if (n <= 0) break;
+        received += n;
+    }
+    CHECK(received <= 40 * 1024);
+    CHECK(memcmp(got.data(), data.data(), received) == 0);
+
+    // 两端的发送队列与重组缓冲都已释放
+    CHECK(waitFor([] { return FramePool::available() == AppCfg::FRAME_POOL_SIZE; }));
+    CHECK(b.connect(PORT, 8));
+    CHECK(!b.command("mark x").empty());
+}
+
+int main() {
+    startServer(PORT);
+    test_round_trip();
+    test_deferred_during_stream();
+    test_source_disconnect();
+    printf("test_stream passed\n");
+    return 0;
+}
@@ -20,8 +20,29 @@ typedef struct {
 } button_gpio_config_t;
 
 
-// 获取按键值
+typedef enum {
+    BUTTON_PRESS,                   // 按下(已消抖)
+    BUTTON_RELEASE,                 // 松开
+    BUTTON_LONG_PRESS,              // 按住超过长按时长, 每次按下只产生一次
+    BUTTON_REPEAT,                  // 长按之后按连发间隔重复产生
+    BUTTON_DOUBLE_CLICK,            // 紧跟在第二次按下的BUTTON_PRESS之后
+} button_event_type_t;
+
+typedef struct {
+    int32_t key_pin;
+    button_event_type_t type;
+} button_event_t;
+
+typedef void (*button_callback_t)(const button_event_t *event);
+
+// 阻塞等待下一次按下, 返回按键引脚
 void button_get_key_value(int32_t *num);
+// 取出一个按键事件, wait_ms为UINT32_MAX时一直等待; 超时返回false
+bool button_get_event(button_event_t *event, uint32_t wait_ms);
+// 注册按键回调, 在定时器服务任务中调用, 回调内不可阻塞; 注册后事件不再供button_get_event()取出
+void button_register_callback(button_callback_t cb);
+// 事件环满被丢弃的事件数
+uint32_t button_dropped_events();
 // 初始化gpio创建按键
 void my_key_init();
 
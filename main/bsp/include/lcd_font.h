@@ -2,7 +2,10 @@
 #define __LCDFONT_H 	   
 
 
-const unsigned char ascii_1608[][16]={
+#include <stdint.h>
+
+// 每字节一行, bit0为最左像素
+constexpr unsigned char ascii_1608[][16]={
 {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},/*" ",0*/
 {0x00,0x00,0x00,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x00,0x00,0x18,0x18,0x00,0x00},/*"!",1*/
 {0x00,0x48,0x6C,0x24,0x12,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},/*""",2*/
@@ -100,6 +103,50 @@ const unsigned char ascii_1608[][16]={
 {0x0C,0x32,0xC2,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},/*"~",94*/
 }; 
 
+#define LCD_FONT_GLYPHS     (sizeof(ascii_1608) / sizeof(ascii_1608[0]))
+
+/*--------------------------------------------
+ 其它字号由ascii_1608在编译期生成, 每行width/8字节, 低字节在左
+--------------------------------------------*/
+template <int BYTES>
+struct lcd_glyph_table_t {
+    uint8_t glyph[LCD_FONT_GLYPHS][BYTES];
+};
+
+// 16x32: 横竖各放大2倍
+constexpr lcd_glyph_table_t<64> lcd_font_scale2()
+{
+    lcd_glyph_table_t<64> out{};
+    for (unsigned g = 0; g < LCD_FONT_GLYPHS; g++) {
+        for (int r = 0; r < 16; r++) {
+            uint16_t wide = 0;
+            for (int j = 0; j < 8; j++) {
+                if (ascii_1608[g][r] & (0x01 << j)) wide |= 0x03 << (2 * j);
+            }
+            for (int k = 0; k < 2; k++) {
+                out.glyph[g][(2 * r + k) * 2] = wide & 0xFF;
+                out.glyph[g][(2 * r + k) * 2 + 1] = wide >> 8;
+            }
+        }
+    }
+    return out;
+}
+
+// 8x8: 相邻两行合并, 笔画不丢失
+constexpr lcd_glyph_table_t<8> lcd_font_half()
+{
+    lcd_glyph_table_t<8> out{};
+    for (unsigned g = 0; g < LCD_FONT_GLYPHS; g++) {
+        for (int r = 0; r < 8; r++) {
+            out.glyph[g][r] = ascii_1608[g][2 * r] | ascii_1608[g][2 * r + 1];
+        }
+    }
+    return out;
+}
+
+constexpr lcd_glyph_table_t<64> ascii_3216 = lcd_font_scale2();
+constexpr lcd_glyph_table_t<8> ascii_0808 = lcd_font_half();
+
 
 #endif /* LCD_FONT_H*/
 
@@ -22,6 +22,11 @@
 #define COLOR_GOLDEN        0xA0FE      // 金
 #define COLOR_ORANGE        0x20FD      // 橙
 
+// 字号
+#define LCD_FONT_8X16       0           // 默认
+#define LCD_FONT_16X32      1
+#define LCD_FONT_8X8        2
+
 // 显示类型定义
 #define LCD_CLEAR           1
 #define LCD_LINE            2
@@ -44,6 +49,7 @@ typedef struct {
     uint16_t y_end;                     // 终点Y坐标
     uint16_t color;                     // 文字颜色
     uint16_t back_color;                // 背景颜色
+    uint8_t  font;                      // 字号(LCD_CHAR/LCD_STRING)
 } lcd_data_frame_t;
 
 
@@ -51,8 +57,12 @@ typedef struct {
 
 // 初始化LCD
 void lcd_st7735_init();
-// 显示数据帧发送函数
+// 显示数据帧绘制函数, 只画到帧缓冲
 void lcd_frame_display_data(lcd_data_frame_t *data);
+// 把帧缓冲中改动过的区域推送到屏幕
+void lcd_flush();
+// 开关屏幕: 关闭时熄灭背光并让ST7735进入睡眠, 显存内容保留; 开启约需120ms
+void lcd_set_power(bool on);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef TF_CARD_H
+#define TF_CARD_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+
+// 挂载TF卡(SPI模式, FAT文件系统)到 AppCfg::TF_MOUNT_POINT, 已挂载时直接返回ESP_OK
+esp_err_t tf_card_mount();
+// 是否已挂载, 未插卡时写TF卡的功能应自行降级
+bool tf_card_mounted();
+
+#endif
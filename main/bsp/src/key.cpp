@@ -1,31 +1,158 @@
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
 
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
 #include "esp_log.h"
 #include "key.h"
 
 #define TAG         "key"
 
-#define KEY_SCAN_INTERVAL_MS        60          // 按键扫描间隔(消抖时长)
+#define BUTTON_DEBOUNCE_MS          20          // 边沿后等待该时长再采样电平(消抖)
+#define BUTTON_LONG_PRESS_MS        800         // 按住超过该时长产生长按事件
+#define BUTTON_REPEAT_MS            150         // 长按后的连发间隔
+#define BUTTON_DOUBLE_CLICK_MS      300         // 两次按下间隔小于该值产生双击事件
+#define BUTTON_EVENT_RING_SIZE      16          // 事件环深度, 2的幂
+
+static_assert((BUTTON_EVENT_RING_SIZE & (BUTTON_EVENT_RING_SIZE - 1)) == 0, "ring size must be a power of 2");
 
-static QueueHandle_t  key_queue = NULL;
+static button_callback_t key_callback = NULL;
 
 typedef struct key_dev{
     int key_pin;
     uint8_t active_level;
+    bool pressed;                   // 消抖后的按键状态
+    bool long_sent;                 // 本次按下已产生长按事件
+    TickType_t last_press;          // 上次按下的时刻, 用于双击判断
+    TimerHandle_t debounce_timer;   // 单次定时器, 中断中启动, 到期后采样电平
+    TimerHandle_t hold_timer;       // 单次定时器, 按住期间产生长按/连发事件
     struct key_dev *next;
 } btn_dev_t;
 
 static btn_dev_t *btn_head_handle = NULL;
 
+/**
+ * 按键事件环: 单生产者(定时器服务任务)单消费者, 无锁
+ * 注册回调时由生产者直接取出分发, 否则由button_get_event()的调用者取出.
+*/
+static button_event_t event_ring[BUTTON_EVENT_RING_SIZE];
+static std::atomic<uint32_t> ring_head(0);         // 消费者写
+static std::atomic<uint32_t> ring_tail(0);         // 生产者写
+static std::atomic<uint32_t> ring_dropped(0);
+static TaskHandle_t waiting_task = NULL;
+
+static bool ring_pop(button_event_t *event)
+{
+    uint32_t head = ring_head.load(std::memory_order_relaxed);
+    if (head == ring_tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    *event = event_ring[head & (BUTTON_EVENT_RING_SIZE - 1)];
+    ring_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+static void emit_event(btn_dev_t *button, button_event_type_t type)
+{
+    uint32_t tail = ring_tail.load(std::memory_order_relaxed);
+    if (tail - ring_head.load(std::memory_order_acquire) >= BUTTON_EVENT_RING_SIZE) {
+        ring_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    event_ring[tail & (BUTTON_EVENT_RING_SIZE - 1)] = {button->key_pin, type};
+    ring_tail.store(tail + 1, std::memory_order_release);
+
+    if (key_callback != NULL) {
+        button_event_t event;
+        while (ring_pop(&event)) {
+            key_callback(&event);
+        }
+    } else if (waiting_task != NULL) {
+        xTaskNotifyGive(waiting_task);
+    }
+}
+
+/**
+ * 电平变化中断: 关闭本引脚中断后启动消抖定时器, 抖动期间不再进入中断,
+ * 定时器到期时重新打开中断再采样. 定时器命令队列满导致启动失败时立即恢复中断,
+ * 由下一个边沿重试, 不会因此永久失去按键
+*/
+static void IRAM_ATTR button_isr(void *arg)
+{
+    btn_dev_t *button = (btn_dev_t *)arg;
+    BaseType_t woken = pdFALSE;
+    gpio_intr_disable((gpio_num_t )button->key_pin);
+    if (xTimerResetFromISR(button->debounce_timer, &woken) != pdPASS) {
+        gpio_intr_enable((gpio_num_t )button->key_pin);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+static void debounce_timer_cb(TimerHandle_t timer)
+{
+    btn_dev_t *button = (btn_dev_t *)pvTimerGetTimerID(timer);
+    // 先打开中断再采样, 采样之后的边沿会再次启动定时器
+    gpio_intr_enable((gpio_num_t )button->key_pin);
+    bool pressed = gpio_get_level((gpio_num_t )button->key_pin) == button->active_level;
+    if (pressed == button->pressed) {
+        return;
+    }
+    button->pressed = pressed;
+
+    if (!pressed) {
+        xTimerStop(button->hold_timer, 0);
+        emit_event(button, BUTTON_RELEASE);
+        return;
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    emit_event(button, BUTTON_PRESS);
+    if (button->last_press != 0 && now - button->last_press < pdMS_TO_TICKS(BUTTON_DOUBLE_CLICK_MS)) {
+        emit_event(button, BUTTON_DOUBLE_CLICK);
+        button->last_press = 0;
+    } else {
+        button->last_press = now;
+    }
+    button->long_sent = false;
+    xTimerChangePeriod(button->hold_timer, pdMS_TO_TICKS(BUTTON_LONG_PRESS_MS), 0);
+}
+
+static void hold_timer_cb(TimerHandle_t timer)
+{
+    btn_dev_t *button = (btn_dev_t *)pvTimerGetTimerID(timer);
+    if (!button->pressed) {
+        return;
+    }
+    emit_event(button, button->long_sent ? BUTTON_REPEAT : BUTTON_LONG_PRESS);
+    button->long_sent = true;
+    xTimerChangePeriod(button->hold_timer, pdMS_TO_TICKS(BUTTON_REPEAT_MS), 0);
+}
+
 esp_err_t button_create(button_gpio_config_t *config)
 {
-    /** config gpio */
+    /** config button handle node*/
+    btn_dev_t *button = (btn_dev_t *)calloc(1, sizeof(btn_dev_t));
+    if  (button == NULL) {
+        ESP_LOGE(TAG, "Button memory alloc failed");
+        return ESP_FAIL;
+    }
+    button->key_pin = config->gpio_num;
+    button->active_level = config->active_level;
+    button->debounce_timer = xTimerCreate("key_debounce", pdMS_TO_TICKS(BUTTON_DEBOUNCE_MS), pdFALSE, button, debounce_timer_cb);
+    button->hold_timer = xTimerCreate("key_hold", pdMS_TO_TICKS(BUTTON_LONG_PRESS_MS), pdFALSE, button, hold_timer_cb);
+    if (button->debounce_timer == NULL || button->hold_timer == NULL) {
+        ESP_LOGE(TAG, "Button timer create failed");
+        free(button);
+        return ESP_FAIL;
+    }
+
+    /** config gpio, 双边沿中断 */
     gpio_config_t gpio_conf;
-    gpio_conf.intr_type = GPIO_INTR_DISABLE;
+    gpio_conf.intr_type = GPIO_INTR_ANYEDGE;
     gpio_conf.mode = GPIO_MODE_INPUT;
     gpio_conf.pin_bit_mask = (1ULL << config->gpio_num);
     if (config->active_level) {
@@ -36,15 +163,7 @@ esp_err_t button_create(button_gpio_config_t *config)
         gpio_conf.pull_up_en = GPIO_PULLUP_ENABLE;
     }
     gpio_config(&gpio_conf);
-
-    /** config button handle node*/
-    btn_dev_t *button = (btn_dev_t *)malloc (sizeof(btn_dev_t));
-    if  (button == NULL) {
-        ESP_LOGE(TAG, "Button memory alloc failed");
-        return ESP_FAIL;
-    }
-    button->key_pin = config->gpio_num;
-    button->active_level = config->active_level;
+    gpio_isr_handler_add((gpio_num_t )config->gpio_num, button_isr, button);
 
     /** Add handle to list */
     button->next = btn_head_handle;
@@ -54,41 +173,38 @@ esp_err_t button_create(button_gpio_config_t *config)
 
 }
 
+bool button_get_event(button_event_t *event, uint32_t wait_ms)
+{
+    waiting_task = xTaskGetCurrentTaskHandle();
+    TickType_t wait = wait_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms);
+    while (!ring_pop(event)) {
+        if (ulTaskNotifyTake(pdTRUE, wait) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * get key value
 */
 void button_get_key_value(int32_t *num)
 {
-    xQueueReceive(key_queue, num, portMAX_DELAY);
+    button_event_t event;
+    do {
+        button_get_event(&event, UINT32_MAX);
+    } while (event.type != BUTTON_PRESS);
+    *num = event.key_pin;
 }
 
-static void key_scan_task(void *pvParameter)
+void button_register_callback(button_callback_t cb)
 {
-    ESP_LOGD(TAG, "key scan start");
-    btn_dev_t *target = NULL;
-    int32_t key_state_mask = 0;
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(KEY_SCAN_INTERVAL_MS));
-
-        /** ergod all button device*/
-        for (target = btn_head_handle; target; target = target->next) {
-            int status = gpio_get_level((gpio_num_t )target->key_pin);
-            if (status == target->active_level) {
-                int32_t pin_bit_mask = (1ULL << target->key_pin);
-                if (key_state_mask & pin_bit_mask) {
-                    int32_t key_pin = target->key_pin;
-                    key_state_mask &= ~pin_bit_mask;
-                    xQueueSend(key_queue, &key_pin, 10 / portTICK_PERIOD_MS);
-                } else {
-                    /** wait next callback debounce*/
-                    key_state_mask |= pin_bit_mask;
-                }
-                
-            }
-        }
-        
-    }
+    key_callback = cb;
+}
 
+uint32_t button_dropped_events()
+{
+    return ring_dropped.load(std::memory_order_relaxed);
 }
 
 void my_key_init()
@@ -98,6 +214,13 @@ void my_key_init()
     gpio_set_direction((gpio_num_t )RGB_LED_PIN, GPIO_MODE_OUTPUT);
     gpio_set_level((gpio_num_t )RGB_LED_PIN, 0);
 
+    // 中断服务可能已由其它驱动安装, 重复安装返回ESP_ERR_INVALID_STATE
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "gpio isr service install failed");
+        return;
+    }
+
     button_gpio_config_t btn_config;
 
     btn_config.gpio_num = KEY_UP_PIN;
@@ -112,10 +235,4 @@ void my_key_init()
 
     btn_config.gpio_num = KEY_CANCEL_PIN;
     button_create(&btn_config);
-
-    /** create key queue*/
-    key_queue = xQueueCreate(1, sizeof(int32_t));
-    /** create key scan task*/
-    xTaskCreate(key_scan_task, "key_scan_task", 1024, NULL, 2, NULL);
 }
-
@@ -4,6 +4,8 @@
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include <cstring>
+#include <cstdlib>
+#include <sys/param.h>
 
 #include "lcd_st7735.h"
 #include "lcd_font.h"
@@ -25,13 +27,48 @@ typedef struct {
 
 static spi_device_handle_t lcd_spi_dev;
 
-static uint8_t *lcd_tx_buffer = NULL;
+#define LCD_TX_BUFFERS      2       // 乒乓DMA缓冲: CPU填充一块时另一块在发送
+#define LCD_QUEUE_SIZE      16      // SPI驱动队列深度, 需覆盖一次窗口设置(5笔)加两块数据
+
+static uint8_t *lcd_tx_buffer[LCD_TX_BUFFERS] = {NULL};
+
+/* 排队传输: 事务按提交顺序完成, 用环形数组保存直到取回结果 */
+static spi_transaction_t lcd_trans[LCD_QUEUE_SIZE];
+static uint32_t lcd_trans_queued = 0;           // 已提交事务数(自由增长)
+static uint32_t lcd_trans_done = 0;             // 已完成事务数
+static uint32_t lcd_buffer_seq[LCD_TX_BUFFERS]; // 各DMA缓冲最后一次被哪笔事务使用
+
+#define LCD_DIRTY_MAX       8       // 脏矩形个数上限, 超出时强制合并
+#define LCD_MERGE_SLACK     256     // 合并多出的像素不超过该值时合并(约等于一次窗口设置的开销)
+
+typedef struct {
+    uint8_t x0, y0, x1, y1;         // 含端点
+} lcd_rect_t;
+
+static uint16_t *lcd_fb = NULL;     // RGB565帧缓冲, 字节序与发送顺序一致
+static lcd_rect_t lcd_dirty[LCD_DIRTY_MAX];
+static uint8_t lcd_dirty_count = 0;
+
+static inline int32_t lcd_rect_area(const lcd_rect_t *r)
+{
+    return (int32_t)(r->x1 - r->x0 + 1) * (r->y1 - r->y0 + 1);
+}
+
+static inline lcd_rect_t lcd_rect_union(const lcd_rect_t *a, const lcd_rect_t *b)
+{
+    lcd_rect_t r;
+    r.x0 = MIN(a->x0, b->x0);
+    r.y0 = MIN(a->y0, b->y0);
+    r.x1 = MAX(a->x1, b->x1);
+    r.y1 = MAX(a->y1, b->y1);
+    return r;
+}
 
 // This function is called (in irq context!) just before a transmission starts. It will
 // set the D/C line to the value indicated in the user field.
 void lcd_spi_pre_transfer_callback(spi_transaction_t *t)
 {
-    int dc = (int)t->user;
+    int dc = (int)(intptr_t)t->user;
     gpio_set_level((gpio_num_t )AppCfg::LCD_PIN_DC, dc);
 }
 
@@ -51,7 +88,7 @@ static void lcd_spi_init(void)
     devcfg.clock_speed_hz = 16 * 1000 * 1000;      // Clock out at 16 MHz
     devcfg.mode = 0;                               // SPI mode 0
     devcfg.spics_io_num = AppCfg::LCD_PIN_CS;      // CS pin
-    devcfg.queue_size = 3;                         // We want to be able to queue 3 transactions at a time
+    devcfg.queue_size = LCD_QUEUE_SIZE;            // 窗口设置与数据块一起排队
     devcfg.pre_cb = lcd_spi_pre_transfer_callback; // Specify pre-transfer callback to handle D/C line
     // Initialize the SPI bus
     ESP_ERROR_CHECK( spi_bus_initialize((spi_host_device_t )AppCfg::LCD_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO) );
@@ -73,10 +110,54 @@ static void lcd_spi_init(void)
     gpio_config(&io_conf);
 }
 
+// 取回一笔已完成的排队事务
+static void lcd_queue_reclaim(void)
+{
+    spi_transaction_t *done;
+    esp_err_t ret = spi_device_get_trans_result(lcd_spi_dev, &done, portMAX_DELAY);
+    assert(ret == ESP_OK);
+    (void)ret;
+    lcd_trans_done++;
+}
+
+/**
+ * 排队发送, 不等待完成; 队列满时先取回最早的一笔.
+ * len <= 4时数据拷贝进事务本身, 否则data必须保持有效直到事务完成.
+*/
+static uint32_t lcd_queue_send(const uint8_t *data, int len, int dc)
+{
+    if (lcd_trans_queued - lcd_trans_done >= LCD_QUEUE_SIZE) {
+        lcd_queue_reclaim();
+    }
+    spi_transaction_t *t = &lcd_trans[lcd_trans_queued % LCD_QUEUE_SIZE];
+    memset(t, 0, sizeof(*t));
+    t->length = len * 8;
+    t->user = (void *)(intptr_t)dc;
+    if (len <= 4) {
+        t->flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t->tx_data, data, len);
+    } else {
+        t->tx_buffer = data;
+    }
+    esp_err_t ret = spi_device_queue_trans(lcd_spi_dev, t, portMAX_DELAY);
+    assert(ret == ESP_OK);
+    (void)ret;
+    return lcd_trans_queued++;
+}
+
+// 等待所有排队事务完成(切换回阻塞传输前调用)
+static void lcd_queue_drain(void)
+{
+    while (lcd_trans_done != lcd_trans_queued) {
+        lcd_queue_reclaim();
+    }
+}
+
 static void st7735_cmd(uint8_t cmd) 
 {
     esp_err_t ret;
     spi_transaction_t t;
+    lcd_queue_drain();              // 阻塞传输不能与排队事务交错
     memset(&t, 0, sizeof(t));
     t.length = 8;
     t.flags = SPI_TRANS_USE_TXDATA;
@@ -85,6 +166,7 @@ static void st7735_cmd(uint8_t cmd)
     t.user = (void *)0;
     ret = spi_device_transmit(lcd_spi_dev, &t);     // 异步传输
     assert(ret == ESP_OK);
+    (void)ret;
 }
 
 /**
@@ -95,6 +177,7 @@ static void lcd_send_data(uint8_t *data, int len)
     esp_err_t ret;
     spi_transaction_t t;
     if (len == 0) return;
+    lcd_queue_drain();
     memset(&t, 0, sizeof(t));
     if (len > 4) {
         t.length = len * 8;
@@ -109,6 +192,16 @@ static void lcd_send_data(uint8_t *data, int len)
     
     ret = spi_device_transmit(lcd_spi_dev, &t);
     assert(ret == ESP_OK);
+    (void)ret;
+}
+
+// 取得可写的DMA缓冲, 其上一笔发送未完成时等待
+static uint8_t *lcd_buffer_acquire(int index)
+{
+    while ((int32_t)(lcd_trans_done - lcd_buffer_seq[index]) <= 0 && lcd_trans_done != lcd_trans_queued) {
+        lcd_queue_reclaim();
+    }
+    return lcd_tx_buffer[index];
 }
 
 
@@ -116,9 +209,19 @@ static void lcd_send_data(uint8_t *data, int len)
 void lcd_st7735_init()
 {
     /* malloc lcd_tx_buffer */
-    lcd_tx_buffer = (uint8_t *)heap_caps_malloc(AppCfg::LCD_MAXTRANS_SIZE, MALLOC_CAP_DMA);
-    if (lcd_tx_buffer == NULL) {
-        ESP_LOGE(TAG, "lcd_tx_buffer malloc failed");
+    for (int i = 0; i < LCD_TX_BUFFERS; i++) {
+        lcd_tx_buffer[i] = (uint8_t *)heap_caps_malloc(AppCfg::LCD_MAXTRANS_SIZE, MALLOC_CAP_DMA);
+        if (lcd_tx_buffer[i] == NULL) {
+            ESP_LOGE(TAG, "lcd_tx_buffer malloc failed");
+        }
+    }
+    /* 帧缓冲只经CPU拷贝到DMA缓冲, 优先放PSRAM */
+    lcd_fb = (uint16_t *)heap_caps_malloc(LCD_MAX_SIZE, MALLOC_CAP_SPIRAM);
+    if (lcd_fb == NULL) {
+        lcd_fb = (uint16_t *)heap_caps_malloc(LCD_MAX_SIZE, MALLOC_CAP_8BIT);
+    }
+    if (lcd_fb == NULL) {
+        ESP_LOGE(TAG, "lcd framebuffer malloc failed");
     }
 
     /* spi interface init */
@@ -195,60 +298,148 @@ void lcd_st7735_init()
     gpio_set_level((gpio_num_t )AppCfg::LCD_PIN_BCKL, 1);
 }
 
-// 设置显示区域（x0,y0）->(x1,y1)
+void lcd_set_power(bool on)
+{
+    if (on) {
+        // Sleep out后须等待120ms才能发下一条命令
+        st7735_cmd(0x11);
+        vTaskDelay(pdMS_TO_TICKS(120));
+        st7735_cmd(0x29);
+        gpio_set_level((gpio_num_t )AppCfg::LCD_PIN_BCKL, 1);
+    } else {
+        gpio_set_level((gpio_num_t )AppCfg::LCD_PIN_BCKL, 0);
+        // Display off, Sleep in
+        st7735_cmd(0x28);
+        st7735_cmd(0x10);
+    }
+}
+
+// 设置显示区域（x0,y0）->(x1,y1), 5笔事务一起排队, 不等待
 static void lcd_set_window(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
 {
+    static const uint8_t cmd_caset = 0x2A, cmd_raset = 0x2B, cmd_ramwr = 0x2C;
     uint8_t data[4];
 
     // 设置列地址范围
-    st7735_cmd(0x2A);
+    lcd_queue_send(&cmd_caset, 1, 0);
     data[0] = 0x00;
     data[1] = x0 + 0x02;
     data[2] = 0x00;
     data[3] = x1 + 0x02;
-    lcd_send_data(data, 4);
+    lcd_queue_send(data, 4, 1);
 
     // 设置行地址范围
-    st7735_cmd(0x2B);
+    lcd_queue_send(&cmd_raset, 1, 0);
     data[0] = 0x00;
     data[1] = y0 + 0x03;
     data[2] = 0x00;
     data[3] = y1 + 0x03;
-    lcd_send_data(data, 4);
+    lcd_queue_send(data, 4, 1);
 
     // 内存写入命令
-    st7735_cmd(0x2C);
+    lcd_queue_send(&cmd_ramwr, 1, 0);
 }
 
+/*--------------------------------------------
+ 帧缓冲: 所有图元先画到内存, 记录脏矩形,
+ lcd_flush()时只把改动区域按行拷贝到DMA缓冲后成块发送.
+--------------------------------------------*/
 
-static void lcd_send_word(uint16_t data)
+// 标记脏区域(含端点), 与已有矩形合并代价不大时直接合并
+static void lcd_mark_dirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
 {
-    static uint8_t temp[2];
-    temp[0] = (uint8_t) (data & 0xFF);
-    temp[1] = (uint8_t) (data >> 8);
-    lcd_send_data(temp, 2);
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > LCD_WIDTH - 1) x1 = LCD_WIDTH - 1;
+    if (y1 > LCD_HEIGHT - 1) y1 = LCD_HEIGHT - 1;
+    if (x0 > x1 || y0 > y1) return;
+
+    lcd_rect_t rect = {(uint8_t)x0, (uint8_t)y0, (uint8_t)x1, (uint8_t)y1};
+    int best = -1;
+    int32_t best_growth = INT32_MAX;
+    for (int i = 0; i < lcd_dirty_count; i++) {
+        lcd_rect_t merged = lcd_rect_union(&lcd_dirty[i], &rect);
+        int32_t growth = lcd_rect_area(&merged) - lcd_rect_area(&lcd_dirty[i]) - lcd_rect_area(&rect);
+        if (growth < best_growth) {
+            best_growth = growth;
+            best = i;
+        }
+    }
+
+    if (best >= 0 && (best_growth <= LCD_MERGE_SLACK || lcd_dirty_count >= LCD_DIRTY_MAX)) {
+        /* 合并后可能与其它矩形重叠, 继续向下合并 */
+        rect = lcd_rect_union(&lcd_dirty[best], &rect);
+        lcd_dirty[best] = lcd_dirty[--lcd_dirty_count];
+        lcd_mark_dirty(rect.x0, rect.y0, rect.x1, rect.y1);
+        return;
+    }
+    lcd_dirty[lcd_dirty_count++] = rect;
 }
 
-void lcd_fill_screen(uint16_t color)
+static inline void lcd_fb_put(int16_t x, int16_t y, uint16_t color)
 {
+    if (x < 0 || y < 0 || x >= LCD_WIDTH || y >= LCD_HEIGHT) return;
+    lcd_fb[y * LCD_WIDTH + x] = color;
+}
+
+static void lcd_fb_fill(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > LCD_WIDTH - 1) x1 = LCD_WIDTH - 1;
+    if (y1 > LCD_HEIGHT - 1) y1 = LCD_HEIGHT - 1;
+    for (int16_t y = y0; y <= y1; y++) {
+        uint16_t *row = &lcd_fb[y * LCD_WIDTH];
+        for (int16_t x = x0; x <= x1; x++) {
+            row[x] = color;
+        }
+    }
+    lcd_mark_dirty(x0, y0, x1, y1);
+}
+
+/**
+ * 把一个脏矩形推送到屏幕
+ * 两块DMA缓冲轮流使用: 一块排队发送后立即填充另一块, 拷贝与传输重叠.
+*/
+static void lcd_flush_rect(const lcd_rect_t *rect)
+{
+    static int cur = 0;
+    uint32_t row_bytes = (rect->x1 - rect->x0 + 1) * 2;
     uint32_t len = 0;
-    lcd_set_window(0, 0, LCD_WIDTH - 1, LCD_HEIGHT -1);
-    for (uint32_t i = 0; i < LCD_WIDTH * LCD_HEIGHT; i ++) {
-        *(uint16_t *)&lcd_tx_buffer[len] = color;
-        len += 2;
-        if (len >= AppCfg::LCD_MAXTRANS_SIZE) {
+    uint8_t *buf = lcd_buffer_acquire(cur);
+    lcd_set_window(rect->x0, rect->y0, rect->x1, rect->y1);
+    for (uint16_t y = rect->y0; y <= rect->y1; y++) {
+        if (len + row_bytes > AppCfg::LCD_MAXTRANS_SIZE) {
+            lcd_buffer_seq[cur] = lcd_queue_send(buf, len, 1);
+            cur = (cur + 1) % LCD_TX_BUFFERS;
+            buf = lcd_buffer_acquire(cur);
             len = 0;
-            lcd_send_data(lcd_tx_buffer, AppCfg::LCD_MAXTRANS_SIZE);        
         }
+        memcpy(&buf[len], &lcd_fb[y * LCD_WIDTH + rect->x0], row_bytes);
+        len += row_bytes;
+    }
+    lcd_buffer_seq[cur] = lcd_queue_send(buf, len, 1);
+    cur = (cur + 1) % LCD_TX_BUFFERS;
+}
+
+void lcd_flush()
+{
+    for (int i = 0; i < lcd_dirty_count; i++) {
+        lcd_flush_rect(&lcd_dirty[i]);
     }
-    lcd_send_data(lcd_tx_buffer, len);
+    lcd_dirty_count = 0;
+}
+
+void lcd_fill_screen(uint16_t color)
+{
+    lcd_fb_fill(0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1, color);
 }
 
 // 画一个像素
 void lcd_draw_pixel(uint16_t x, uint16_t y, uint16_t color) 
 {
-    lcd_set_window(x, y, x, y);
-    lcd_send_word(color);
+    lcd_fb_put(x, y, color);
+    lcd_mark_dirty(x, y, x, y);
 }
 
 
@@ -260,8 +451,9 @@ void lcd_draw_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t
     int16_t sx = x1 < x2 ? 1 : -1;
     int16_t sy = y1 < y2 ? 1 : -1;
     int16_t err = dx - dy;
+    lcd_mark_dirty(MIN(x1, x2), MIN(y1, y2), MAX(x1, x2), MAX(y1, y2));
     while (x1 != x2 || y1 != y2) {
-        lcd_draw_pixel(x1, y1, color);
+        lcd_fb_put(x1, y1, color);
         int16_t e2 = err * 2;
         if (e2 > -dy) {
             err -= dy;
@@ -273,7 +465,7 @@ void lcd_draw_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t
         }
     }
     // 绘制终点坐标
-    lcd_draw_pixel(x2, y2, color);
+    lcd_fb_put(x2, y2, color);
 }
 
 /**
@@ -281,19 +473,7 @@ void lcd_draw_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t
 */
 static void lcd_draw_fill_rectangle(uint16_t x, uint16_t y, uint16_t x_end, uint16_t y_end, uint16_t color)
 {
-    uint32_t len = 0;
-    uint32_t size = (x_end - x + 1) * (y_end - y + 1);
-    lcd_set_window(x, y, x_end, y_end);
-    for (uint32_t i = 0; i < size; i ++) {
-        *(uint16_t *)&lcd_tx_buffer[len] = color;
-        len += 2;
-        if (len >= AppCfg::LCD_MAXTRANS_SIZE) {
-            len = 0;
-            lcd_send_data(lcd_tx_buffer, AppCfg::LCD_MAXTRANS_SIZE);        
-        }
-    }
-    lcd_send_data(lcd_tx_buffer, len);
-
+    lcd_fb_fill(x, y, x_end, y_end, color);
 }
 
 
@@ -304,11 +484,12 @@ void lcd_draw_circle(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t color)
     int16_t y = radius;
     int16_t delta = 1 - 2 * radius;
     int16_t error = 0;
+    lcd_mark_dirty(cx - radius, cy - radius, cx + radius, cy + radius);
     while (y >= 0) {
-        lcd_draw_pixel(cx + x, cy + y, color);
-        lcd_draw_pixel(cx - x, cy + y, color);
-        lcd_draw_pixel(cx + x, cy - y, color);
-        lcd_draw_pixel(cx - x, cy - y, color);
+        lcd_fb_put(cx + x, cy + y, color);
+        lcd_fb_put(cx - x, cy + y, color);
+        lcd_fb_put(cx + x, cy - y, color);
+        lcd_fb_put(cx - x, cy - y, color);
 
         error = 2 * (delta + y) - 1;
         if (delta < 0 && error <= 0) {
@@ -326,54 +507,123 @@ void lcd_draw_circle(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t color)
 }
 
 
-// 显示单个字符
-void lcd_show_char(uint16_t x,uint16_t y, char char_num, 
-                    uint16_t color, uint16_t back_color)
+/*--------------------------------------------
+ 文字: 每行字符串一次性按行写入帧缓冲.
+ 每种(前景,背景)颜色对缓存一张 字节->8像素 展开表, 字模每字节直接拷贝16字节.
+--------------------------------------------*/
+
+typedef struct {
+    const uint8_t *data;            // 字模, 每行width/8字节
+    uint8_t width;
+    uint8_t height;
+} lcd_font_t;
+
+// 按LCD_FONT_*顺序排列
+static const lcd_font_t lcd_fonts[] = {
+    { &ascii_1608[0][0], 8, 16 },           // LCD_FONT_8X16
+    { &ascii_3216.glyph[0][0], 16, 32 },    // LCD_FONT_16X32
+    { &ascii_0808.glyph[0][0], 8, 8 },      // LCD_FONT_8X8
+};
+
+#define LCD_GLYPH_CACHE     2       // 缓存的颜色对个数, 每个4KB
+
+typedef struct {
+    uint32_t stamp;                 // 最近使用时间, 0表示空
+    uint16_t color;
+    uint16_t back_color;
+    uint16_t pixels[256][8];
+} lcd_glyph_lut_t;
+
+static lcd_glyph_lut_t lcd_glyph_lut[LCD_GLYPH_CACHE];
+static uint32_t lcd_glyph_clock = 0;
+
+// 取颜色对的展开表, 未命中时替换最久未用的一张
+static const uint16_t (*lcd_glyph_lut_get(uint16_t color, uint16_t back_color))[8]
 {
-    uint8_t index;
-    uint32_t len = 0;
-    uint8_t temp;
-    index = char_num - ' ';         // 得到偏移后的值
-    lcd_set_window(x, y, x + 8 - 1, y + 16 -1);
-    for(uint8_t i = 0; i < 16; i++) {
-        temp = ascii_1608[index][i];
-        for(uint8_t j = 0; j < 8; j++) {
-            if (temp & (0x01 << j)) {
-                *(uint16_t *)&lcd_tx_buffer[len] = color;
-            } else {
-                *(uint16_t *)&lcd_tx_buffer[len] = back_color;
-            }
-            len += 2;
-            if (len >= AppCfg::LCD_MAXTRANS_SIZE) {
-                len = 0;
-                lcd_send_data(lcd_tx_buffer, AppCfg::LCD_MAXTRANS_SIZE);        
+    lcd_glyph_lut_t *lut = &lcd_glyph_lut[0];
+    lcd_glyph_clock++;
+    for (int i = 0; i < LCD_GLYPH_CACHE; i++) {
+        lcd_glyph_lut_t *entry = &lcd_glyph_lut[i];
+        if (entry->stamp != 0 && entry->color == color && entry->back_color == back_color) {
+            entry->stamp = lcd_glyph_clock;
+            return entry->pixels;
+        }
+        if (entry->stamp < lut->stamp) lut = entry;
+    }
+
+    for (int b = 0; b < 256; b++) {
+        for (int j = 0; j < 8; j++) {
+            lut->pixels[b][j] = (b & (0x01 << j)) ? color : back_color;
+        }
+    }
+    lut->color = color;
+    lut->back_color = back_color;
+    lut->stamp = lcd_glyph_clock;
+    return lut->pixels;
+}
+
+// 在一行内连续绘制count个字符, 调用者保证不超出右边界
+static void lcd_draw_text_run(uint16_t x, uint16_t y, const char *str, uint32_t count,
+                            const lcd_font_t *font, const uint16_t (*lut)[8])
+{
+    uint8_t row_bytes = font->width / 8;
+    uint32_t glyph_bytes = row_bytes * font->height;
+    if (count == 0) return;
+    for (uint8_t r = 0; r < font->height && y + r < LCD_HEIGHT; r++) {
+        uint16_t *dst = &lcd_fb[(y + r) * LCD_WIDTH + x];
+        for (uint32_t i = 0; i < count; i++) {
+            uint8_t index = str[i] - ' ';           // 得到偏移后的值
+            if (index >= LCD_FONT_GLYPHS) index = 0;
+            const uint8_t *row = &font->data[index * glyph_bytes + r * row_bytes];
+            for (uint8_t b = 0; b < row_bytes; b++) {
+                memcpy(dst, lut[row[b]], sizeof(lut[0]));
+                dst += 8;
             }
         }
     }
-    lcd_send_data(lcd_tx_buffer, len);
+    lcd_mark_dirty(x, y, x + count * font->width - 1, y + font->height - 1);
+}
 
+// 显示单个字符
+void lcd_show_char(uint16_t x,uint16_t y, char char_num, 
+                    uint16_t color, uint16_t back_color)
+{
+    if (x > LCD_WIDTH - 8) return;
+    lcd_draw_text_run(x, y, &char_num, 1, &lcd_fonts[LCD_FONT_8X16], lcd_glyph_lut_get(color, back_color));
 }
 
-// 显示字符串
-void lcd_show_string(uint16_t x, uint16_t y, char *string,
+// 显示字符串, 按换行与右边界切分成若干段, 每段一次写入
+void lcd_show_string_font(uint16_t x, uint16_t y, const char *string, uint8_t font_id,
                         uint16_t color, uint16_t back_color)
 {
-    uint32_t index = 0;
-    while(string[index] != '\0') {
-        if (x > (LCD_WIDTH - 8)) {      // 空间不够换行
-            x = 4;
-            y += 16;
-        }
-        if (string[index] == '\n') {
+    const lcd_font_t *font = &lcd_fonts[font_id < sizeof(lcd_fonts) / sizeof(lcd_fonts[0]) ? font_id : LCD_FONT_8X16];
+    const uint16_t (*lut)[8] = lcd_glyph_lut_get(color, back_color);
+    const char *run = string;
+    uint32_t count = 0;
+    while (*string != '\0') {
+        if (x + (count + 1) * font->width > LCD_WIDTH || *string == '\n') {
+            /* 空间不够或遇到换行, 先画完当前段 */
+            lcd_draw_text_run(x, y, run, count, font, lut);
             x = 4;                      // 自定义偏移
-            y += 16;
-            index++;
-            continue;
+            y += font->height;
+            count = 0;
+            if (*string == '\n') {
+                string++;
+                run = string;
+                continue;
+            }
+            run = string;
         }
-        lcd_show_char(x, y, string[index], color, back_color);    
-        x += 8;
-        index ++;
+        count++;
+        string++;
     }
+    lcd_draw_text_run(x, y, run, count, font, lut);
+}
+
+void lcd_show_string(uint16_t x, uint16_t y, char *string,
+                        uint16_t color, uint16_t back_color)
+{
+    lcd_show_string_font(x, y, string, LCD_FONT_8X16, color, back_color);
 }
 
 
@@ -387,9 +637,10 @@ void lcd_draw_image(uint8_t *image_data, uint16_t width, uint16_t height)
     // 使图像居中
     uint8_t begin_x = (LCD_WIDTH - width) / 2;
     uint8_t begin_y = (LCD_HEIGHT - height) / 2;
-    lcd_set_window(begin_x, begin_y, begin_x - width - 1, begin_y + height - 1);
-    lcd_send_data(image_data, width * height * 2);
-
+    for (uint16_t y = 0; y < height; y++) {
+        memcpy(&lcd_fb[(begin_y + y) * LCD_WIDTH + begin_x], &image_data[y * width * 2], width * 2);
+    }
+    lcd_mark_dirty(begin_x, begin_y, begin_x + width - 1, begin_y + height - 1);
 }
 
 void lcd_frame_display_data(lcd_data_frame_t *data)
@@ -413,11 +664,12 @@ void lcd_frame_display_data(lcd_data_frame_t *data)
         break;
     }
     case LCD_CHAR: {        // 显示字符
-        lcd_show_char(image.x, image.y, (char)image.data[0], image.color, image.back_color);
+        char str[2] = {(char)image.data[0], '\0'};
+        lcd_show_string_font(image.x, image.y, str, image.font, image.color, image.back_color);
         break;
     }
     case LCD_STRING: {      // 显示字符串
-        lcd_show_string(image.x, image.y, (char *)image.data, image.color, image.back_color);
+        lcd_show_string_font(image.x, image.y, (char *)image.data, image.font, image.color, image.back_color);
         break;
     }
     case LCD_PICTURE: {     // 显示图片
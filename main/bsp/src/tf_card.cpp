@@ -0,0 +1,63 @@
+#include "esp_log.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdspi_host.h"
+#include "driver/spi_master.h"
+#include <cstring>
+
+#include "tf_card.h"
+#include "app_config.h"
+
+#define TAG         "tf_card"
+
+static sdmmc_card_t *tf_card = NULL;
+
+esp_err_t tf_card_mount()
+{
+    if (tf_card != NULL) {
+        return ESP_OK;
+    }
+
+    esp_vfs_fat_sdmmc_mount_config_t mount_config;
+    memset(&mount_config, 0, sizeof(mount_config));
+    mount_config.format_if_mount_failed = false;
+    mount_config.max_files = 4;
+    mount_config.allocation_unit_size = 16 * 1024;
+
+    // TF卡独占一条SPI总线, 不与LCD的排队传输争用
+    spi_bus_config_t buscfg;
+    memset(&buscfg, 0, sizeof(buscfg));
+    buscfg.miso_io_num = AppCfg::TF_PIN_MISO;
+    buscfg.mosi_io_num = AppCfg::TF_PIN_MOSI;
+    buscfg.sclk_io_num = AppCfg::TF_PIN_SCK;
+    buscfg.quadwp_io_num = -1;
+    buscfg.quadhd_io_num = -1;
+    buscfg.max_transfer_sz = 4096;
+    esp_err_t ret = spi_bus_initialize((spi_host_device_t )AppCfg::TF_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "spi bus init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    host.slot = AppCfg::TF_SPI_HOST;
+    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot_config.gpio_cs = (gpio_num_t )AppCfg::TF_PIN_CS;
+    slot_config.host_id = (spi_host_device_t )AppCfg::TF_SPI_HOST;
+
+    ret = esp_vfs_fat_sdspi_mount(AppCfg::TF_MOUNT_POINT, &host, &slot_config, &mount_config, &tf_card);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "mount failed (no card?): %s", esp_err_to_name(ret));
+        tf_card = NULL;
+        spi_bus_free((spi_host_device_t )AppCfg::TF_SPI_HOST);
+        return ret;
+    }
+    ESP_LOGI(TAG, "mounted %s, %llu MB", AppCfg::TF_MOUNT_POINT,
+             (unsigned long long)tf_card->csd.capacity * tf_card->csd.sector_size / (1024 * 1024));
+    return ESP_OK;
+}
+
+bool tf_card_mounted()
+{
+    return tf_card != NULL;
+}
@@ -0,0 +1,88 @@
+#include "conn_pool.h"
+#include "tcp_server.h"
+#include "app_config.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <atomic>
+
+namespace ConnPool {
+
+static const char TAG[] = "conn_pool";
+
+/* 任务栈须位于内部RAM */
+struct Conn {
+    StaticTask_t tcb;
+    TaskHandle_t task;                      // 已创建的任务, 退出后挂起直到被回收
+    std::atomic<bool> busy;
+    uint8_t rx_buf[TcpServer::SOCK_RECV_SIZE];
+    StackType_t stack[AppCfg::CLIENT_TASK_STACK / sizeof(StackType_t)];
+};
+
+static Conn* _conns = nullptr;
+static uint32_t _capacity = 0;
+static std::atomic<uint32_t> _in_use = 0;
+
+/**
+ * 回收槽位上已退出的任务: 任务自己删除自己时控制块要等空闲任务清理后才能复用,
+ * 因此任务退出时只挂起, 由创建方删除(删除非运行中的任务立即完成).
+*/
+static void reap(Conn* conn) {
+    if (conn->task == nullptr) return;
+    // 任务已登记退出, 等待其走到vTaskSuspend
+    while (eTaskGetState(conn->task) != eSuspended) {
+        vTaskDelay(1);
+    }
+    vTaskDelete(conn->task);
+    conn->task = nullptr;
+}
+
+bool spawn(int slot, TaskFunction_t task, const char* name, int sock) {
+    if (slot < 0 || (uint32_t)slot >= _capacity) return false;
+    Conn* conn = &_conns[slot];
+    reap(conn);
+    conn->busy.store(true, std::memory_order_relaxed);
+    _in_use.fetch_add(1, std::memory_order_relaxed);
+    conn->task = xTaskCreateStatic(task, name, sizeof(conn->stack) / sizeof(StackType_t),
+                                   (void *)(intptr_t)sock, 10, conn->stack, &conn->tcb);
+    if (conn->task == nullptr) {
+        conn->busy.store(false, std::memory_order_relaxed);
+        _in_use.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void exit(int slot) {
+    if (slot >= 0 && (uint32_t)slot < _capacity && _conns[slot].busy.exchange(false, std::memory_order_relaxed)) {
+        _in_use.fetch_sub(1, std::memory_order_relaxed);
+    }
+    vTaskSuspend(NULL);
+}
+
+uint8_t* rxBuffer(int slot) {
+    if (slot < 0 || (uint32_t)slot >= _capacity) return nullptr;
+    return _conns[slot].rx_buf;
+}
+
+uint32_t inUse() {
+    return _in_use.load(std::memory_order_relaxed);
+}
+
+uint32_t capacity() {
+    return _capacity;
+}
+
+int init() {
+    if (AppCfg::TCP_REACTOR_MODE) return 0;
+
+    _conns = (Conn *)heap_caps_calloc(AppCfg::TCP_MAX_CLIENTS, sizeof(Conn), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (_conns == NULL) {
+        ESP_LOGE(TAG, "connection pool malloc failed");
+        return -1;
+    }
+    _capacity = AppCfg::TCP_MAX_CLIENTS;
+    return 0;
+}
+
+}
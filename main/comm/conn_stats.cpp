@@ -0,0 +1,94 @@
+#include "conn_stats.h"
+#include "app_config.h"
+#include "metrics.h"
+
+#include "esp_timer.h"
+#include <atomic>
+
+namespace ConnStats {
+
+struct Counters {
+    std::atomic<uint32_t> rx_bytes;
+    std::atomic<uint32_t> rx_frames;
+    std::atomic<uint32_t> tx_bytes;
+    std::atomic<uint32_t> tx_frames;
+    std::atomic<uint32_t> latency[LATENCY_BUCKETS];
+};
+
+static Counters _counters[AppCfg::TCP_MAX_CLIENTS];
+
+static inline bool valid(int slot) {
+    return slot >= 0 && slot < AppCfg::TCP_MAX_CLIENTS;
+}
+
+void reset(int slot) {
+    if (!valid(slot)) return;
+    Counters& c = _counters[slot];
+    c.rx_bytes.store(0, std::memory_order_relaxed);
+    c.rx_frames.store(0, std::memory_order_relaxed);
+    c.tx_bytes.store(0, std::memory_order_relaxed);
+    c.tx_frames.store(0, std::memory_order_relaxed);
+    for (auto& bucket : c.latency) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void addRx(int slot, uint32_t bytes) {
+    Metrics::add(Metrics::RX_BYTES, bytes);
+    if (valid(slot)) _counters[slot].rx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void addRxFrame(int slot) {
+    Metrics::add(Metrics::RX_FRAMES);
+    if (valid(slot)) _counters[slot].rx_frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void addTx(int slot, uint32_t bytes) {
+    Metrics::add(Metrics::TX_BYTES, bytes);
+    if (valid(slot)) _counters[slot].tx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void addTxFrame(int slot) {
+    Metrics::add(Metrics::TX_FRAMES);
+    if (valid(slot)) _counters[slot].tx_frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void addLatency(int slot, uint32_t us) {
+    if (!valid(slot)) return;
+    int bucket = us == 0 ? 0 : 31 - __builtin_clz(us);
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    _counters[slot].latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+bool read(int slot, Snapshot& out) {
+    if (!valid(slot)) return false;
+    Counters& c = _counters[slot];
+    out.rx_bytes = c.rx_bytes.load(std::memory_order_relaxed);
+    out.rx_frames = c.rx_frames.load(std::memory_order_relaxed);
+    out.tx_bytes = c.tx_bytes.load(std::memory_order_relaxed);
+    out.tx_frames = c.tx_frames.load(std::memory_order_relaxed);
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        out.latency[i] = c.latency[i].load(std::memory_order_relaxed);
+    }
+    return true;
+}
+
+uint32_t now() {
+    return (uint32_t)esp_timer_get_time();
+}
+
+uint32_t percentile(const uint32_t* hist, uint32_t pct) {
+    uint32_t total = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) total += hist[i];
+    if (total == 0) return 0;
+
+    uint32_t target = (total * pct + 99) / 100;
+    uint32_t sum = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        sum += hist[i];
+        if (sum >= target) return (2u << i) - 1;
+    }
+    return UINT32_MAX;
+}
+
+}
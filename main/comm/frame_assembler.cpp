@@ -0,0 +1,102 @@
+#include "frame_assembler.h"
+#include "app_config.h"
+#include "metrics.h"
+
+#include <cstring>
+
+namespace TcpDataHandle {
+
+void FrameAssembler::reset() {
+    _head = 0;
+    _tail = 0;
+    _dropped = 0;
+    _stream_left = 0;
+}
+
+void FrameAssembler::peek(uint32_t offset, uint8_t* out, uint32_t len) const {
+    uint32_t pos = (_head + offset) & (RING_SIZE - 1);
+    uint32_t first = RING_SIZE - pos;
+    if (first >= len) {
+        memcpy(out, &_ring[pos], len);
+    } else {
+        memcpy(out, &_ring[pos], first);
+        memcpy(out + first, _ring, len - first);
+    }
+}
+
+uint32_t FrameAssembler::push(IBuf data) {
+    uint32_t len = RING_SIZE - used();
+    if (len > data.size()) len = data.size();
+
+    uint32_t pos = _tail & (RING_SIZE - 1);
+    uint32_t first = RING_SIZE - pos;
+    if (first >= len) {
+        memcpy(&_ring[pos], data.data(), len);
+    } else {
+        memcpy(&_ring[pos], data.data(), first);
+        memcpy(_ring, data.data() + first, len - first);
+    }
+    _tail += len;
+    return len;
+}
+
+bool FrameAssembler::pop(IBuf& frame) {
+    FrameHeader header;
+    while (used() > 0 && !streaming()) {
+        /* 查找帧头 */
+        if (_ring[_head & (RING_SIZE - 1)] != FRAME_HEAD) {
+            _head++;
+            _dropped++;
+            Metrics::add(Metrics::RESYNC_BYTES);
+            continue;
+        }
+        if (used() < sizeof(FrameHeader)) return false;
+
+        peek(0, (uint8_t *)&header, sizeof(FrameHeader));
+        if (header.type == FrameType::BINARY && header.length > TcpServer::SOCK_BUF_SIZE
+            && header.length <= AppCfg::STREAM_FRAME_MAX) {
+            /* 大帧, 转为流模式 */
+            _stream_header = header;
+            _stream_left = sizeof(FrameHeader) + header.length;
+            return false;
+        }
+        if (header.type == FrameType::UNKNOWN || header.type >= FrameType::FRAME_TYPE_COUNT
+            || header.length > TcpServer::SOCK_BUF_SIZE) {
+            /* 伪帧头, 跳过后重新同步 */
+            _head++;
+            _dropped++;
+            Metrics::add(Metrics::RESYNC_BYTES);
+            continue;
+        }
+
+        uint32_t size = sizeof(FrameHeader) + header.length;
+        if (used() < size) return false;
+
+        uint32_t pos = _head & (RING_SIZE - 1);
+        if (RING_SIZE - pos >= size) {
+            frame = IBuf(&_ring[pos], size);
+        } else {
+            peek(0, _frame, size);
+            frame = IBuf(_frame, size);
+        }
+        _head += size;
+        return true;
+    }
+    return false;
+}
+
+IBuf FrameAssembler::streamPeek(uint32_t max) const {
+    uint32_t pos = _head & (RING_SIZE - 1);
+    uint32_t len = used();
+    if (len > _stream_left) len = _stream_left;
+    if (len > RING_SIZE - pos) len = RING_SIZE - pos;
+    if (len > max) len = max;
+    return IBuf(&_ring[pos], len);
+}
+
+void FrameAssembler::streamConsume(uint32_t len) {
+    _head += len;
+    _stream_left -= len;
+}
+
+}
@@ -0,0 +1,56 @@
+#include "frame_pool.h"
+#include "app_config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+namespace FramePool {
+
+static const char TAG[] = "frame_pool";
+static Frame* _frames = nullptr;
+static QueueHandle_t _free_queue = nullptr;
+
+Frame* alloc() {
+    Frame* frame = nullptr;
+    if (_free_queue == nullptr) return nullptr;
+    if (xQueueReceive(_free_queue, &frame, 0) != pdTRUE) {
+        return nullptr;
+    }
+    frame->refs.store(1, std::memory_order_relaxed);
+    frame->len = 0;
+    frame->stamp = 0;
+    return frame;
+}
+
+void retain(Frame* frame) {
+    frame->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void release(Frame* frame) {
+    if (frame->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        xQueueSend(_free_queue, &frame, 0);
+    }
+}
+
+uint32_t available() {
+    if (_free_queue == nullptr) return 0;
+    return uxQueueMessagesWaiting(_free_queue);
+}
+
+int init() {
+    _frames = (Frame *)heap_caps_calloc(AppCfg::FRAME_POOL_SIZE, sizeof(Frame), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    _free_queue = xQueueCreate(AppCfg::FRAME_POOL_SIZE, sizeof(Frame *));
+    if (_frames == NULL || _free_queue == NULL) {
+        ESP_LOGE(TAG, "frame pool malloc failed");
+        return -1;
+    }
+    for (int i = 0; i < AppCfg::FRAME_POOL_SIZE; i++) {
+        Frame* frame = &_frames[i];
+        xQueueSend(_free_queue, &frame, 0);
+    }
+    return 0;
+}
+
+}
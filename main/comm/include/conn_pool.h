@@ -0,0 +1,27 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdint.h>
+
+namespace ConnPool {
+
+/**
+ * 每客户端接收任务模式下的连接资源池
+ * 任务栈, 任务控制块与接收缓冲在启动时一次性申请, 按客户端注册表槽位索引,
+ * 连接反复建立断开不再申请释放堆内存. 单任务事件循环模式下池为空.
+*/
+int init();
+
+// 以槽位的静态栈创建接收任务, 参数sock按值传入; 槽位上的旧任务先回收
+bool spawn(int slot, TaskFunction_t task, const char* name, int sock);
+// 接收任务退出时调用, 挂起自身等待下次spawn()回收, 不返回
+void exit(int slot);
+// 槽位的接收缓冲, 大小为 TcpServer::SOCK_RECV_SIZE
+uint8_t* rxBuffer(int slot);
+
+// 占用中的槽数与总槽数
+uint32_t inUse();
+uint32_t capacity();
+
+}
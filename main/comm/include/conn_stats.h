@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace ConnStats {
+
+/**
+ * 每连接流量计数, 按客户端注册表槽位索引, 同时累加到Metrics全局计数.
+ * 计数器均为原子量, 热路径只做relaxed自增, 读取方无需加锁.
+*/
+constexpr int LATENCY_BUCKETS = 16;     // 第k桶统计[2^k, 2^(k+1)) us, 最后一桶不设上限
+
+struct Snapshot {
+    uint32_t rx_bytes;
+    uint32_t rx_frames;
+    uint32_t tx_bytes;
+    uint32_t tx_frames;
+    uint32_t latency[LATENCY_BUCKETS];  // 转发延迟直方图
+};
+
+// 新连接占用槽位时清零
+void reset(int slot);
+void addRx(int slot, uint32_t bytes);
+void addRxFrame(int slot);
+void addTx(int slot, uint32_t bytes);
+void addTxFrame(int slot);
+// 记录一帧从收到到写入目标套接字的耗时
+void addLatency(int slot, uint32_t us);
+bool read(int slot, Snapshot& out);
+
+// 微秒时间戳(回绕), 用于计算延迟
+uint32_t now();
+// 由直方图计算百分位数, 返回所在桶的上界(us), 无样本返回0
+uint32_t percentile(const uint32_t* hist, uint32_t pct);
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bufdef.h"
+#include "tcp_data_handle.h"
+#include "tcp_server.h"
+
+namespace TcpDataHandle {
+
+/**
+ * 单连接的TCP字节流帧重组器
+ * 环形缓冲区接收任意分片的字节流, 每次可取出零个或多个完整帧;
+ * 帧头不匹配或长度非法时逐字节丢弃, 重新同步到下一个FRAME_HEAD.
+ * 超过FRAME_MAX的BINARY帧进入流模式, 按到达的数据分段取出(直通转发),
+ * 不缓存整帧.
+*/
+class FrameAssembler {
+public:
+    static constexpr uint32_t RING_SIZE = 4096;     // 2的幂
+    static constexpr uint32_t FRAME_MAX = sizeof(FrameHeader) + TcpServer::SOCK_BUF_SIZE;
+    static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "RING_SIZE must be a power of 2");
+    static_assert(RING_SIZE >= FRAME_MAX + TcpServer::SOCK_RECV_SIZE, "ring must hold a partial frame plus one recv");
+
+    void reset();
+    // 写入接收到的数据, 返回实际写入的字节数(缓冲区满时小于data.size())
+    uint32_t push(IBuf data);
+    // 取出一个完整帧(含帧头), 返回的数据在下一次push前有效; 流模式下返回false
+    bool pop(IBuf& frame);
+    // 空闲字节数
+    uint32_t space() const { return RING_SIZE - used(); }
+    // 重同步时丢弃的字节数
+    uint32_t dropped() const { return _dropped; }
+
+    /* 流模式: streamPeek()取出当前可用的连续数据(首段含帧头), 转发成功后streamConsume() */
+    bool streaming() const { return _stream_left > 0; }
+    const FrameHeader& streamHeader() const { return _stream_header; }
+    // 本帧已取出的字节数, 为0表示流刚开始
+    uint32_t streamOffset() const { return sizeof(FrameHeader) + _stream_header.length - _stream_left; }
+    IBuf streamPeek(uint32_t max) const;
+    void streamConsume(uint32_t len);
+
+private:
+    uint32_t used() const { return _tail - _head; }
+    void peek(uint32_t offset, uint8_t* out, uint32_t len) const;
+
+    uint8_t  _ring[RING_SIZE];
+    uint8_t  _frame[FRAME_MAX];     // 帧跨越环尾时的线性拷贝
+    uint32_t _head;                 // 读位置(自由增长)
+    uint32_t _tail;                 // 写位置(自由增长)
+    uint32_t _dropped;
+    FrameHeader _stream_header;
+    uint32_t _stream_left;          // 流模式剩余字节数(含帧头)
+};
+
+}
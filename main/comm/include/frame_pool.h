@@ -0,0 +1,33 @@
+#pragma once
+
+#include "frame_assembler.h"
+#include "app_config.h"
+#include <atomic>
+
+namespace FramePool {
+
+// 槽容量: 转发的整帧与命令应答帧取较大者
+constexpr uint32_t FRAME_DATA_MAX = TcpDataHandle::FrameAssembler::FRAME_MAX > sizeof(TcpDataHandle::FrameHeader) + AppCfg::CMD_REPLY_MAX
+    ? TcpDataHandle::FrameAssembler::FRAME_MAX : sizeof(TcpDataHandle::FrameHeader) + AppCfg::CMD_REPLY_MAX;
+static_assert(FRAME_DATA_MAX <= UINT16_MAX, "frame length must fit in Frame::len");
+
+/**
+ * 引用计数的帧缓冲槽
+ * 转发时按引用在各发送队列间传递, 最后一个持有者释放后归还缓冲池.
+*/
+struct Frame {
+    std::atomic<uint16_t> refs;
+    uint16_t len;
+    uint32_t stamp;             // 转发帧的接收时间(us), 0表示不统计延迟
+    uint8_t data[FRAME_DATA_MAX];
+};
+
+int init();
+// 申请一个帧缓冲(引用计数为1), 缓冲池耗尽时返回nullptr
+Frame* alloc();
+void retain(Frame* frame);
+void release(Frame* frame);
+// 空闲槽数
+uint32_t available();
+
+}
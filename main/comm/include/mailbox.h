@@ -0,0 +1,32 @@
+#pragma once
+
+#include "bufdef.h"
+
+namespace Mailbox {
+
+/* 投递统计, 自启动起累计 */
+struct Stats {
+    uint32_t stored;            // 存入的帧
+    uint32_t delivered;         // 目标登录后送达的帧
+    uint32_t expired;           // 超过TTL被丢弃的帧
+    uint32_t dropped;           // 信箱满被丢弃的帧
+    uint32_t spilled;           // 由PSRAM转存到TF卡的帧
+    uint32_t pending;           // 当前待投递的帧(PSRAM与TF卡合计)
+};
+
+/**
+ * 离线设备信箱: 发往曾经登录过但当前不在线(或尚未登录)的设备ID的帧暂存于此,
+ * 目标重新连接并登录后按原顺序投递. 帧先存PSRAM, 占用过高时由后台任务
+ * 把最早的帧转存到TF卡; 每帧超过 AppCfg::MAILBOX_TTL_S 未送达即丢弃.
+ * TF卡只用于扩展容量, 不跨重启保留: 时间戳以启动时刻为基准, 启动时删除上次的信箱文件.
+*/
+int init();
+
+// 该ID的帧是否应交给信箱(目标离线, 未登录或仍有未投递的帧), 保证投递顺序
+bool pending(uint8_t id);
+// 存入一整帧(含帧头), 目标从未登录过或信箱已满时返回false
+bool store(uint8_t id, IBuf frame);
+
+void read(Stats& out);
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include "app_config.h"
+#include "conn_stats.h"
+#include "esp_log.h"
+
+/**
+ * 热路径日志, 级别高于AppCfg::HOT_PATH_LOG_LEVEL时编译期去除,
+ * 避免逐帧日志拖慢转发.
+*/
+#define HOT_LOGW(tag, fmt, ...) do { if (AppCfg::HOT_PATH_LOG_LEVEL >= ESP_LOG_WARN) ESP_LOGW(tag, fmt, ##__VA_ARGS__); } while (0)
+#define HOT_LOGI(tag, fmt, ...) do { if (AppCfg::HOT_PATH_LOG_LEVEL >= ESP_LOG_INFO) ESP_LOGI(tag, fmt, ##__VA_ARGS__); } while (0)
+#define HOT_LOGD(tag, fmt, ...) do { if (AppCfg::HOT_PATH_LOG_LEVEL >= ESP_LOG_DEBUG) ESP_LOGD(tag, fmt, ##__VA_ARGS__); } while (0)
+
+namespace Metrics {
+
+/* 全局计数, 与ConnStats的每连接计数不同, 连接断开后不清零 */
+enum Counter : uint8_t {
+    RX_BYTES,
+    RX_FRAMES,
+    TX_BYTES,
+    TX_FRAMES,
+    CONNECTS,
+    REJECTS,                    // 客户端已满且等待队列满时拒绝的连接
+    IDLE_REAPED,                // 空闲超时被关闭的连接
+    RESYNC_BYTES,               // 帧头/长度不匹配被丢弃的字节
+    UNKNOWN_DEST,               // 目标ID不在线
+    POOL_EXHAUSTED,             // 缓冲池耗尽丢弃的帧
+    SEND_ERRORS,                // sendmsg()失败
+    TX_DROPS,                   // 发送队列满或断开时丢弃的帧
+    TX_HIGH_WATER,              // 所有连接发送队列深度的峰值
+    COUNTER_COUNT,
+};
+
+void add(Counter counter, uint32_t n = 1);
+// 记录峰值
+void peak(Counter counter, uint32_t value);
+uint32_t get(Counter counter);
+
+// 命令处理耗时直方图, 分桶同ConnStats
+void addHandlerLatency(uint32_t us);
+void handlerLatency(uint32_t out[ConnStats::LATENCY_BUCKETS]);
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "bufdef.h"
+
+namespace Recorder {
+
+/* --------------------------------
+抓包文件(TF卡 /cap/capNNNN.bin), 小端:
+文件头 16 byte:
+4 byte          char[4]             "SAPC"
+2 byte          uint16_t            版本(1)
+2 byte          uint16_t            负载截断长度(snaplen)
+8 byte          uint64_t            文件创建时刻(us, 启动起)
+记录, 重复至文件尾:
+8 byte          uint64_t            接收时刻(us, 启动起)
+1 byte          uint8_t             源连接的客户端ID
+1 byte          uint8_t             标志(RecordFlag)
+2 byte          uint16_t            记录的帧字节数caplen(含8字节帧头)
+caplen byte                         帧头与截断后的负载
+-------------------------------- */
+constexpr char MAGIC[4] = {'S', 'A', 'P', 'C'};
+constexpr uint16_t VERSION = 1;
+
+enum RecordFlag : uint8_t {
+    RECORD_TRUNCATED = 1 << 0,  // 负载被截断
+    RECORD_STREAM    = 1 << 1,  // 大帧直通转发, 只记录帧头
+};
+
+/* 抓包统计, 自启动起累计 */
+struct Stats {
+    uint32_t records;           // 写入文件的记录数
+    uint32_t drops;             // 环形缓冲满或未挂载TF卡丢弃的记录
+    uint32_t bytes;             // 写入文件的字节数
+    bool active;
+};
+
+int init();
+
+// 开始/停止抓包, 开始时新建文件; 未挂载TF卡时start()返回-1
+int start();
+void stop();
+
+// 记录sock收到的一帧(接收路径调用, 不阻塞, 环形缓冲满时丢弃); 未在抓包时只有一次原子读.
+// 大帧直通转发只传入帧头并带RECORD_STREAM标志
+void capture(int sock, IBuf frame, uint8_t flags = 0);
+bool active();
+
+void read(Stats& out);
+
+}
@@ -11,10 +11,17 @@ namespace TcpDataHandle {
 1 byte          uint8_t             发送方设备ID
 4 byte          uint32_t            数据长度
 ......                              数据
+
+数据长度不超过 TcpServer::SOCK_BUF_SIZE 的帧整帧处理;
+更长的BINARY帧(至多 AppCfg::STREAM_FRAME_MAX)按到达的数据分段直通转发.
+服务器的命令应答负载至多 AppCfg::CMD_REPLY_MAX 字节(list/stats随客户端数增长).
 -------------------------------- */
 
 constexpr uint8_t FRAME_HEAD = 0xAA;        // 帧头标志(1010 1010)
 constexpr uint8_t SERVER_ID  = 1;           // 服务器ID
+constexpr uint8_t BROADCAST_ID  = 0xFF;     // 广播: 转发给除发送方外的全部客户端
+constexpr uint8_t GROUP_ID_BASE = 0xF0;     // 组播: 目标ID 0xF0~0xFE 对应组 0~14
+constexpr uint8_t GROUP_COUNT   = BROADCAST_ID - GROUP_ID_BASE;
 constexpr char KEY_STATUS[]  = "status";
 constexpr char STATUS_OK[]   = "succeed";
 constexpr char STATUS_FAIL[] = "failed";
@@ -25,6 +32,24 @@ enum FrameType : uint8_t {
     JSON,                   // JSON字符串格式
     BINARY,                 // 二进制数据格式
     CMD,                    // 命令数据格式
+    BCMD,                   // 二进制命令格式
+    PING,                   // 心跳请求, 发往服务器时以PONG原样回送负载
+    PONG,                   // 心跳应答
+    FRAME_TYPE_COUNT,       // 类型个数, 不是有效帧类型
+};
+
+/* --------------------------------
+二进制命令(BCMD)负载:
+1 byte          uint8_t             操作码(cmds::Opcode)
+n × TLV参数:
+1 byte          uint8_t             参数类型(TlvType)
+1 byte          uint8_t             参数长度
+......                              参数值
+应答帧类型为BCMD, 负载为1字节操作码加处理结果.
+-------------------------------- */
+enum TlvType : uint8_t {
+    TLV_STR = 1,            // 字符串(不含结束符)
+    TLV_U32,                // 4字节小端无符号整数
 };
 
 struct FrameHeader {
@@ -32,15 +57,30 @@ struct FrameHeader {
     FrameType type;
     uint8_t goal;
     uint8_t source;
-    uint16_t length;
+    uint32_t length;
 };
+static_assert(sizeof(FrameHeader) == 8, "frame header must be 8 bytes");
 
 int init();
 
-FrameHeader frameUnpack(IBuf& buf, OBuf& out);
-
+// goal可为设备ID, 组播ID或广播ID
 int packageSend(uint8_t goal, FrameType type, IBuf buf);
 
+// 组播订阅管理, group范围[0, GROUP_COUNT)
+int subscribe(int sock, uint8_t group);
+int unsubscribe(int sock, uint8_t group);
+uint16_t subscriptions(int sock);
+
+// TCP接收回调: 按字节流重组后逐帧处理
 void response(int sock, IBuf info);
 
+// 连接拒绝回调: 生成带原因的应答帧
+uint32_t rejectFrame(const char* reason, uint8_t* buf, uint32_t cap);
+
+// 正在执行的命令来自哪个连接, 只在命令处理函数中有效; Shell命令为-1
+int commandSource();
+
+// TCP断开回调: 释放该连接的帧重组缓冲, slot为连接原来的注册表槽位
+void disconnect(int sock, int slot);
+
 }
\ No newline at end of file
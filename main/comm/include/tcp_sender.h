@@ -0,0 +1,43 @@
+#pragma once
+
+#include "frame_pool.h"
+
+namespace TcpSender {
+
+/* 单个连接的发送统计 */
+struct Stats {
+    uint32_t frames;            // 已发送帧数
+    uint32_t bytes;             // 已发送字节数
+    uint32_t drops;             // 队列满或连接异常丢弃的帧数
+    uint32_t stalls;            // 发送缓冲满(EAGAIN)次数
+    uint16_t depth;             // 当前排队帧数, 含直通转发期间暂存的帧
+    uint16_t high_water;        // 排队帧数峰值
+};
+
+int init();
+
+/* post()返回值: 发送字节数; -1 连接不存在或发送出错; -2 队列已满. 失败时帧已释放 */
+
+// 发送完整帧(帧头已在frame中), 转移调用者持有的一个引用; 队列满时丢弃
+int post(int sock, FramePool::Frame* frame);
+// 帧头与负载分离发送(scatter-gather), payload转移一个引用
+int post(int sock, const TcpDataHandle::FrameHeader& header, FramePool::Frame* payload);
+
+/**
+ * 大帧直通转发: owner(源连接)独占目标连接的发送流, 期间其它帧暂存,
+ * 流结束后按原顺序放回发送队列. 目标已被其它源占用时streamBegin()返回-2.
+*/
+int streamBegin(int sock, int owner);
+// 发送流数据段, 队列满时返回-2且不计入丢弃, 调用方稍后重试
+int streamPost(int sock, int owner, FramePool::Frame* chunk);
+void streamEnd(int sock, int owner);
+// 源连接在流中途断开: 目标已收到不完整的帧, 无法再对齐帧边界, 丢弃积压并关闭目标连接
+void streamAbort(int sock, int owner);
+
+// 读取客户端注册表槽位对应连接的发送统计
+bool getStats(int slot, Stats& out);
+
+// 连接断开(已从注册表移除, 之后的post()找不到该连接): 丢弃未发送的帧并释放发送队列
+void disconnect(int sock, int slot);
+
+}
@@ -12,15 +12,45 @@ struct ClientInfo {
     int  port;                  // 客户端端口
     /* 手动获取 */
     char name[32];              // 客户端名
-    struct ClientInfo *next;
+};
+
+/* 客户端事件, 在网络任务中回调, 回调内不可阻塞 */
+enum class ClientEvent : uint8_t {
+    CONNECT,
+    DISCONNECT,
+    LOGIN,
 };
 
 using RecvCallback = void (*)(int, IBuf);
+// 连接关闭时调用, 此时连接已从注册表移除(按套接字查不到), slot为其原槽位
+using CloseCallback = void (*)(int sock, int slot);
+using EventCallback = void (*)(ClientEvent event, int slot);
+// 拒绝连接时生成回复给对端的原因帧, 返回写入buf的字节数
+using RejectCallback = uint32_t (*)(const char* reason, uint8_t* buf, uint32_t cap);
 constexpr uint16_t SOCK_BUF_SIZE = 1024;
+constexpr uint16_t SOCK_RECV_SIZE = SOCK_BUF_SIZE + 8;  // 单次recv()最大字节数
 
 int init(uint16_t port);
 void registerRecvCallback(RecvCallback cb);
-ClientInfo* getClientsInfo();
+void registerCloseCallback(CloseCallback cb);
+// 可注册多个(至多4个), 按注册顺序调用
+void registerEventCallback(EventCallback cb);
+void registerRejectCallback(RejectCallback cb);
+// 暂停读取该连接(接收方背压); 暂停期间约每10ms以空数据调用一次RecvCallback
+void pauseRecv(int sock, bool pause);
 int getSourceSock();
 
+/* 客户端注册表, 槽位范围[0, AppCfg::TCP_MAX_CLIENTS), 查询均为O(1)且无锁 */
+int clientCount();
+// 拷贝槽位中的客户端信息, 空闲槽位返回false
+bool getClient(int slot, ClientInfo& out);
+int findSlotById(uint8_t id);
+int findSlotBySocket(int sock);
+int findSlotByName(const char* name);
+// 按设备ID查找套接字, 不存在返回-1
+int findSocketById(uint8_t id);
+// 槽位对应的套接字, 空闲返回-1
+int getSocket(int slot);
+bool setClientName(int sock, const char* name);
+
 }
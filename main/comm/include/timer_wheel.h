@@ -0,0 +1,53 @@
+#pragma once
+
+#include "app_config.h"
+#include <stdint.h>
+
+/**
+ * 单层时间轮, 按客户端注册表槽位管理每个连接的一个定时器
+ * 定时器挂在 deadline % SLOTS 的桶中(双向链表), 增删O(1);
+ * 每推进一格只检查一个桶, 超过一圈的定时器留在桶中等下一圈.
+ * 非线程安全, 由单个任务使用.
+*/
+class TimerWheel {
+public:
+    static constexpr int SLOTS = 64;
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of 2");
+
+    TimerWheel();
+
+    // 设置槽位id的到期时刻(与advance()的now同一单位), 已有定时器时先取消
+    void schedule(int16_t id, uint32_t deadline);
+    void cancel(int16_t id);
+    bool empty() const { return _count == 0; }
+
+    // 推进到now, 对到期的id调用expired(id), 回调内可重新schedule()
+    template <typename F>
+    void advance(uint32_t now, F expired) {
+        // 长时间未推进时(如刚启动)最多走一圈, 所有桶都会被检查到
+        if ((int32_t)(now - _now) > SLOTS) _now = now - SLOTS;
+        while ((int32_t)(now - _now) > 0) {
+            _now++;
+            int16_t id = _heads[_now & (SLOTS - 1)];
+            while (id >= 0) {
+                int16_t next = _next[id];
+                if ((int32_t)(_deadline[id] - now) <= 0) {
+                    cancel(id);
+                    expired(id);
+                }
+                id = next;
+            }
+        }
+    }
+
+private:
+    void link(int16_t id);
+
+    uint32_t _now;
+    int _count;
+    int16_t _heads[SLOTS];
+    int16_t _next[AppCfg::TCP_MAX_CLIENTS];
+    int16_t _prev[AppCfg::TCP_MAX_CLIENTS];
+    uint32_t _deadline[AppCfg::TCP_MAX_CLIENTS];
+    bool _armed[AppCfg::TCP_MAX_CLIENTS];
+};
@@ -0,0 +1,451 @@
+#include "mailbox.h"
+#include "tcp_server.h"
+#include "tcp_data_handle.h"
+#include "tcp_sender.h"
+#include "frame_pool.h"
+#include "tf_card.h"
+#include "app_config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Mailbox {
+
+static const char TAG[] = "mailbox";
+constexpr uint32_t FRAME_MAX = TcpDataHandle::FrameAssembler::FRAME_MAX;
+constexpr int SWEEP_PERIOD_MS = 10 * 1000;      // 检查TTL与转存的周期
+constexpr int FLUSH_RETRY_MS = 10;              // 目标发送队列满或缓冲池耗尽时的重试间隔
+constexpr int SPILL_LEVEL = AppCfg::MAILBOX_FRAMES * 3 / 4;    // PSRAM占用超过该值开始转存
+constexpr int ID_COUNT = 256;
+
+/* PSRAM中的帧记录, 同一目标的记录按到达顺序串成链表 */
+struct Record {
+    uint32_t stamp;             // 存入时刻(s)
+    uint16_t len;
+    int16_t next;
+    uint8_t data[FRAME_MAX];
+};
+
+/* TF卡记录: 存入时刻(s), 帧长, 帧数据 */
+struct TfRecord {
+    uint32_t stamp;
+    uint16_t len;
+} __attribute__((packed));
+
+/**
+ * 每个目标ID的信箱, 顺序为: TF卡中的帧(最早) -> PSRAM链表中的帧(较新).
+ * 转存只把PSRAM链表头部的帧追加到TF文件末尾, 因此该顺序始终成立.
+ * 计数与标志只在持有_lock时修改, 原子类型供pending()无锁读取.
+*/
+struct Box {
+    int16_t head;
+    int16_t tail;
+    std::atomic<uint16_t> count;        // PSRAM中的帧数
+    std::atomic<uint32_t> tf_count;     // TF卡中未读的帧数, 含正在写入文件的帧
+    uint32_t tf_offset;                 // TF文件的读取位置
+    std::atomic<bool> known;            // 曾经登录过
+    std::atomic<bool> flushing;         // 后台任务正在投递
+};
+
+static Record* _records = nullptr;
+static int16_t _free_head = -1;
+static int _free_count = 0;
+static Box _boxes[ID_COUNT];
+static SemaphoreHandle_t _lock = nullptr;
+static TaskHandle_t _task = nullptr;
+/* 待投递的ID位图, 登录事件中置位, 后台任务中清除 */
+static std::atomic<uint32_t> _flush_requests[ID_COUNT / 32];
+
+static std::atomic<uint32_t> _stored = 0;
+static std::atomic<uint32_t> _delivered = 0;
+static std::atomic<uint32_t> _expired = 0;
+static std::atomic<uint32_t> _dropped = 0;
+static std::atomic<uint32_t> _spilled = 0;
+static std::atomic<uint32_t> _pending = 0;
+
+static uint32_t now_seconds() {
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+static bool expired(uint32_t stamp) {
+    return now_seconds() - stamp >= AppCfg::MAILBOX_TTL_S;
+}
+
+static void tf_path(uint8_t id, char* path, size_t size) {
+    snprintf(path, size, "%s/mbox/%u.bin", AppCfg::TF_MOUNT_POINT, (unsigned)id);
+}
+
+/* 以下函数须持有_lock */
+static int16_t record_alloc() {
+    int16_t index = _free_head;
+    if (index >= 0) {
+        _free_head = _records[index].next;
+        _free_count--;
+    }
+    return index;
+}
+
+static void record_free(int16_t index) {
+    _records[index].next = _free_head;
+    _free_head = index;
+    _free_count++;
+}
+
+// 拷贝PSRAM链表头部的帧到buf, 不取出
+static bool box_peek(const Box* box, uint8_t* buf, uint16_t& len, uint32_t& stamp) {
+    if (box->head < 0) return false;
+    const Record* record = &_records[box->head];
+    len = record->len;
+    stamp = record->stamp;
+    memcpy(buf, record->data, len);
+    return true;
+}
+
+// 释放PSRAM链表头部的帧
+static void box_drop(Box* box) {
+    int16_t index = box->head;
+    box->head = _records[index].next;
+    if (box->head < 0) box->tail = -1;
+    box->count--;
+    record_free(index);
+}
+
+// 取出PSRAM链表头部的帧, 拷贝到buf
+static bool box_pop(Box* box, uint8_t* buf, uint16_t& len, uint32_t& stamp) {
+    if (!box_peek(box, buf, len, stamp)) return false;
+    box_drop(box);
+    return true;
+}
+
+bool pending(uint8_t id) {
+    const Box* box = &_boxes[id];
+    /**
+     * 无锁读取, 只用于选择转发路径. 帧在PSRAM与TF之间移动时始终计入其一,
+     * flushing在投递完最后一帧后才在锁内清除, 因此不会误判为空而越过暂存帧
+    */
+    return _records != nullptr && box->known.load(std::memory_order_acquire)
+           && (box->count.load(std::memory_order_acquire) > 0 || box->tf_count.load(std::memory_order_acquire) > 0
+               || box->flushing.load(std::memory_order_acquire) || TcpServer::findSocketById(id) < 0);
+}
+
+bool store(uint8_t id, IBuf frame) {
+    if (_records == nullptr || frame.size() > FRAME_MAX) return false;
+    bool stored = false;
+    bool spill = false;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    Box* box = &_boxes[id];
+    if (box->known && box->count + box->tf_count < AppCfg::MAILBOX_PER_ID_MAX) {
+        int16_t index = record_alloc();
+        if (index >= 0) {
+            Record* record = &_records[index];
+            record->stamp = now_seconds();
+            record->len = frame.size();
+            record->next = -1;
+            memcpy(record->data, frame.data(), frame.size());
+            if (box->tail >= 0) {
+                _records[box->tail].next = index;
+            } else {
+                box->head = index;
+            }
+            box->tail = index;
+            box->count++;
+            stored = true;
+        }
+        spill = AppCfg::MAILBOX_FRAMES - _free_count > SPILL_LEVEL;
+    }
+    xSemaphoreGive(_lock);
+
+    if (stored) {
+        _stored++;
+        _pending++;
+    } else if (box->known) {
+        _dropped++;
+    }
+    if (spill) xTaskNotifyGive(_task);
+    return stored;
+}
+
+/**
+ * 把PSRAM占用最多的信箱的最早若干帧追加到其TF文件, 直到占用降到转存线以下.
+ * 转存, 投递与TTL清理都在信箱任务中执行, 彼此不会并发.
+*/
+static void spill(uint8_t* buf) {
+    if (!tf_card_mounted()) return;
+    while (true) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        bool over = AppCfg::MAILBOX_FRAMES - _free_count > SPILL_LEVEL;
+        int victim = -1;
+        for (int id = 0; over && id < ID_COUNT; id++) {
+            if (_boxes[id].count > 0 && (victim < 0 || _boxes[id].count > _boxes[victim].count)) {
+                victim = id;
+            }
+        }
+        if (victim < 0) {
+            xSemaphoreGive(_lock);
+            return;
+        }
+        /**
+         * 按记录逐帧取出, 写文件时不持锁. 取出时就计入tf_count, 写入期间该帧不会从计数中消失,
+         * pending()不会把目标误判为空而让新帧越过它; TF文件只由本任务读取, 不会读到未写完的记录
+        */
+        uint16_t len;
+        uint32_t stamp;
+        bool popped = box_pop(&_boxes[victim], buf, len, stamp);
+        if (popped) _boxes[victim].tf_count++;
+        xSemaphoreGive(_lock);
+        if (!popped) return;
+        TfRecord header = {stamp, len};
+
+        char path[32];
+        tf_path(victim, path, sizeof(path));
+        FILE* file = fopen(path, "ab");
+        bool ok = file != nullptr && fwrite(&header, sizeof(header), 1, file) == 1
+                  && fwrite(buf, header.len, 1, file) == 1;
+        if (file != nullptr) fclose(file);
+
+        if (ok) {
+            _spilled++;
+        } else {
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            _boxes[victim].tf_count--;
+            xSemaphoreGive(_lock);
+            ESP_LOGE(TAG, "spill to %s failed", path);
+            _dropped++;
+            _pending--;
+            return;
+        }
+    }
+}
+
+/**
+ * 读取TF文件中的下一帧, 不移动读取位置; 文件损坏时丢弃其余帧并删除文件.
+ * TF文件只由信箱任务读写与删除, 删除文件不必持锁
+*/
+static bool tf_peek(uint8_t id, Box* box, uint8_t* buf, uint16_t& len, uint32_t& stamp) {
+    if (box->tf_count == 0) return false;
+    char path[32];
+    tf_path(id, path, sizeof(path));
+    TfRecord header;
+    FILE* file = fopen(path, "rb");
+    bool ok = file != nullptr && fseek(file, box->tf_offset, SEEK_SET) == 0
+              && fread(&header, sizeof(header), 1, file) == 1 && header.len <= FRAME_MAX
+              && fread(buf, header.len, 1, file) == 1;
+    if (file != nullptr) fclose(file);
+    if (ok) {
+        len = header.len;
+        stamp = header.stamp;
+        return true;
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    // 文件损坏, 其余帧无法读出
+    uint32_t lost = box->tf_count;
+    _dropped += lost;
+    _pending -= lost;
+    box->tf_count = 0;
+    box->tf_offset = 0;
+    xSemaphoreGive(_lock);
+    ESP_LOGE(TAG, "read %s failed, drop %u frames", path, (unsigned)lost);
+    unlink(path);
+    return false;
+}
+
+// 移过TF文件中已处理的一帧, 文件读完后删除
+static void tf_advance(uint8_t id, Box* box, uint16_t len) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    box->tf_offset += sizeof(TfRecord) + len;
+    box->tf_count--;
+    bool done = box->tf_count == 0;
+    if (done) box->tf_offset = 0;
+    xSemaphoreGive(_lock);
+    if (done) {
+        char path[32];
+        tf_path(id, path, sizeof(path));
+        unlink(path);
+    }
+}
+
+/**
+ * 按顺序投递一个ID的全部暂存帧, 目标发送队列满或缓冲池耗尽时等待,
+ * 目标断开时中止(剩余帧保留). 每帧先读出不取出, 交给发送队列后才从信箱移除,
+ * 发送失败的帧仍在信箱头部, 不会丢失也不会乱序
+*/
+static void flush(uint8_t id, uint8_t* buf) {
+    Box* box = &_boxes[id];
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    box->flushing = true;
+    xSemaphoreGive(_lock);
+
+    int sock = TcpServer::findSocketById(id);
+    while (sock >= 0) {
+        TcpSender::Stats tx;
+        int slot = TcpServer::findSlotById(id);
+        if (slot < 0 || TcpServer::getSocket(slot) != sock) break;
+        if (TcpSender::getStats(slot, tx) && tx.depth >= AppCfg::TX_QUEUE_DEPTH - 1) {
+            vTaskDelay(pdMS_TO_TICKS(FLUSH_RETRY_MS));
+            continue;
+        }
+
+        uint16_t len;
+        uint32_t stamp;
+        bool from_tf = tf_peek(id, box, buf, len, stamp);
+        if (!from_tf) {
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            bool found = box_peek(box, buf, len, stamp);
+            if (!found && box->tf_count == 0) {
+                // 在锁内清除标志, 之后的新帧直接转发, 不会越过暂存帧
+                box->flushing = false;
+                xSemaphoreGive(_lock);
+                return;
+            }
+            xSemaphoreGive(_lock);
+            if (!found) continue;
+        }
+
+        bool live = !expired(stamp);
+        if (live) {
+            FramePool::Frame* frame = FramePool::alloc();
+            if (frame == nullptr) {
+                vTaskDelay(pdMS_TO_TICKS(FLUSH_RETRY_MS));
+                continue;
+            }
+            memcpy(frame->data, buf, len);
+            frame->len = len;
+            int res = TcpSender::post(sock, frame);
+            if (res == -1) break;           // 连接出错, 剩余帧等下次登录
+            if (res < 0) {
+                vTaskDelay(pdMS_TO_TICKS(FLUSH_RETRY_MS));
+                continue;
+            }
+        }
+
+        // 投递成功或已过期, 从信箱移除
+        if (from_tf) {
+            tf_advance(id, box, len);
+        } else {
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            box_drop(box);
+            xSemaphoreGive(_lock);
+        }
+        _pending--;
+        if (live) {
+            _delivered++;
+        } else {
+            _expired++;
+        }
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    box->flushing = false;
+    xSemaphoreGive(_lock);
+}
+
+// 丢弃PSRAM中超过TTL的帧; TF卡中的帧在读出时检查
+static void sweep() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    for (int id = 0; id < ID_COUNT; id++) {
+        Box* box = &_boxes[id];
+        while (box->head >= 0 && expired(_records[box->head].stamp)) {
+            box_drop(box);
+            _expired++;
+            _pending--;
+        }
+    }
+    xSemaphoreGive(_lock);
+}
+
+static void mailbox_task(void *arg) {
+    // 一帧的中转缓冲, 转存与投递共用
+    static uint8_t buf[FRAME_MAX];
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SWEEP_PERIOD_MS));
+        for (int word = 0; word < ID_COUNT / 32; word++) {
+            uint32_t bits = _flush_requests[word].exchange(0, std::memory_order_acquire);
+            while (bits) {
+                int bit = __builtin_ctz(bits);
+                bits &= bits - 1;
+                flush(word * 32 + bit, buf);
+            }
+        }
+        spill(buf);
+        sweep();
+    }
+}
+
+static void on_client_event(TcpServer::ClientEvent event, int slot) {
+    if (event != TcpServer::ClientEvent::LOGIN) return;
+    TcpServer::ClientInfo client;
+    if (!TcpServer::getClient(slot, client)) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _boxes[client.id].known = true;
+    xSemaphoreGive(_lock);
+    _flush_requests[client.id / 32].fetch_or(1u << (client.id % 32), std::memory_order_release);
+    xTaskNotifyGive(_task);
+}
+
+void read(Stats& out) {
+    out.stored = _stored;
+    out.delivered = _delivered;
+    out.expired = _expired;
+    out.dropped = _dropped;
+    out.spilled = _spilled;
+    out.pending = _pending;
+}
+
+// 信箱的时间戳以启动时刻为基准, 上次运行留下的TF文件无法判断TTL, 一律删除
+static void tf_clean() {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/mbox", AppCfg::TF_MOUNT_POINT);
+    mkdir(path, 0775);
+    DIR* dir = opendir(path);
+    if (dir == nullptr) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/mbox/%.12s", AppCfg::TF_MOUNT_POINT, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
+
+int init() {
+    if (!AppCfg::MAILBOX_ENABLE) return 0;
+
+    for (Box& box : _boxes) {
+        box.head = -1;
+        box.tail = -1;
+    }
+    _records = (Record *)heap_caps_calloc(AppCfg::MAILBOX_FRAMES, sizeof(Record), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    _lock = xSemaphoreCreateMutex();
+    if (_records == nullptr || _lock == nullptr) {
+        ESP_LOGE(TAG, "mailbox malloc failed");
+        _records = nullptr;
+        return -1;
+    }
+    for (int16_t i = AppCfg::MAILBOX_FRAMES - 1; i >= 0; i--) {
+        record_free(i);
+    }
+    if (tf_card_mounted()) {
+        tf_clean();
+    }
+
+    if (xTaskCreate(mailbox_task, "mailbox_task", 4 * 1024, nullptr, 4, &_task) != pdPASS) {
+        ESP_LOGE(TAG, "mailbox_task create failed");
+        _records = nullptr;
+        return -1;
+    }
+    TcpServer::registerEventCallback(on_client_event);
+    return 0;
+}
+
+}
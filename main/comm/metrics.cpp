@@ -0,0 +1,36 @@
+#include "metrics.h"
+
+#include <atomic>
+
+namespace Metrics {
+
+static std::atomic<uint32_t> _counters[COUNTER_COUNT];
+static std::atomic<uint32_t> _handler_latency[ConnStats::LATENCY_BUCKETS];
+
+void add(Counter counter, uint32_t n) {
+    _counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void peak(Counter counter, uint32_t value) {
+    uint32_t old = _counters[counter].load(std::memory_order_relaxed);
+    while (value > old && !_counters[counter].compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint32_t get(Counter counter) {
+    return _counters[counter].load(std::memory_order_relaxed);
+}
+
+void addHandlerLatency(uint32_t us) {
+    int bucket = us == 0 ? 0 : 31 - __builtin_clz(us);
+    if (bucket >= ConnStats::LATENCY_BUCKETS) bucket = ConnStats::LATENCY_BUCKETS - 1;
+    _handler_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void handlerLatency(uint32_t out[ConnStats::LATENCY_BUCKETS]) {
+    for (int i = 0; i < ConnStats::LATENCY_BUCKETS; i++) {
+        out[i] = _handler_latency[i].load(std::memory_order_relaxed);
+    }
+}
+
+}
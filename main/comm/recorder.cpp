@@ -0,0 +1,294 @@
+#include "recorder.h"
+#include "tcp_server.h"
+#include "tcp_data_handle.h"
+#include "tf_card.h"
+#include "app_config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Recorder {
+
+static const char TAG[] = "recorder";
+constexpr uint32_t SLOTS = AppCfg::RECORDER_RING_SLOTS;
+constexpr uint32_t MASK = SLOTS - 1;
+constexpr uint32_t CAPTURE_MAX = sizeof(TcpDataHandle::FrameHeader) + AppCfg::RECORDER_SNAPLEN;
+constexpr int FLUSH_PERIOD_MS = 1000;           // 缓冲未攒满时的最长写卡间隔
+static_assert(SLOTS >= 2 && (SLOTS & MASK) == 0, "RECORDER_RING_SLOTS must be a power of 2");
+
+struct FileHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t snaplen;
+    uint64_t start_us;
+} __attribute__((packed));
+
+struct RecordHeader {
+    uint64_t time_us;
+    uint8_t conn;
+    uint8_t flags;
+    uint16_t caplen;
+} __attribute__((packed));
+
+/**
+ * 多生产者单消费者的有界环形缓冲(每槽一个序号, 见Vyukov MPMC队列):
+ * 序号等于写位置时槽空闲, 等于写位置+1时已写好待读取.
+ * 生产者(接收任务)只做CAS与拷贝, 缓冲满时丢弃, 从不等待写卡任务.
+*/
+struct Slot {
+    std::atomic<uint32_t> seq;
+    RecordHeader header;
+    uint8_t data[CAPTURE_MAX];
+};
+
+static Slot* _ring = nullptr;
+static std::atomic<uint32_t> _enqueue_pos = 0;
+static std::atomic<uint32_t> _dequeue_pos = 0;
+static TaskHandle_t _task = nullptr;
+
+static std::atomic<bool> _active = false;
+static std::atomic<uint32_t> _session = 0;      // 每次start()加一, 写卡任务据此换新文件
+
+static std::atomic<uint32_t> _records = 0;
+static std::atomic<uint32_t> _drops = 0;
+static std::atomic<uint32_t> _bytes = 0;
+
+/* 以下只在写卡任务中访问 */
+static uint8_t* _wbuf = nullptr;
+static uint32_t _wlen = 0;
+static FILE* _file = nullptr;
+static uint32_t _file_bytes = 0;
+static uint32_t _file_index = 0;                // 下一个文件的序号
+
+static void file_path(uint32_t index, char* path, size_t size) {
+    snprintf(path, size, "%s/cap/cap%04u.bin", AppCfg::TF_MOUNT_POINT, (unsigned)(index % 10000));
+}
+
+bool active() {
+    return _active.load(std::memory_order_relaxed);
+}
+
+void capture(int sock, IBuf frame, uint8_t flags) {
+    if (!_active.load(std::memory_order_relaxed)) return;
+
+    uint32_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (1) {
+        slot = &_ring[pos & MASK];
+        int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            _drops.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t len = frame.size();
+    if (len > CAPTURE_MAX) {
+        len = CAPTURE_MAX;
+        flags |= RECORD_TRUNCATED;
+    }
+    TcpServer::ClientInfo client;
+    slot->header.time_us = esp_timer_get_time();
+    slot->header.conn = TcpServer::getClient(TcpServer::findSlotBySocket(sock), client) ? client.id : 0;
+    slot->header.flags = flags;
+    slot->header.caplen = len;
+    memcpy(slot->data, frame.data(), len);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // 积压到一半时提前唤醒写卡任务, 其余时候由其定时轮询, 接收路径不做通知
+    if (pos + 1 - _dequeue_pos.load(std::memory_order_relaxed) == SLOTS / 2) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+// 新建下一个序号的文件, 并删除RECORDER_FILES个之前的旧文件
+static void file_open() {
+    char path[40];
+    if (_file_index >= AppCfg::RECORDER_FILES) {
+        file_path(_file_index - AppCfg::RECORDER_FILES, path, sizeof(path));
+        unlink(path);
+    }
+    file_path(_file_index++, path, sizeof(path));
+    _file = fopen(path, "wb");
+    if (_file == nullptr) {
+        ESP_LOGE(TAG, "open %s failed", path);
+        return;
+    }
+    // 写卡任务自行攒批, 不需要stdio的缓冲
+    setvbuf(_file, nullptr, _IONBF, 0);
+    FileHeader header;
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.snaplen = AppCfg::RECORDER_SNAPLEN;
+    header.start_us = esp_timer_get_time();
+    if (fwrite(&header, sizeof(header), 1, _file) != 1) {
+        ESP_LOGE(TAG, "write %s failed", path);
+        fclose(_file);
+        _file = nullptr;
+        return;
+    }
+    _file_bytes = sizeof(header);
+    ESP_LOGI(TAG, "capture to %s", path);
+}
+
+static void file_close() {
+    if (_file == nullptr) return;
+    fclose(_file);
+    _file = nullptr;
+}
+
+/**
+ * 把写缓冲整块写入文件, sync为true时同时更新FAT表, 掉电最多丢失一个周期的记录.
+ * 写卡失败(卡满或拔出)时停止抓包.
+*/
+static void write_out(bool sync) {
+    if (_wlen == 0) return;
+    if (_file != nullptr && _file_bytes + _wlen > AppCfg::RECORDER_FILE_MAX) {
+        file_close();
+        file_open();
+    }
+    if (_file == nullptr || fwrite(_wbuf, _wlen, 1, _file) != 1) {
+        ESP_LOGE(TAG, "capture write failed, stop");
+        file_close();
+        _active.store(false, std::memory_order_relaxed);
+        _wlen = 0;
+        return;
+    }
+    if (sync) fsync(fileno(_file));
+    _file_bytes += _wlen;
+    _bytes.fetch_add(_wlen, std::memory_order_relaxed);
+    _wlen = 0;
+}
+
+// 取出环形缓冲中已写好的记录, 写缓冲满时整块写卡
+static void drain() {
+    uint32_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+    while (1) {
+        Slot* slot = &_ring[pos & MASK];
+        if (slot->seq.load(std::memory_order_acquire) != pos + 1) break;
+        uint32_t size = sizeof(RecordHeader) + slot->header.caplen;
+        if (_wlen + size > AppCfg::RECORDER_WRITE_BUF) {
+            write_out(false);
+        }
+        if (_file != nullptr) {
+            memcpy(_wbuf + _wlen, &slot->header, sizeof(RecordHeader));
+            memcpy(_wbuf + _wlen + sizeof(RecordHeader), slot->data, slot->header.caplen);
+            _wlen += size;
+            _records.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            _drops.fetch_add(1, std::memory_order_relaxed);
+        }
+        slot->seq.store(pos + SLOTS, std::memory_order_release);
+        _dequeue_pos.store(++pos, std::memory_order_relaxed);
+    }
+}
+
+static void recorder_task(void *arg) {
+    uint32_t session = 0;
+    while (1) {
+        bool timeout = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FLUSH_PERIOD_MS)) == 0;
+        uint32_t current = _session.load(std::memory_order_acquire);
+        if (_file != nullptr && current != session) {
+            // 重新开始抓包, 旧会话的剩余记录仍写入旧文件
+            drain();
+            write_out(true);
+            file_close();
+        }
+        if (_file == nullptr && active()) {
+            session = current;
+            file_open();
+            if (_file == nullptr) _active.store(false, std::memory_order_relaxed);
+        }
+
+        drain();
+        if (timeout || _wlen >= AppCfg::RECORDER_WRITE_BUF / 2) {
+            write_out(timeout);
+        }
+        if (_file != nullptr && !active()) {
+            // stop()之后仍在写入的记录会被丢弃
+            drain();
+            write_out(true);
+            file_close();
+        }
+    }
+}
+
+int start() {
+    if (_ring == nullptr || !tf_card_mounted()) return -1;
+    _session.fetch_add(1, std::memory_order_release);
+    _active.store(true, std::memory_order_relaxed);
+    xTaskNotifyGive(_task);
+    return 0;
+}
+
+void stop() {
+    if (_ring == nullptr) return;
+    _active.store(false, std::memory_order_relaxed);
+    xTaskNotifyGive(_task);
+}
+
+void read(Stats& out) {
+    out.records = _records;
+    out.drops = _drops;
+    out.bytes = _bytes;
+    out.active = active();
+}
+
+// 接着上次运行的最大文件序号编号, 旧文件按序号轮替删除
+static void scan_files() {
+    char path[32];
+    snprintf(path, sizeof(path), "%s/cap", AppCfg::TF_MOUNT_POINT);
+    mkdir(path, 0775);
+    DIR* dir = opendir(path);
+    if (dir == nullptr) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strncasecmp(entry->d_name, "cap", 3) != 0) continue;
+        uint32_t index = strtoul(entry->d_name + 3, nullptr, 10);
+        if (index + 1 > _file_index) _file_index = index + 1;
+    }
+    closedir(dir);
+}
+
+int init() {
+    _ring = (Slot *)heap_caps_calloc(SLOTS, sizeof(Slot), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    _wbuf = (uint8_t *)heap_caps_malloc(AppCfg::RECORDER_WRITE_BUF, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (_ring == nullptr || _wbuf == nullptr) {
+        ESP_LOGE(TAG, "recorder malloc failed");
+        _ring = nullptr;
+        return -1;
+    }
+    for (uint32_t i = 0; i < SLOTS; i++) {
+        _ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+    if (tf_card_mounted()) {
+        scan_files();
+    }
+
+    // 优先级低于接收与发送任务, 写卡只占用空闲时间
+    if (xTaskCreate(recorder_task, "recorder_task", 3 * 1024, nullptr, 2, &_task) != pdPASS) {
+        ESP_LOGE(TAG, "recorder_task create failed");
+        _ring = nullptr;
+        return -1;
+    }
+    if (AppCfg::RECORDER_AUTOSTART) {
+        start();
+    }
+    return 0;
+}
+
+}
@@ -1,136 +1,600 @@
 #include "tcp_data_handle.h"
 #include "tcp_server.h"
-#include "socket_wrapper.h"
+#include "frame_assembler.h"
+#include "frame_pool.h"
+#include "tcp_sender.h"
+#include "app_config.h"
 #include "json_wrapper.h"
-#include "shell_wrapper.h"
-#include "utility_wrapper.h"
+#include "cmds.h"
+#include "metrics.h"
+#include "mailbox.h"
+#include "recorder.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include <cstring>
+#include <cctype>
+#include <atomic>
 
 namespace TcpDataHandle {
 
 static const char TAG[] = "tcp_data_handle";
-static uint8_t* _tx_buffer = nullptr;
+constexpr int CMD_MAX_ARGS  = 8;            // 命令名在内的最大参数个数
+constexpr int CMD_ARGS_SIZE = 256;          // 文本/二进制命令参数解码缓冲
 
-FrameHeader frameUnpack(IBuf& buf, OBuf& out) {
-    FrameHeader frame;
-    memset(&frame, 0, sizeof(frame));
+/**
+ * 连接代数与待应答命令数合在一个原子量中: 高位为代数, 槽位换给新连接或连接断开时递增,
+ * 同时待应答数清零; 命令任务只在代数未变时执行命令并递减计数, 旧连接的命令不会落到新连接上.
+*/
+constexpr uint32_t GEN_ONE       = 1u << 8;
+constexpr uint32_t DEFERRED_MASK = GEN_ONE - 1;
+// 排队的加上正在执行的一条, 计数不会进位到代数
+static_assert(AppCfg::CMD_TASK_QUEUE + 1 < DEFERRED_MASK, "deferred count overflows into the generation");
+
+/* 每个连接一个帧重组器, 按客户端注册表槽位索引, init()时一次性分配 */
+struct StreamSlot {
+    int sock;
+    int relay_sock;             // 大帧直通转发的目标, -1表示丢弃
+    bool paused;                // 目标背压, 已暂停读取本连接
+    std::atomic<uint32_t> gen;  // 高位: 连接代数; 低8位: 已交给命令任务尚未应答的命令数
+    FrameAssembler assembler;
+};
+static StreamSlot* _streams = nullptr;
 
-    /* data frame parse*/
-    frame = *(FrameHeader *)buf.data();
-    if (frame.head != TcpDataHandle::FRAME_HEAD || frame.length != (buf.size() - sizeof(FrameHeader))) {
-        out.clear();
-        frame.type = FrameType::UNKNOWN;
-        return frame;
+/* 交给命令任务的命令, 请求帧拷贝在缓冲池帧中 */
+struct CommandJob {
+    int sock;
+    int slot;
+    uint32_t gen;               // 入队时的连接代数(不含计数)
+    FramePool::Frame* request;
+};
+static QueueHandle_t _cmd_queue = nullptr;
+/* 正在执行的命令来自哪个连接, 网络任务与命令任务各一份 */
+static thread_local int _command_sock = -1;
+/* 每个连接订阅的组播位图, 按客户端注册表槽位索引 */
+static std::atomic<uint16_t> _groups[AppCfg::TCP_MAX_CLIENTS];
+
+// 进入新的连接代数, 排队中的旧命令随之作废
+static void stream_retire(StreamSlot* stream) {
+    uint32_t state = stream->gen.load(std::memory_order_relaxed);
+    while (!stream->gen.compare_exchange_weak(state, (state & ~DEFERRED_MASK) + GEN_ONE, std::memory_order_acq_rel)) {
     }
+}
+
+// 命令仍属于入队时的连接
+static bool stream_current(const StreamSlot* stream, uint32_t gen) {
+    return (stream->gen.load(std::memory_order_acquire) & ~DEFERRED_MASK) == gen;
+}
+
+static uint32_t stream_deferred(const StreamSlot* stream) {
+    return stream->gen.load(std::memory_order_acquire) & DEFERRED_MASK;
+}
+
+// 一条排队命令结束, 连接代数已变(计数已清零)时不再递减
+static void stream_undefer(StreamSlot* stream, uint32_t gen) {
+    uint32_t state = stream->gen.load(std::memory_order_relaxed);
+    while ((state & ~DEFERRED_MASK) == gen && (state & DEFERRED_MASK) > 0
+           && !stream->gen.compare_exchange_weak(state, state - 1, std::memory_order_acq_rel)) {
+    }
+}
+
+static StreamSlot* stream_get(int sock) {
+    int slot = TcpServer::findSlotBySocket(sock);
+    if (_streams == nullptr || slot < 0) return nullptr;
+    StreamSlot* stream = &_streams[slot];
+    if (stream->sock != sock) {
+        stream_retire(stream);
+        stream->sock = sock;
+        stream->relay_sock = -1;
+        stream->paused = false;
+        stream->assembler.reset();
+    }
+    return stream;
+}
+
+static FrameHeader frame_header(uint8_t goal, FrameType type, uint32_t length) {
+    FrameHeader header;
+    header.head = TcpDataHandle::FRAME_HEAD;
+    header.type = type;
+    header.goal = goal;
+    header.source = SERVER_ID;
+    header.length = length;
+    return header;
+}
+
+static bool is_multicast(uint8_t goal) {
+    return goal >= GROUP_ID_BASE;
+}
+
+/**
+ * 广播/组播扇出: 帧只序列化一次, 各订阅者的发送队列共享同一缓冲池帧.
+ * header为空时frame已含帧头. 调用者的引用在此释放, 返回投递的连接数.
+*/
+static int frame_fanout(int source_sock, uint8_t goal, FramePool::Frame* frame, const FrameHeader* header) {
+    int count = 0;
+    uint16_t mask = goal == BROADCAST_ID ? 0 : (uint16_t)(1 << (goal - GROUP_ID_BASE));
+    for (int slot = 0; slot < AppCfg::TCP_MAX_CLIENTS; slot++) {
+        int sock = TcpServer::getSocket(slot);
+        if (sock < 0 || sock == source_sock) continue;
+        if (mask != 0 && !(_groups[slot].load(std::memory_order_relaxed) & mask)) continue;
 
-    out = buf.substr(sizeof(FrameHeader));
-    return frame;
+        FramePool::retain(frame);
+        if (header != nullptr) {
+            TcpSender::post(sock, *header, frame);
+        } else {
+            TcpSender::post(sock, frame);
+        }
+        count++;
+    }
+    FramePool::release(frame);
+    return count;
 }
 
 int packageSend(uint8_t goal, FrameType type, IBuf buf) {
-    TcpServer::ClientInfo* client = TcpServer::getClientsInfo();
-    if (_tx_buffer == nullptr) return -1;
-    for ( ; client; client = client->next) {
-        if (client->id == goal) {
-            break;
-        }
-    }
-    if (client == nullptr) return -2;
-    
-    _tx_buffer[0] = TcpDataHandle::FRAME_HEAD;
-    _tx_buffer[1] = type;
-    _tx_buffer[2] = goal;
-    _tx_buffer[3] = 1;
-    *(uint16_t *)&_tx_buffer[4] = buf.size();
-    memcpy(&_tx_buffer[6], buf.data(), buf.size());
-
-    return Wrapper::Socket::send(client->socket, _tx_buffer, buf.size() + sizeof(FrameHeader));
-}
-
-int packageRespond(int sock, FrameType type, IBuf buf) {
-    TcpServer::ClientInfo* client = TcpServer::getClientsInfo();
-    if (_tx_buffer == nullptr) return -1;
-    for ( ; client; client = client->next) {
-        if (client->socket == sock) {
-            break;
-        }
-    }
-    if (client == nullptr) return -2;
-    
-    _tx_buffer[0] = TcpDataHandle::FRAME_HEAD;
-    _tx_buffer[1] = type;
-    _tx_buffer[2] = client->id;
-    _tx_buffer[3] = 1;
-    *(uint16_t *)&_tx_buffer[4] = buf.size();
-    memcpy(&_tx_buffer[6], buf.data(), buf.size());
-
-    return Wrapper::Socket::send(sock, _tx_buffer, buf.size() + sizeof(FrameHeader));
-}
-
-OBuf json_string_parse(IBuf buf) {
-    std::string json_str = (char *)buf.data();
-    Wrapper::JsonObject json(json_str);
-    OBuf out;
-    if (!json.isObject()) {
-        ESP_LOGE(TAG, "json parse failed.");
-        return out;
+    int sock = -1;
+    if (!is_multicast(goal)) {
+        sock = TcpServer::findSocketById(goal);
+        if (sock < 0) return -2;
     }
+    if (buf.size() > TcpServer::SOCK_BUF_SIZE) return -3;
 
-    if (json["cmd"].isString()) {
-        out = Wrapper::Utility::snprint("%s", json["cmd"].getString().data());
+    /* 负载拷入缓冲池帧, 帧头由发送队列单独发送 */
+    FramePool::Frame* payload = FramePool::alloc();
+    if (payload == nullptr) return -1;
+    memcpy(payload->data, buf.data(), buf.size());
+    payload->len = buf.size();
+    FrameHeader header = frame_header(goal, type, buf.size());
+    if (is_multicast(goal)) {
+        return frame_fanout(-1, goal, payload, &header);
     }
+    return TcpSender::post(sock, header, payload);
+}
+
+int subscribe(int sock, uint8_t group) {
+    int slot = TcpServer::findSlotBySocket(sock);
+    if (slot < 0 || group >= GROUP_COUNT) return -1;
+    _groups[slot].fetch_or(1 << group, std::memory_order_relaxed);
+    return 0;
+}
+
+int unsubscribe(int sock, uint8_t group) {
+    int slot = TcpServer::findSlotBySocket(sock);
+    if (slot < 0 || group >= GROUP_COUNT) return -1;
+    _groups[slot].fetch_and(~(1 << group), std::memory_order_relaxed);
+    return 0;
+}
+
+uint16_t subscriptions(int sock) {
+    int slot = TcpServer::findSlotBySocket(sock);
+    if (slot < 0) return 0;
+    return _groups[slot].load(std::memory_order_relaxed);
+}
+
+/**
+ * 应答已写入reply的负载区, 补上帧头后整帧交给发送队列
+*/
+static int packageRespond(int sock, FrameType type, FramePool::Frame* reply, cmds::JsonWriter& out) {
+    TcpServer::ClientInfo client;
+    if (!TcpServer::getClient(TcpServer::findSlotBySocket(sock), client)) {
+        FramePool::release(reply);
+        return -2;
+    }
+    if (out.overflow()) {
+        ESP_LOGE(TAG, "respond too long");
+        out.clear(type == FrameType::BCMD ? 1 : 0);
+        out.printf("respond too long\n");
+    }
+
+    FrameHeader header = frame_header(client.id, type, out.size());
+    memcpy(reply->data, &header, sizeof(FrameHeader));
+    reply->len = sizeof(FrameHeader) + out.size();
+    return TcpSender::post(sock, reply);
+}
+
+/**
+ * JSON命令兼容模式: 直接取出cmd与args交给命令处理, 不再拼接命令行字符串.
+ * 以下三种命令在may_block为false时遇到会阻塞的命令不执行, 返回false.
+*/
+static bool json_command(IBuf buf, cmds::JsonWriter& out, bool may_block) {
+    Wrapper::JsonObject json(std::string((const char *)buf.data(), buf.size()));
+    if (!json.isObject() || !json["cmd"].isString()) {
+        ESP_LOGE(TAG, "json parse failed.");
+        return true;
+    }
+
+    std::string words[CMD_MAX_ARGS];
+    char* argv[CMD_MAX_ARGS];
+    int argc = 0;
+    words[argc++] = json["cmd"].getString();
     if (json["args"].isArray()) {
-        for (int i = 0; i < json["args"].getArraySize(); i++) {
-            out += Wrapper::Utility::snprint(" %s", json["args"][i].getString().data());
+        for (int i = 0; i < json["args"].getArraySize() && argc < CMD_MAX_ARGS; i++) {
+            words[argc++] = json["args"][i].getString();
         }
     }
+    for (int i = 0; i < argc; i++) {
+        argv[i] = words[i].data();
+    }
+    if (!may_block && cmds::blocking(argc, argv)) return false;
+    cmds::respond(argc, argv, out);
+    return true;
+}
 
-    return out;
+/**
+ * 文本命令: 拷贝到栈上缓冲后按空白切分, 双引号内的空白保留
+*/
+static bool text_command(IBuf buf, cmds::JsonWriter& out, bool may_block) {
+    char line[CMD_ARGS_SIZE];
+    char* argv[CMD_MAX_ARGS];
+    int argc = 0;
+    if (buf.size() >= CMD_ARGS_SIZE) {
+        out.printf("command too long\n");
+        return true;
+    }
+    memcpy(line, buf.data(), buf.size());
+    line[buf.size()] = '\0';
+
+    char* p = line;
+    while (*p) {
+        while (isspace((uint8_t)*p)) *p++ = '\0';
+        if (*p == '\0') break;
+        if (argc >= CMD_MAX_ARGS) {
+            out.printf("too many args\n");
+            return true;
+        }
+        if (*p == '"') {
+            argv[argc++] = ++p;
+            while (*p && *p != '"') p++;
+        } else {
+            argv[argc++] = p;
+            while (*p && !isspace((uint8_t)*p)) p++;
+        }
+        if (*p) *p++ = '\0';
+    }
+    if (argc == 0) return true;
+    if (!may_block && cmds::blocking(argc, argv)) return false;
+    cmds::respond(argc, argv, out);
+    return true;
 }
 
-void response(int sock, IBuf info) {
-    OBuf buf;
-    OBuf out;
-    FrameHeader frame = frameUnpack(info, buf);
-    if (frame.type == FrameType::UNKNOWN) {
-        ESP_LOGE(TAG, "unknown frame.");
+/**
+ * 二进制命令: 参数解码到栈上缓冲, 按操作码直接调用处理函数
+*/
+static bool binary_command(IBuf buf, cmds::JsonWriter& out, bool may_block) {
+    char args[CMD_ARGS_SIZE];
+    char* argv[CMD_MAX_ARGS];
+    int argc = 0;
+    uint32_t used = 0;
+    if (buf.empty()) {
+        out.printf("empty command");
+        return true;
+    }
+    if (!may_block && cmds::blocking(buf[0])) return false;
+
+    out.byte(buf[0]);
+    for (uint32_t pos = 1; pos < buf.size(); ) {
+        if (pos + 2 > buf.size() || argc >= CMD_MAX_ARGS) {
+            out.printf("bad command args");
+            return true;
+        }
+        uint8_t type = buf[pos];
+        uint8_t len = buf[pos + 1];
+        pos += 2;
+        if (pos + len > buf.size()) {
+            out.printf("bad command args");
+            return true;
+        }
+
+        char* arg = &args[used];
+        uint32_t space = CMD_ARGS_SIZE - used;
+        if (type == TLV_STR && len < space) {
+            memcpy(arg, &buf[pos], len);
+            arg[len] = '\0';
+            used += len + 1;
+        } else if (type == TLV_U32 && len == sizeof(uint32_t) && space >= 11) {
+            uint32_t value;
+            memcpy(&value, &buf[pos], sizeof(value));
+            used += snprintf(arg, space, "%u", (unsigned)value) + 1;
+        } else {
+            out.printf("bad command args");
+            return true;
+        }
+        argv[argc++] = arg;
+        pos += len;
+    }
+    cmds::exec(buf[0], argc, argv, out);
+    return true;
+}
+
+/**
+ * 执行发往服务器的命令帧并应答. may_block为false(网络任务中)时遇到会阻塞的命令不执行,
+ * 返回false由调用者交给命令任务. job非空(命令任务中)时, 执行期间连接已断开则不应答.
+*/
+static bool command_frame(int sock, const FrameHeader& frame, IBuf payload, bool may_block,
+                          const CommandJob* job = nullptr) {
+    /* 应答直接写入缓冲池帧的负载区, 处理过程不申请堆内存 */
+    FramePool::Frame* reply = FramePool::alloc();
+    if (reply == nullptr) {
+        Metrics::add(Metrics::POOL_EXHAUSTED);
+        HOT_LOGW(TAG, "frame pool exhausted, drop command");
+        return true;
+    }
+    uint32_t start = ConnStats::now();
+    cmds::JsonWriter out(reply->data + sizeof(FrameHeader), AppCfg::CMD_REPLY_MAX);
+    FrameType reply_type = FrameType::CMD;
+    bool done = true;
+    _command_sock = sock;
+    switch (frame.type) {
+    case FrameType::JSON:
+        done = json_command(payload, out, may_block);
+        break;
+    case FrameType::CMD:
+        done = text_command(payload, out, may_block);
+        break;
+    case FrameType::BCMD:
+        done = binary_command(payload, out, may_block);
+        reply_type = FrameType::BCMD;
+        break;
+    case FrameType::PING:
+        out.raw((const char *)payload.data(), payload.size());
+        reply_type = FrameType::PONG;
+        break;
+    default:
+        out.printf("unknown frame type");
+        break;
+    }
+    _command_sock = -1;
+    if (!done) {
+        FramePool::release(reply);
+        return false;
+    }
+    Metrics::addHandlerLatency(ConnStats::now() - start);
+    if (job != nullptr && !stream_current(&_streams[job->slot], job->gen)) {
+        FramePool::release(reply);
+        return true;
+    }
+    // send response
+    packageRespond(sock, reply_type, reply, out);
+    return true;
+}
+
+/**
+ * 命令帧拷贝进缓冲池帧后交给命令任务; 队列已满或缓冲池耗尽时回复忙
+*/
+static void command_defer(StreamSlot* stream, IBuf info) {
+    CommandJob job = { stream->sock, (int)(stream - _streams), 0, FramePool::alloc() };
+    if (job.request != nullptr) {
+        memcpy(job.request->data, info.data(), info.size());
+        job.request->len = info.size();
+        // 只有网络任务改变代数, 计数加一与读取代数不会与之交错
+        job.gen = stream->gen.fetch_add(1, std::memory_order_acq_rel) & ~DEFERRED_MASK;
+        if (xQueueSend(_cmd_queue, &job, 0) == pdTRUE) return;
+        stream_undefer(stream, job.gen);
+        FramePool::release(job.request);
+    }
+
+    FramePool::Frame* reply = FramePool::alloc();
+    if (reply == nullptr) {
+        Metrics::add(Metrics::POOL_EXHAUSTED);
+        HOT_LOGW(TAG, "frame pool exhausted, drop command");
         return;
     }
+    FrameHeader frame;
+    memcpy(&frame, info.data(), sizeof(FrameHeader));
+    cmds::JsonWriter out(reply->data + sizeof(FrameHeader), AppCfg::CMD_REPLY_MAX);
+    FrameType reply_type = frame.type == FrameType::BCMD ? FrameType::BCMD : FrameType::CMD;
+    if (reply_type == FrameType::BCMD && info.size() > sizeof(FrameHeader)) out.byte(info[sizeof(FrameHeader)]);
+    out.object().add(KEY_STATUS, STATUS_FAIL).add("reason", "busy").end().byte('\n');
+    HOT_LOGW(TAG, "[sock=%d]: command task busy", stream->sock);
+    packageRespond(stream->sock, reply_type, reply, out);
+}
+
+/**
+ * 命令任务: 按到达顺序执行会阻塞的命令及同一连接随后的命令, 网络任务不被阻塞
+*/
+static void command_task(void *arg) {
+    CommandJob job;
+    while (1) {
+        xQueueReceive(_cmd_queue, &job, portMAX_DELAY);
+        StreamSlot* stream = &_streams[job.slot];
+        // 排队期间连接已断开(槽位与套接字号可能已被新连接复用)则丢弃
+        if (stream_current(stream, job.gen)) {
+            FrameHeader frame;
+            IBuf info(job.request->data, job.request->len);
+            memcpy(&frame, info.data(), sizeof(FrameHeader));
+            command_frame(job.sock, frame, info.substr(sizeof(FrameHeader)), true, &job);
+        }
+        FramePool::release(job.request);
+        stream_undefer(stream, job.gen);
+    }
+}
+
+/**
+ * 处理一个完整帧(已由重组器校验帧头与长度)
+*/
+static void frame_dispatch(StreamSlot* stream, IBuf info) {
+    int sock = stream->sock;
+    FrameHeader frame;
+    memcpy(&frame, info.data(), sizeof(FrameHeader));
+    IBuf payload = info.substr(sizeof(FrameHeader));
     if (frame.goal != SERVER_ID) {
         /* 桢数据转发 */
-        for (TcpServer::ClientInfo *list = TcpServer::getClientsInfo(); list; list = list->next) {
-            if (list->id == frame.goal) {
-                /* transmit */
-                Wrapper::Socket::send(list->socket, info.data(), info.size());
-                break;
+        int goal_sock = -1;
+        if (!is_multicast(frame.goal)) {
+            // 目标离线或信箱中仍有未投递的帧时交给信箱, 保持投递顺序
+            if (Mailbox::pending(frame.goal)) {
+                Mailbox::store(frame.goal, info);
+                return;
             }
+            goal_sock = TcpServer::findSocketById(frame.goal);
+            if (goal_sock < 0) {
+                Metrics::add(Metrics::UNKNOWN_DEST);
+                return;
+            }
+        }
+        /* 拷贝进缓冲池帧后交给目标连接的发送队列, 不阻塞接收 */
+        FramePool::Frame* relay = FramePool::alloc();
+        if (relay == nullptr) {
+            Metrics::add(Metrics::POOL_EXHAUSTED);
+            HOT_LOGW(TAG, "frame pool exhausted, drop frame to %d", frame.goal);
+            return;
+        }
+        memcpy(relay->data, info.data(), info.size());
+        relay->len = info.size();
+        relay->stamp = ConnStats::now();
+        if (is_multicast(frame.goal)) {
+            frame_fanout(sock, frame.goal, relay, nullptr);
+        } else {
+            TcpSender::post(goal_sock, relay);
         }
     } else {
-        ESP_LOGI(TAG, "type: %d", frame.type);
-        switch (frame.type) {
-        case FrameType::JSON:
-            out = Wrapper::Shell::response(json_string_parse(buf.data()));
-            break;
-        case FrameType::CMD:
-            out = Wrapper::Shell::response(buf);
-            break;
-        default:
-            out = Wrapper::Utility::snprint("unknown frame type");
-            break;
+        HOT_LOGD(TAG, "type: %d", frame.type);
+        // 服务器不主动发PING, 收到的PONG无需处理; 任何收到的数据都已重置空闲计时
+        if (frame.type == FrameType::PONG) return;
+        // 本连接仍有命令在命令任务中时随之排队, 保持应答顺序
+        if (stream_deferred(stream) > 0 || !command_frame(sock, frame, payload, false)) {
+            command_defer(stream, info);
+        }
+    }
+}
+
+/**
+ * 大帧直通转发: 数据到达多少转发多少, 不缓存整帧.
+ * 返回false表示目标暂时无法接收(队列满或正被其它流占用), 稍后重试.
+*/
+static bool stream_relay(int sock, StreamSlot* stream) {
+    FrameAssembler& assembler = stream->assembler;
+    if (assembler.streamOffset() == 0) {
+        const FrameHeader& header = assembler.streamHeader();
+        int goal_sock = -1;
+        if (header.goal != SERVER_ID && !is_multicast(header.goal)) {
+            goal_sock = TcpServer::findSocketById(header.goal);
+        }
+        if (goal_sock >= 0) {
+            int res = TcpSender::streamBegin(goal_sock, sock);
+            if (res == -2) return false;
+            if (res < 0) goal_sock = -1;
         }
-        // send response
-        packageRespond(sock, FrameType::CMD, out);
+        if (goal_sock < 0) {
+            Metrics::add(Metrics::UNKNOWN_DEST);
+            HOT_LOGW(TAG, "drop large frame to %d, len %d", header.goal, (int)header.length);
+        }
+        Recorder::capture(sock, IBuf((const uint8_t *)&header, sizeof(FrameHeader)), Recorder::RECORD_STREAM);
+        ConnStats::addRxFrame(TcpServer::findSlotBySocket(sock));
+        stream->relay_sock = goal_sock;
+    }
+
+    while (assembler.streaming()) {
+        IBuf chunk = assembler.streamPeek(FrameAssembler::FRAME_MAX);
+        if (chunk.empty()) return true;
+        if (stream->relay_sock >= 0) {
+            FramePool::Frame* frame = FramePool::alloc();
+            if (frame == nullptr) return false;
+            memcpy(frame->data, chunk.data(), chunk.size());
+            frame->len = chunk.size();
+            int res = TcpSender::streamPost(stream->relay_sock, sock, frame);
+            if (res == -2) return false;
+            if (res < 0) {
+                // 目标已断开, 丢弃剩余数据
+                stream->relay_sock = -1;
+            }
+        }
+        assembler.streamConsume(chunk.size());
+    }
+
+    if (stream->relay_sock >= 0) {
+        TcpSender::streamEnd(stream->relay_sock, sock);
+        stream->relay_sock = -1;
     }
+    return true;
+}
+
+void response(int sock, IBuf info) {
+    StreamSlot* stream = stream_get(sock);
+    if (stream == nullptr) {
+        ESP_LOGE(TAG, "no frame stream for sock %d", sock);
+        return;
+    }
+
+    /* 一次接收可能包含零个或多个完整帧; 暂停读取期间info为空, 仅重试直通转发 */
+    IBuf frame;
+    bool blocked = false;
+    info.remove_prefix(stream->assembler.push(info));
+    while (1) {
+        if (stream->assembler.streaming()) {
+            if (!stream_relay(sock, stream)) {
+                blocked = true;
+                break;
+            }
+            if (stream->assembler.streaming()) break;
+            continue;
+        }
+        if (!stream->assembler.pop(frame)) break;
+        ConnStats::addRxFrame(TcpServer::findSlotBySocket(sock));
+        Recorder::capture(sock, frame);
+        frame_dispatch(stream, frame);
+    }
+    if (!info.empty()) {
+        ESP_LOGE(TAG, "[sock=%d]: rx ring overflow, drop %d bytes", sock, (int)info.size());
+    }
+
+    /* 目标无法接收时暂停读取源连接, 由环形缓冲承接已收到的数据 */
+    if (blocked != stream->paused) {
+        stream->paused = blocked;
+        TcpServer::pauseRecv(sock, blocked);
+    }
+}
+
+uint32_t rejectFrame(const char* reason, uint8_t* buf, uint32_t cap) {
+    if (cap <= sizeof(FrameHeader)) return 0;
+    cmds::JsonWriter out(buf + sizeof(FrameHeader), cap - sizeof(FrameHeader));
+    out.object().add(KEY_STATUS, STATUS_FAIL).add("reason", reason).end().raw("\n", 1);
+    if (out.overflow()) return 0;
+    FrameHeader header = frame_header(0, FrameType::CMD, out.size());
+    memcpy(buf, &header, sizeof(FrameHeader));
+    return sizeof(FrameHeader) + out.size();
+}
+
+int commandSource() {
+    return _command_sock;
+}
+
+void disconnect(int sock, int slot) {
+    if (_streams != nullptr && slot >= 0 && _streams[slot].sock == sock) {
+        // 直通转发中途断开, 目标收到的是不完整的帧
+        if (_streams[slot].relay_sock >= 0) {
+            TcpSender::streamAbort(_streams[slot].relay_sock, sock);
+        }
+        stream_retire(&_streams[slot]);
+        _streams[slot].sock = -1;
+    }
+    if (slot >= 0) {
+        _groups[slot].store(0, std::memory_order_relaxed);
+    }
+    TcpSender::disconnect(sock, slot);
 }
 
 int init() {
-    /* allocation sock date buffer */
-    _tx_buffer = (uint8_t *)heap_caps_malloc(TcpServer::SOCK_BUF_SIZE + sizeof(FrameHeader), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (_tx_buffer == NULL) {
-        ESP_LOGE(TAG, "tx buffer malloc failed");
+    if (FramePool::init() < 0 || TcpSender::init() < 0) {
+        ESP_LOGE(TAG, "tx path init failed");
+        return -1;
+    }
+
+    _streams = (StreamSlot *)heap_caps_calloc(AppCfg::TCP_MAX_CLIENTS, sizeof(StreamSlot), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (_streams == NULL) {
+        ESP_LOGE(TAG, "frame stream malloc failed");
+        return -1;
+    }
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        _streams[i].sock = -1;
+    }
+
+    // 优先级低于接收与发送任务, 阻塞期间不影响转发
+    _cmd_queue = xQueueCreate(AppCfg::CMD_TASK_QUEUE, sizeof(CommandJob));
+    if (_cmd_queue == nullptr || xTaskCreate(command_task, "command_task", 4 * 1024, nullptr, 5, nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "command_task create failed");
         return -1;
     }
     return 0;
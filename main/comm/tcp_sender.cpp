@@ -0,0 +1,403 @@
+#include "tcp_sender.h"
+#include "tcp_server.h"
+#include "app_config.h"
+#include "metrics.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#else
+#include <lwip/sockets.h>
+#endif
+#include "esp_log.h"
+#include <cerrno>
+#include <cstring>
+
+namespace TcpSender {
+
+static const char TAG[] = "tcp_sender";
+constexpr int SELECT_TIMEOUT_MS = 10;
+
+/**
+ * 发送队列条目: 帧头与负载分开存放, 由sendmsg()一次聚合发出.
+ * 负载为缓冲池帧, 可被多个队列共享.
+*/
+struct TxEntry {
+    uint8_t header[sizeof(TcpDataHandle::FrameHeader)];
+    uint8_t header_len;             // 0表示帧头已包含在负载中
+    FramePool::Frame* frame;
+    uint32_t sent;                  // 已发送字节数(含帧头)
+};
+
+/**
+ * 每个连接一个有界发送队列(按客户端注册表槽位索引).
+ * 连接空闲时由投递方直接非阻塞发送, 否则排队交给发送任务排空,
+ * 接收方无需等待目标连接发送完成即可继续读取.
+*/
+struct TxSlot {
+    int sock;
+    QueueHandle_t queue;
+    QueueHandle_t deferred;         // 直通转发期间暂存的其它帧
+    int stream_owner;               // 独占发送流的源连接, -1表示无
+    TxEntry entry;                  // 正在发送的条目
+    bool busy;
+    Stats stats;
+};
+
+static TxSlot _slots[AppCfg::TCP_MAX_CLIENTS];
+static SemaphoreHandle_t _slots_lock = nullptr;
+static TaskHandle_t _sender_task = nullptr;
+
+static void count_drop(TxSlot* slot) {
+    slot->stats.drops++;
+    Metrics::add(Metrics::TX_DROPS);
+}
+
+static IBuf entry_payload(const TxEntry* entry) {
+    return IBuf(entry->frame->data, entry->frame->len);
+}
+
+static void entry_release(TxEntry* entry) {
+    if (entry->frame != nullptr) {
+        FramePool::release(entry->frame);
+    }
+    entry->frame = nullptr;
+}
+
+/* 以下函数须在 _slots_lock 内调用 */
+static void slot_drop(TxSlot* slot) {
+    TxEntry entry;
+    if (slot->busy) {
+        entry_release(&slot->entry);
+        slot->busy = false;
+        count_drop(slot);
+    }
+    while (xQueueReceive(slot->queue, &entry, 0) == pdTRUE) {
+        entry_release(&entry);
+        count_drop(slot);
+    }
+    while (xQueueReceive(slot->deferred, &entry, 0) == pdTRUE) {
+        entry_release(&entry);
+        count_drop(slot);
+    }
+    slot->stream_owner = -1;
+    slot->stats.depth = 0;
+}
+
+// 排队帧数: 发送中, 发送队列与直通转发期间暂存的帧
+static uint16_t slot_depth(TxSlot* slot) {
+    return uxQueueMessagesWaiting(slot->queue) + uxQueueMessagesWaiting(slot->deferred) + (slot->busy ? 1 : 0);
+}
+
+static TxSlot* slot_get(int sock) {
+    int index = TcpServer::findSlotBySocket(sock);
+    if (index < 0) return nullptr;
+    TxSlot* slot = &_slots[index];
+    if (slot->sock != sock) {
+        slot_drop(slot);
+        slot->sock = sock;
+        memset(&slot->stats, 0, sizeof(Stats));
+    }
+    return slot;
+}
+
+/**
+ * 非阻塞发送直到发送缓冲满或队列为空, 返回false表示连接异常
+*/
+static bool slot_flush(TxSlot* slot) {
+    while (1) {
+        if (!slot->busy) {
+            if (xQueueReceive(slot->queue, &slot->entry, 0) != pdTRUE) return true;
+            slot->busy = true;
+        }
+
+        TxEntry* entry = &slot->entry;
+        IBuf payload = entry_payload(entry);
+        uint32_t total = entry->header_len + payload.size();
+        uint32_t sent = entry->sent;
+        struct iovec iov[2];
+        int iov_count = 0;
+        if (sent < entry->header_len) {
+            iov[iov_count].iov_base = entry->header + sent;
+            iov[iov_count].iov_len = entry->header_len - sent;
+            iov_count++;
+            sent = 0;
+        } else {
+            sent -= entry->header_len;
+        }
+        iov[iov_count].iov_base = (void *)(payload.data() + sent);
+        iov[iov_count].iov_len = payload.size() - sent;
+        iov_count++;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+        int len = sendmsg(slot->sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                slot->stats.stalls++;
+                return true;
+            }
+            Metrics::add(Metrics::SEND_ERRORS);
+            ESP_LOGW(TAG, "[sock=%d]: sendmsg() failed errno %d", slot->sock, errno);
+            return false;
+        }
+
+        entry->sent += len;
+        slot->stats.bytes += len;
+        ConnStats::addTx(slot - _slots, len);
+        if (entry->sent < total) return true;
+
+        if (entry->frame->stamp != 0) {
+            ConnStats::addLatency(slot - _slots, ConnStats::now() - entry->frame->stamp);
+        }
+        ConnStats::addTxFrame(slot - _slots);
+        entry_release(entry);
+        slot->busy = false;
+        slot->stats.frames++;
+        slot->stats.depth = slot_depth(slot);
+    }
+}
+
+static bool slot_pending(TxSlot* slot) {
+    return slot->busy || uxQueueMessagesWaiting(slot->queue) > 0;
+}
+
+static void tcp_sender_task(void *pvParameters) {
+    while (1) {
+        fd_set write_set;
+        FD_ZERO(&write_set);
+        int max_fd = -1;
+
+        xSemaphoreTake(_slots_lock, portMAX_DELAY);
+        for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+            TxSlot* slot = &_slots[i];
+            if (slot->sock < 0 || !slot_pending(slot)) continue;
+            FD_SET(slot->sock, &write_set);
+            if (slot->sock > max_fd) {
+                max_fd = slot->sock;
+            }
+        }
+        xSemaphoreGive(_slots_lock);
+
+        if (max_fd < 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // 有连接阻塞时定时醒来, 以便处理其它连接的新帧
+        struct timeval timeout = {0, SELECT_TIMEOUT_MS * 1000};
+        int ready = select(max_fd + 1, NULL, &write_set, NULL, &timeout);
+        if (ready == 0) {
+            continue;
+        }
+        if (ready < 0) {
+            /**
+             * 某个套接字已关闭(EBADF)时select()整体失败, 不处理会空转并拖住其它连接:
+             * 逐个尝试发送, 失败的连接丢弃积压, 不再参与select()
+            */
+            ESP_LOGW(TAG, "select() failed errno %d", errno);
+            xSemaphoreTake(_slots_lock, portMAX_DELAY);
+            for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+                TxSlot* slot = &_slots[i];
+                if (slot->sock < 0 || !slot_pending(slot)) continue;
+                if (!slot_flush(slot)) {
+                    slot_drop(slot);
+                }
+            }
+            xSemaphoreGive(_slots_lock);
+            continue;
+        }
+
+        xSemaphoreTake(_slots_lock, portMAX_DELAY);
+        for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+            TxSlot* slot = &_slots[i];
+            if (slot->sock < 0 || !FD_ISSET(slot->sock, &write_set)) continue;
+            // 连接异常时丢弃积压, 由接收端关闭连接
+            if (!slot_flush(slot)) {
+                slot_drop(slot);
+            }
+        }
+        xSemaphoreGive(_slots_lock);
+    }
+}
+
+static int post_entry(int sock, TxEntry& entry, int owner = -1) {
+    int res = -1;
+    bool pending = false;
+    uint32_t len = entry.header_len + entry_payload(&entry).size();
+
+    xSemaphoreTake(_slots_lock, portMAX_DELAY);
+    TxSlot* slot = slot_get(sock);
+    if (slot != nullptr) {
+        if (slot->stream_owner >= 0 && slot->stream_owner != owner) {
+            /* 目标正在接收直通流, 暂存以免插入流中间 */
+            if (xQueueSend(slot->deferred, &entry, 0) == pdTRUE) {
+                res = len;
+            } else {
+                count_drop(slot);
+                res = -2;
+            }
+        } else if (!slot->busy && uxQueueMessagesWaiting(slot->queue) == 0) {
+            /* 连接空闲, 直接在当前上下文发送 */
+            slot->entry = entry;
+            slot->busy = true;
+            res = len;
+            if (!slot_flush(slot)) {
+                // 帧已随积压一起释放, 返回连接异常
+                slot_drop(slot);
+                res = -1;
+                entry.frame = nullptr;
+            }
+        } else if (xQueueSend(slot->queue, &entry, 0) == pdTRUE) {
+            res = len;
+        } else {
+            // 直通流的数据段由调用方重试, 不计入丢弃
+            if (owner < 0) {
+                count_drop(slot);
+            }
+            res = -2;
+        }
+        uint16_t depth = slot_depth(slot);
+        slot->stats.depth = depth;
+        if (depth > slot->stats.high_water) {
+            slot->stats.high_water = depth;
+            Metrics::peak(Metrics::TX_HIGH_WATER, depth);
+        }
+        pending = slot_pending(slot);
+    }
+    xSemaphoreGive(_slots_lock);
+
+    if (res < 0) {
+        entry_release(&entry);
+        return res;
+    }
+    if (pending) {
+        xTaskNotifyGive(_sender_task);
+    }
+    return res;
+}
+
+int post(int sock, FramePool::Frame* frame) {
+    TxEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.frame = frame;
+    return post_entry(sock, entry);
+}
+
+int post(int sock, const TcpDataHandle::FrameHeader& header, FramePool::Frame* payload) {
+    TxEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.header, &header, sizeof(header));
+    entry.header_len = sizeof(header);
+    entry.frame = payload;
+    return post_entry(sock, entry);
+}
+
+int streamBegin(int sock, int owner) {
+    int res = -1;
+    xSemaphoreTake(_slots_lock, portMAX_DELAY);
+    TxSlot* slot = slot_get(sock);
+    if (slot != nullptr) {
+        if (slot->stream_owner < 0 || slot->stream_owner == owner) {
+            slot->stream_owner = owner;
+            res = 0;
+        } else {
+            res = -2;
+        }
+    }
+    xSemaphoreGive(_slots_lock);
+    return res;
+}
+
+int streamPost(int sock, int owner, FramePool::Frame* chunk) {
+    TxEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.frame = chunk;
+    return post_entry(sock, entry, owner);
+}
+
+void streamEnd(int sock, int owner) {
+    TxEntry entry;
+    int index = TcpServer::findSlotBySocket(sock);
+    if (index < 0) return;
+    xSemaphoreTake(_slots_lock, portMAX_DELAY);
+    TxSlot* slot = &_slots[index];
+    if (slot->sock == sock && slot->stream_owner == owner) {
+        slot->stream_owner = -1;
+        while (xQueueReceive(slot->deferred, &entry, 0) == pdTRUE) {
+            if (xQueueSend(slot->queue, &entry, 0) != pdTRUE) {
+                entry_release(&entry);
+                count_drop(slot);
+            }
+        }
+    }
+    xSemaphoreGive(_slots_lock);
+    xTaskNotifyGive(_sender_task);
+}
+
+void streamAbort(int sock, int owner) {
+    int index = TcpServer::findSlotBySocket(sock);
+    if (index < 0) return;
+    xSemaphoreTake(_slots_lock, portMAX_DELAY);
+    TxSlot* slot = &_slots[index];
+    if (slot->sock == sock && slot->stream_owner == owner) {
+        ESP_LOGW(TAG, "[sock=%d]: stream source %d lost, close", sock, owner);
+        slot_drop(slot);
+        // 由接收端读到EOF后按正常流程关闭
+        shutdown(sock, SHUT_RDWR);
+    }
+    xSemaphoreGive(_slots_lock);
+}
+
+bool getStats(int slot, Stats& out) {
+    if (slot < 0 || slot >= AppCfg::TCP_MAX_CLIENTS) return false;
+    xSemaphoreTake(_slots_lock, portMAX_DELAY);
+    bool active = _slots[slot].sock >= 0;
+    out = _slots[slot].stats;
+    xSemaphoreGive(_slots_lock);
+    return active;
+}
+
+void disconnect(int sock, int index) {
+    if (index < 0 || index >= AppCfg::TCP_MAX_CLIENTS) return;
+    xSemaphoreTake(_slots_lock, portMAX_DELAY);
+    if (_slots[index].sock == sock) {
+        slot_drop(&_slots[index]);
+        _slots[index].sock = -1;
+    }
+    xSemaphoreGive(_slots_lock);
+}
+
+int init() {
+    _slots_lock = xSemaphoreCreateMutex();
+    if (_slots_lock == NULL) {
+        ESP_LOGE(TAG, "mutex create failed");
+        return -1;
+    }
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        memset(&_slots[i], 0, sizeof(TxSlot));
+        _slots[i].sock = -1;
+        _slots[i].stream_owner = -1;
+        _slots[i].queue = xQueueCreate(AppCfg::TX_QUEUE_DEPTH, sizeof(TxEntry));
+        _slots[i].deferred = xQueueCreate(AppCfg::TX_QUEUE_DEPTH, sizeof(TxEntry));
+        if (_slots[i].queue == NULL || _slots[i].deferred == NULL) {
+            ESP_LOGE(TAG, "tx queue create failed");
+            return -1;
+        }
+    }
+
+    if (xTaskCreate(tcp_sender_task, "tcp_sender_task", 4 * 1024, nullptr, 11, &_sender_task) != pdPASS) {
+        ESP_LOGE(TAG, "tcp_sender_task create failed");
+        return -1;
+    }
+    return 0;
+}
+
+}
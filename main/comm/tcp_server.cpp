@@ -1,152 +1,540 @@
 #include "tcp_server.h"
 #include "socket_wrapper.h"
-#include "wifi_wrapper.h"
+#include "utility_wrapper.h"
+#include "app_config.h"
+#include "conn_stats.h"
+#include "conn_pool.h"
+#include "metrics.h"
+#include "timer_wheel.h"
+#include "power.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#else
 #include <lwip/sockets.h>
+#endif
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <cstring>
+#include <cerrno>
 #include <atomic>
 
 
 namespace TcpServer {
 
 constexpr static const char TAG[] = "tcp_server";
-static Wrapper::Socket::Server* _tcp_server = nullptr;
+static int _listen_sock = -1;
 static RecvCallback _recv_cb = nullptr;
-/* 受连接的TCP客户端信息链表头 */
-static ClientInfo* _client_info_head = nullptr;
+static CloseCallback _close_cb = nullptr;
+constexpr int EVENT_CALLBACK_MAX = 4;
+static EventCallback _event_cbs[EVENT_CALLBACK_MAX] = {};
+static RejectCallback _reject_cb = nullptr;
+/* 客户端已满时暂存的已accept套接字, 按值传递 */
+static QueueHandle_t _accept_queue = nullptr;
 static std::atomic_int	_source_sock = -1;
 
-static void add_tcp_client_list_node(int socket) 
-{  
-    ClientInfo *new_client = (ClientInfo *)malloc(sizeof(ClientInfo));  
-    if (new_client == NULL) return;
-    if (_client_info_head == NULL) {
-        _client_info_head = new_client;
-    } else {
-        ClientInfo *current;
-        current = _client_info_head;
-        while (current->next != NULL) {
-            current = current->next;
+/**
+ * 客户端注册表: 固定容量的平坦数组, 另建 id / socket / 名称 到槽位的索引.
+ * 写操作在临界区内串行执行, 读操作无锁: 索引为原子量,
+ * 槽内数据由序列锁保护, 读者拷贝后校验序号, 期间被改写则重读.
+*/
+struct ClientSlot {
+    std::atomic<uint32_t> seq;              // 序列锁, 奇数表示正在写入
+    std::atomic<int> sock;                  // -1表示空闲
+    std::atomic<uint32_t> name_hash;
+    std::atomic<int16_t> name_next;         // 同一名称哈希桶中的下一个槽位
+    std::atomic<bool> recv_paused;
+    ClientInfo info;
+};
+
+constexpr int NAME_BUCKETS = 32;
+constexpr int RECV_RETRY_MS = 10;
+constexpr int ACCEPT_RETRY_MS = 100;
+static_assert((NAME_BUCKETS & (NAME_BUCKETS - 1)) == 0, "NAME_BUCKETS must be a power of 2");
+
+static ClientSlot _clients[AppCfg::TCP_MAX_CLIENTS];
+static std::atomic<int16_t> _id_index[256];
+static std::atomic<int16_t> _sock_index[FD_SETSIZE];
+static std::atomic<int16_t> _name_index[NAME_BUCKETS];
+static std::atomic_int _client_count = 0;
+static portMUX_TYPE _registry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* 单任务事件循环模式的空闲计时, 单位秒, 只在事件循环任务中访问 */
+static TimerWheel _idle_wheel;
+static uint32_t _last_rx[AppCfg::TCP_MAX_CLIENTS];
+
+static void slot_write_begin(ClientSlot* slot)
+{
+    slot->seq.store(slot->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+static void slot_write_end(ClientSlot* slot)
+{
+    slot->seq.store(slot->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/* 以下函数须在 _registry_lock 内调用 */
+static void name_unlink(int16_t index)
+{
+    ClientSlot* slot = &_clients[index];
+    if (slot->info.name[0] == '\0') return;
+    std::atomic<int16_t>* link = &_name_index[slot->name_hash.load(std::memory_order_relaxed) & (NAME_BUCKETS - 1)];
+    for (int16_t cur = link->load(std::memory_order_relaxed); cur >= 0; cur = link->load(std::memory_order_relaxed)) {
+        if (cur == index) {
+            // 保留本槽的name_next, 正在遍历的读者仍能走完链表
+            link->store(slot->name_next.load(std::memory_order_relaxed), std::memory_order_release);
+            break;
         }
-        current->next = new_client;
+        link = &_clients[cur].name_next;
     }
+}
 
-    // 设置节点信息
-    memset(new_client, 0, sizeof(ClientInfo));
-    new_client->socket = socket;
-    new_client->next = NULL;
+static void name_link(int16_t index)
+{
+    ClientSlot* slot = &_clients[index];
+    if (slot->info.name[0] == '\0') return;
+    std::atomic<int16_t>* head = &_name_index[slot->name_hash.load(std::memory_order_relaxed) & (NAME_BUCKETS - 1)];
+    slot->name_next.store(head->load(std::memory_order_relaxed), std::memory_order_relaxed);
+    head->store(index, std::memory_order_release);
 }
 
-static void delete_tcp_client_list_node(int socket)
+static int registry_add(int socket)
 {
-    if (_client_info_head == NULL) return;
-    ClientInfo *current, *prev;
-    current = _client_info_head;
-    // 判断是否为第一个节点
-    if (current != NULL && current->socket == socket) {
-        _client_info_head = current->next;
-        free(current);
-        return;
-    }
-    while (current->next != NULL) {
-        prev = current;
-        current = current->next;
-        if (current != NULL && current->socket == socket) {
-            prev->next = current->next;
-            free(current);
+    int16_t index = -1;
+    if (socket < 0 || socket >= FD_SETSIZE) return -1;
+
+    portENTER_CRITICAL(&_registry_lock);
+    for (int16_t i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        if (_clients[i].sock.load(std::memory_order_relaxed) < 0) {
+            index = i;
             break;
         }
     }
+    if (index >= 0) {
+        ClientSlot* slot = &_clients[index];
+        slot_write_begin(slot);
+        memset(&slot->info, 0, sizeof(ClientInfo));
+        slot->info.socket = socket;
+        slot_write_end(slot);
+        slot->recv_paused.store(false, std::memory_order_relaxed);
+        slot->sock.store(socket, std::memory_order_release);
+        _sock_index[socket].store(index, std::memory_order_release);
+        _client_count++;
+    }
+    portEXIT_CRITICAL(&_registry_lock);
+    if (index >= 0) {
+        ConnStats::reset(index);
+        Metrics::add(Metrics::CONNECTS);
+    }
+    return index;
+}
+
+static void registry_remove(int socket)
+{
+    if (socket < 0 || socket >= FD_SETSIZE) return;
+
+    portENTER_CRITICAL(&_registry_lock);
+    int16_t index = _sock_index[socket].load(std::memory_order_relaxed);
+    if (index >= 0) {
+        ClientSlot* slot = &_clients[index];
+        if (_id_index[slot->info.id].load(std::memory_order_relaxed) == index) {
+            _id_index[slot->info.id].store(-1, std::memory_order_release);
+        }
+        name_unlink(index);
+        _sock_index[socket].store(-1, std::memory_order_release);
+        slot->sock.store(-1, std::memory_order_release);
+        slot_write_begin(slot);
+        memset(&slot->info, 0, sizeof(ClientInfo));
+        slot->info.socket = -1;
+        slot_write_end(slot);
+        _client_count--;
+    }
+    portEXIT_CRITICAL(&_registry_lock);
+}
+
+/**
+ * 获取客户端IP地址,端口号并以ip地址的机器码作id
+*/
+static void record_client_address(int fd)
+{
+    struct sockaddr client_addr;
+    socklen_t client_addr_len = sizeof(struct sockaddr);
+    int ret = getpeername(fd, &client_addr, &client_addr_len);
+    if (ret != 0) return;
+
+    struct sockaddr_in *client_addr_in = (struct sockaddr_in *)&client_addr;
+    char *client_ip = inet_ntoa(client_addr_in->sin_addr);
+    int client_port = ntohs(client_addr_in->sin_port);
+    uint8_t client_id = (uint8_t ) (client_addr_in->sin_addr.s_addr >> 24);
+    ESP_LOGI(TAG, "Client IP:%s,Port:%d", client_ip, client_port);
+
+    int16_t index = findSlotBySocket(fd);
+    if (index < 0) return;
+    portENTER_CRITICAL(&_registry_lock);
+    ClientSlot* slot = &_clients[index];
+    slot_write_begin(slot);
+    strncpy(slot->info.ip, client_ip, sizeof(slot->info.ip) - 1);
+    slot->info.port = client_port;
+    slot->info.id = client_id;
+    slot_write_end(slot);
+    _id_index[client_id].store(index, std::memory_order_release);
+    portEXIT_CRITICAL(&_registry_lock);
+}
+
+static void notify_event(ClientEvent event, int slot)
+{
+    if (slot < 0) return;
+    for (EventCallback cb : _event_cbs) {
+        if (cb != NULL) cb(event, slot);
+    }
+}
+
+static uint32_t now_seconds()
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+/**
+ * 开启TCP keepalive检测不告而别的对端, 关闭Nagle;
+ * 每客户端任务模式下以接收超时实现空闲断开, 事件循环模式由时间轮计时
+*/
+static void configure_client_socket(int sock)
+{
+    if (AppCfg::TCP_KEEPALIVE_IDLE_S > 0) {
+        int opt = 1;
+        setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt));
+        opt = AppCfg::TCP_KEEPALIVE_IDLE_S;
+        setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &opt, sizeof(opt));
+        opt = AppCfg::TCP_KEEPALIVE_INTERVAL_S;
+        setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &opt, sizeof(opt));
+        opt = AppCfg::TCP_KEEPALIVE_COUNT;
+        setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &opt, sizeof(opt));
+    }
+    // 关闭Nagle: 转发的帧到达即发, 否则多帧在途时要等对端的延迟ACK
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    if (!AppCfg::TCP_REACTOR_MODE && AppCfg::TCP_IDLE_TIMEOUT_S > 0) {
+        struct timeval timeout = {(time_t)AppCfg::TCP_IDLE_TIMEOUT_S, 0};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+}
+
+static void close_client(int fd)
+{
+    int slot = findSlotBySocket(fd);
+    _idle_wheel.cancel(slot);
+    // 先移出注册表, 其它任务之后的post()不会再找到并重新启用该连接的发送队列
+    registry_remove(fd);
+    if (_close_cb != NULL) {
+        _close_cb(fd, slot);
+    }
+    notify_event(ClientEvent::DISCONNECT, slot);
+    shutdown(fd, 0);
+    close(fd);
 }
 
+static int create_listen_socket(uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
+        close(sock);
+        return -1;
+    }
+
+    if (listen(sock, AppCfg::TCP_LISTEN_BACKLOG) != 0) {
+        ESP_LOGE(TAG, "Error occurred during listen: errno %d", errno);
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/**
+ * 每客户端接收任务, 栈与接收缓冲来自连接资源池中本连接的槽位
+*/
 static void tcp_recv_task(void *pvParameters) {
-    int *pragma = (int *)pvParameters;
-    int fd = *pragma;
+    int fd = (int)(intptr_t)pvParameters;
+    int slot = findSlotBySocket(fd);
     Wrapper::Socket::Socket socket(fd);
     ESP_LOGI(TAG, "client_sock = %d", fd);
-    {   // 获取客户端IP地址(作用域限定)
-        struct sockaddr client_addr;
-        socklen_t client_addr_len = sizeof(struct sockaddr);
-        int ret = getpeername(fd, &client_addr, &client_addr_len);
-        if (ret == 0) {
-            struct sockaddr_in *client_addr_in = (struct sockaddr_in *)&client_addr;
-            char *client_ip = inet_ntoa(client_addr_in->sin_addr);
-            char client_port = ntohs(client_addr_in->sin_port);
-            uint8_t client_id = (uint8_t ) (client_addr_in->sin_addr.s_addr >> 24);
-            ESP_LOGI(TAG, "Client IP:%s,Port:%d", client_ip, client_port);
-            // 保存客户端IP地址,端口号
-            for (ClientInfo *list = _client_info_head; list; list = list->next) {
-                if (list->socket == fd) {
-                    strcpy(list->ip, client_ip);
-                    list->port = client_port;
-                    // ip地址的机器码作id
-                    list->id = client_id;
-                    break;
-                }
-            }
-        }
-    }
+    record_client_address(fd);
+    notify_event(ClientEvent::CONNECT, slot);
 
-    /* allocation sock date buffer */
-    uint8_t* rx_buf = (uint8_t *)malloc(SOCK_BUF_SIZE + 8);
+    uint8_t* rx_buf = ConnPool::rxBuffer(slot);
     if (rx_buf == NULL) {
-        ESP_LOGE(TAG, "sock buffer malloc failed");
+        ESP_LOGE(TAG, "no connection buffer for slot %d", slot);
         goto over;
     }
 
     while(1) {
-        int recv_len = socket.recv(rx_buf, SOCK_BUF_SIZE + 8);
-        if (recv_len < 0) {
+        if (_clients[slot].recv_paused.load(std::memory_order_relaxed)) {
+            // 背压: 暂停读取, 定时回调让上层重试
+            vTaskDelay(pdMS_TO_TICKS(RECV_RETRY_MS));
+            if (_recv_cb != NULL) {
+                _source_sock = fd;
+                _recv_cb(fd, IBuf());
+            }
+            continue;
+        }
+        int recv_len = socket.recv(rx_buf, SOCK_RECV_SIZE);
+        if (recv_len <= 0) {
+            // 0: 对端关闭(FIN), 继续recv()只会立即返回0
+            if (recv_len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // 接收超时即空闲超时
+                Metrics::add(Metrics::IDLE_REAPED);
+            }
             // Error occurred within this client's socket -> close and mark invalid
             ESP_LOGW(TAG, "[sock=%d]: recv() returned %d -> closing the socket", fd, recv_len);
             goto over;
         } else {
+            bool wake = Power::activity();
+            ConnStats::addRx(slot, recv_len);
             if (_recv_cb != NULL) {
                 _source_sock = fd;
                 _recv_cb(fd, {rx_buf, (uint32_t )recv_len});          // 回调函数
             }
+            if (wake) Power::firstFrameDone();
         }
 
     }
 
 over:
     /* colse... */
-    delete_tcp_client_list_node(fd);
-    vTaskDelete(NULL);
+    registry_remove(fd);
+    if (_close_cb != NULL) {
+        _close_cb(fd, slot);
+    }
+    notify_event(ClientEvent::DISCONNECT, slot);
+    shutdown(fd, 0);
+    close(fd);
+    ConnPool::exit(slot);
+}
+
+/**
+ * 拒绝连接: 回复原因帧后关闭, 刚accept的套接字发送缓冲为空, 不阻塞
+*/
+static void reject_client(int sock, const char* reason)
+{
+    uint8_t frame[64];
+    uint32_t len = _reject_cb != NULL ? _reject_cb(reason, frame, sizeof(frame)) : 0;
+    if (len > 0) {
+        send(sock, frame, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+    Metrics::add(Metrics::REJECTS);
+    ESP_LOGW(TAG, "[sock=%d]: connection rejected, %s", sock, reason);
+    close(sock);
+}
+
+/**
+ * 注册新连接并开始接收, 没有空闲槽位或接收任务创建失败时返回false
+*/
+static bool admit(int sock)
+{
+    int slot = registry_add(sock);
+    if (slot < 0) return false;
+    configure_client_socket(sock);
+    if (AppCfg::TCP_REACTOR_MODE) {
+        ESP_LOGI(TAG, "client_sock = %d", sock);
+        _last_rx[slot] = now_seconds();
+        if (AppCfg::TCP_IDLE_TIMEOUT_S > 0) {
+            _idle_wheel.schedule(slot, _last_rx[slot] + AppCfg::TCP_IDLE_TIMEOUT_S);
+        }
+        record_client_address(sock);
+        notify_event(ClientEvent::CONNECT, slot);
+        return true;
+    }
+    // 套接字按值传给接收任务
+    if (!ConnPool::spawn(slot, tcp_recv_task, "tcp_recv_task", sock)) {
+        ESP_LOGE(TAG, "tcp_recv_task create failed");
+        registry_remove(sock);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * 新连接: 有空闲槽位且无人排队时直接接入, 否则进入等待队列, 队列也满时回复原因后关闭
+*/
+static void on_accept(int sock)
+{
+    if (uxQueueMessagesWaiting(_accept_queue) == 0 && admit(sock)) return;
+    if (AppCfg::TCP_ACCEPT_QUEUE > 0 && xQueueSend(_accept_queue, &sock, 0) == pdTRUE) {
+        ESP_LOGW(TAG, "[sock=%d]: server full, connection queued", sock);
+        return;
+    }
+    reject_client(sock, "server full");
+}
+
+/* 按到达顺序接入等待中的连接 */
+static void admit_pending()
+{
+    int sock;
+    while (clientCount() < AppCfg::TCP_MAX_CLIENTS && xQueueReceive(_accept_queue, &sock, 0) == pdTRUE) {
+        if (!admit(sock)) {
+            reject_client(sock, "server busy");
+        }
+    }
+}
+
+/**
+ * 时间轮到期: 收发活跃(含被暂停读取的连接)则按最后接收时刻重新计时, 否则关闭
+*/
+static void reap_idle(int16_t slot, uint32_t now)
+{
+    int fd = getSocket(slot);
+    if (fd < 0) return;
+    uint32_t idle = now - _last_rx[slot];
+    if (_clients[slot].recv_paused.load(std::memory_order_relaxed)) {
+        _last_rx[slot] = now;
+        idle = 0;
+    }
+    if (idle < AppCfg::TCP_IDLE_TIMEOUT_S) {
+        _idle_wheel.schedule(slot, _last_rx[slot] + AppCfg::TCP_IDLE_TIMEOUT_S);
+        return;
+    }
+    ESP_LOGW(TAG, "[sock=%d]: idle for %us -> closing the socket", fd, (unsigned)idle);
+    Metrics::add(Metrics::IDLE_REAPED);
+    close_client(fd);
 }
 
 static void tcp_listen_task(void *pvParameters) {
-    // Main loop for accepting new connections and serving all connected clients
     while (1) {
-        // Find a free socket
-        uint8_t client_count = 0;
-        for (ClientInfo *list = _client_info_head; list; list = list->next) {
-            client_count++;
+        admit_pending();
+
+        // 有连接等待空闲槽位时定时醒来, 槽位在接收任务退出时释放
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET(_listen_sock, &read_set);
+        struct timeval timeout = {0, ACCEPT_RETRY_MS * 1000};
+        bool waiting = uxQueueMessagesWaiting(_accept_queue) > 0;
+        if (select(_listen_sock + 1, &read_set, NULL, NULL, waiting ? &timeout : NULL) <= 0) {
+            continue;
         }
 
-        // We accept a new connection only if we have a free socket
-        if (client_count < 6) {
-            // Try to accept a new connections
-            int sock = _tcp_server->accept();
+        int sock = accept(_listen_sock, NULL, NULL);
+        if (sock < 0) {
+            ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(ACCEPT_RETRY_MS));
+            continue;
+        }
+        on_accept(sock);
+    }
+}
+
+/**
+ * 单任务事件循环: select()同时监听服务器套接字与全部客户端套接字,
+ * 所有连接共用一个接收缓冲区, 内存占用不随连接数增长.
+ * 客户端只在本任务中注册与注销, 断开后在下一轮接入等待中的连接.
+*/
+static void tcp_reactor_task(void *pvParameters) {
+    static uint8_t rx_buf[SOCK_RECV_SIZE];
+    TickType_t accept_resume = xTaskGetTickCount();
+
+    while (1) {
+        admit_pending();
+
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        int max_fd = -1;
+        bool paused = false;
+        // accept()失败后监听套接字持续可读, 暂停一段时间避免空转
+        bool accept_paused = (int32_t)(xTaskGetTickCount() - accept_resume) < 0;
+        if (!accept_paused) {
+            FD_SET(_listen_sock, &read_set);
+            max_fd = _listen_sock;
+        }
+        for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+            int fd = _clients[i].sock.load(std::memory_order_relaxed);
+            if (fd < 0) continue;
+            if (_clients[i].recv_paused.load(std::memory_order_relaxed)) {
+                paused = true;
+                continue;
+            }
+            FD_SET(fd, &read_set);
+            if (fd > max_fd) {
+                max_fd = fd;
+            }
+        }
+
+        // 有连接被暂停读取或accept暂停时定时醒来重试, 有空闲计时时每秒推进时间轮
+        struct timeval timeout = {0, RECV_RETRY_MS * 1000};
+        bool retry = paused || accept_paused;
+        if (!retry) {
+            timeout = {1, 0};
+        }
+        bool timed = retry || !_idle_wheel.empty();
+        int ready = select(max_fd + 1, &read_set, NULL, NULL, timed ? &timeout : NULL);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            ESP_LOGE(TAG, "select() failed: errno %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        uint32_t now = now_seconds();
+
+        if (FD_ISSET(_listen_sock, &read_set)) {
+            int sock = accept(_listen_sock, NULL, NULL);
             if (sock < 0) {
-                ESP_LOGE(TAG, "Unable to accept connection.");
-                break;
+                ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+                accept_resume = xTaskGetTickCount() + pdMS_TO_TICKS(ACCEPT_RETRY_MS);
             } else {
-                // add client infor list node
-                add_tcp_client_list_node(sock);
+                on_accept(sock);
+            }
+        }
 
-                if (xTaskCreate(tcp_recv_task, "tcp_recv_task", 5 * 1024, (void *)&sock, 10, NULL) != pdPASS) {
-                    ESP_LOGE(TAG, "tcp_recv_task create failed");
+        for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+            int fd = _clients[i].sock.load(std::memory_order_relaxed);
+            if (fd < 0) continue;
+            if (_clients[i].recv_paused.load(std::memory_order_relaxed)) {
+                if (_recv_cb != NULL) {
+                    _source_sock = fd;
+                    _recv_cb(fd, IBuf());
                 }
-            
+                continue;
             }
-        } else {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            ESP_LOGW(TAG, "too many TCP connect");
+            if (!FD_ISSET(fd, &read_set)) continue;
+
+            int recv_len = recv(fd, rx_buf, SOCK_RECV_SIZE, 0);
+            if (recv_len <= 0) {
+                ESP_LOGW(TAG, "[sock=%d]: recv() returned %d -> closing the socket", fd, recv_len);
+                close_client(fd);
+                continue;
+            }
+            _last_rx[i] = now;
+            bool wake = Power::activity();
+            ConnStats::addRx(i, recv_len);
+            if (_recv_cb != NULL) {
+                _source_sock = fd;
+                _recv_cb(fd, {rx_buf, (uint32_t )recv_len});          // 回调函数
+            }
+            if (wake) Power::firstFrameDone();
         }
+
+        _idle_wheel.advance(now, [now](int16_t slot) { reap_idle(slot, now); });
     }
 }
 
@@ -155,8 +543,102 @@ void registerRecvCallback(RecvCallback cb) {
     _recv_cb = cb;
 }
 
-ClientInfo* getClientsInfo() {
-    return _client_info_head;
+void registerCloseCallback(CloseCallback cb) {
+    _close_cb = cb;
+}
+
+void registerEventCallback(EventCallback cb) {
+    for (EventCallback& slot : _event_cbs) {
+        if (slot == NULL) {
+            slot = cb;
+            return;
+        }
+    }
+    ESP_LOGE(TAG, "too many event callbacks");
+}
+
+void registerRejectCallback(RejectCallback cb) {
+    _reject_cb = cb;
+}
+
+void pauseRecv(int sock, bool pause) {
+    int slot = findSlotBySocket(sock);
+    if (slot < 0) return;
+    _clients[slot].recv_paused.store(pause, std::memory_order_relaxed);
+}
+
+int clientCount() {
+    return _client_count.load(std::memory_order_relaxed);
+}
+
+bool getClient(int slot, ClientInfo& out) {
+    if (slot < 0 || slot >= AppCfg::TCP_MAX_CLIENTS) return false;
+    ClientSlot* client = &_clients[slot];
+    uint32_t seq;
+    do {
+        seq = client->seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+        memcpy(&out, &client->info, sizeof(ClientInfo));
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != client->seq.load(std::memory_order_relaxed));
+    return out.socket >= 0;
+}
+
+int findSlotById(uint8_t id) {
+    int16_t index = _id_index[id].load(std::memory_order_acquire);
+    if (index < 0) return -1;
+    ClientInfo info;
+    if (!getClient(index, info) || info.id != id) return -1;
+    return index;
+}
+
+int findSlotBySocket(int sock) {
+    if (sock < 0 || sock >= FD_SETSIZE) return -1;
+    return _sock_index[sock].load(std::memory_order_acquire);
+}
+
+int findSlotByName(const char* name) {
+    uint32_t hash = Wrapper::Utility::BKDR_hash(name);
+    int16_t index = _name_index[hash & (NAME_BUCKETS - 1)].load(std::memory_order_acquire);
+    // 链长不超过容量, 限制步数防止并发改链时绕圈
+    for (int n = 0; index >= 0 && n < AppCfg::TCP_MAX_CLIENTS; n++) {
+        ClientInfo info;
+        if (_clients[index].name_hash.load(std::memory_order_relaxed) == hash
+            && getClient(index, info) && strcmp(info.name, name) == 0) {
+            return index;
+        }
+        index = _clients[index].name_next.load(std::memory_order_acquire);
+    }
+    return -1;
+}
+
+int findSocketById(uint8_t id) {
+    int index = findSlotById(id);
+    if (index < 0) return -1;
+    return _clients[index].sock.load(std::memory_order_acquire);
+}
+
+int getSocket(int slot) {
+    if (slot < 0 || slot >= AppCfg::TCP_MAX_CLIENTS) return -1;
+    return _clients[slot].sock.load(std::memory_order_acquire);
+}
+
+bool setClientName(int sock, const char* name) {
+    int16_t index = findSlotBySocket(sock);
+    if (index < 0) return false;
+
+    portENTER_CRITICAL(&_registry_lock);
+    ClientSlot* slot = &_clients[index];
+    name_unlink(index);
+    slot_write_begin(slot);
+    strncpy(slot->info.name, name, sizeof(slot->info.name) - 1);
+    slot->info.name[sizeof(slot->info.name) - 1] = '\0';
+    slot_write_end(slot);
+    slot->name_hash.store(Wrapper::Utility::BKDR_hash(slot->info.name), std::memory_order_relaxed);
+    name_link(index);
+    portEXIT_CRITICAL(&_registry_lock);
+    notify_event(ClientEvent::LOGIN, index);
+    return true;
 }
 
 int getSourceSock() {
@@ -164,22 +646,35 @@ int getSourceSock() {
 }
 
 int init(uint16_t port) {
-    int res;
-    _tcp_server = new Wrapper::Socket::Server(Wrapper::Socket::Protocol::TCP);
-    if (_tcp_server == nullptr) {
-        ESP_LOGE(TAG, "socket error.");
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        _clients[i].sock = -1;
+        _clients[i].info.socket = -1;
+        _clients[i].name_next = -1;
+    }
+    for (auto& index : _id_index) index = -1;
+    for (auto& index : _sock_index) index = -1;
+    for (auto& index : _name_index) index = -1;
+
+    // 等待队列深度为0时也创建一项, 不使用
+    _accept_queue = xQueueCreate(AppCfg::TCP_ACCEPT_QUEUE > 0 ? AppCfg::TCP_ACCEPT_QUEUE : 1, sizeof(int));
+    if (_accept_queue == NULL || ConnPool::init() < 0) {
+        ESP_LOGE(TAG, "init failed.");
         return -1;
     }
 
-    res = _tcp_server->init(port);
-    if (res < 0) {
+    _listen_sock = create_listen_socket(port);
+    if (_listen_sock < 0) {
         ESP_LOGE(TAG, "init failed.");
-        return res;
+        return -1;
     }
 
-    xTaskCreate(tcp_listen_task, "tcp_listen_task", 6 * 1024, nullptr, 12, nullptr);
+    if (AppCfg::TCP_REACTOR_MODE) {
+        xTaskCreate(tcp_reactor_task, "tcp_reactor_task", 6 * 1024, nullptr, 12, nullptr);
+    } else {
+        xTaskCreate(tcp_listen_task, "tcp_listen_task", 6 * 1024, nullptr, 12, nullptr);
+    }
 
-    return res;
+    return 0;
 }
 
 
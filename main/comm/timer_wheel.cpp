@@ -0,0 +1,43 @@
+#include "timer_wheel.h"
+
+TimerWheel::TimerWheel() : _now(0), _count(0) {
+    for (auto& head : _heads) head = -1;
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        _next[i] = -1;
+        _prev[i] = -1;
+        _deadline[i] = 0;
+        _armed[i] = false;
+    }
+}
+
+void TimerWheel::link(int16_t id) {
+    int16_t& head = _heads[_deadline[id] & (SLOTS - 1)];
+    _prev[id] = -1;
+    _next[id] = head;
+    if (head >= 0) _prev[head] = id;
+    head = id;
+    _armed[id] = true;
+    _count++;
+}
+
+void TimerWheel::schedule(int16_t id, uint32_t deadline) {
+    if (id < 0 || id >= AppCfg::TCP_MAX_CLIENTS) return;
+    cancel(id);
+    // 已过期的时刻放到下一格, 保证下次推进时被检查
+    _deadline[id] = (int32_t)(deadline - _now) > 0 ? deadline : _now + 1;
+    link(id);
+}
+
+void TimerWheel::cancel(int16_t id) {
+    if (id < 0 || id >= AppCfg::TCP_MAX_CLIENTS || !_armed[id]) return;
+    if (_prev[id] >= 0) {
+        _next[_prev[id]] = _next[id];
+    } else {
+        _heads[_deadline[id] & (SLOTS - 1)] = _next[id];
+    }
+    if (_next[id] >= 0) _prev[_next[id]] = _prev[id];
+    _next[id] = -1;
+    _prev[id] = -1;
+    _armed[id] = false;
+    _count--;
+}
@@ -1,12 +1,84 @@
 #pragma once
 
+#include "sdkconfig.h"
+#include <stdint.h>
+
 namespace AppCfg {
 
 constexpr char SOFTAP_SSID[]    = "ESP-SOFTAP";
 constexpr char SOFTAP_PAWD[]    = "3325035137";
 
 constexpr uint16_t SERVER_PORT  = 8888;
-  
+
+/* -----------TCP服务器模型------------ */
+// true: 单任务select事件循环; false: 每个客户端一个接收任务
+constexpr bool TCP_REACTOR_MODE     = true;
+// listen()的backlog: 协议栈中已完成握手, 尚未accept的连接数
+constexpr int TCP_LISTEN_BACKLOG    = 4;
+// 客户端已满时暂存的已accept连接数, 有空闲槽位后按序接入; 0为直接拒绝
+constexpr int TCP_ACCEPT_QUEUE      = 2;
+// 监听套接字, 等待队列与一个回复拒绝原因的套接字之外, 其余lwIP套接字均可用于客户端
+constexpr int TCP_MAX_CLIENTS       = TCP_REACTOR_MODE ? CONFIG_LWIP_MAX_SOCKETS - 2 - TCP_ACCEPT_QUEUE : 6;
+// 每客户端接收任务模式下单个任务的栈大小(字节), 连同接收缓冲在启动时按TCP_MAX_CLIENTS一次申请
+constexpr uint32_t CLIENT_TASK_STACK = 5 * 1024;
+// 空闲断开: 超过该秒数未收到任何数据的连接被关闭, 0为不限; 客户端可定时发PING帧保活
+// 主机测试在编译选项中定义APP_TCP_IDLE_TIMEOUT_S缩短
+#ifndef APP_TCP_IDLE_TIMEOUT_S
+#define APP_TCP_IDLE_TIMEOUT_S 120
+#endif
+constexpr uint32_t TCP_IDLE_TIMEOUT_S   = APP_TCP_IDLE_TIMEOUT_S;
+// TCP keepalive: 空闲秒数, 探测间隔秒数, 探测次数; 空闲秒数为0时不开启
+constexpr int TCP_KEEPALIVE_IDLE_S      = 30;
+constexpr int TCP_KEEPALIVE_INTERVAL_S  = 5;
+constexpr int TCP_KEEPALIVE_COUNT       = 3;
+// 转发帧缓冲池槽数(每槽约2.5KB, 位于PSRAM)
+constexpr int FRAME_POOL_SIZE       = 32;
+// 命令应答负载上限: list/stats每个客户端一项(不超过160字节), 按TCP_MAX_CLIENTS留足
+constexpr uint32_t CMD_REPLY_MAX    = 512 + TCP_MAX_CLIENTS * 160;
+// 每个连接的发送队列深度
+constexpr int TX_QUEUE_DEPTH        = 8;
+// 流式直通转发的BINARY帧最大数据长度
+constexpr uint32_t STREAM_FRAME_MAX = 4 * 1024 * 1024;
+// 会阻塞的命令(如wifi)交给命令任务执行, 可排队的命令数; 排满时直接回复忙
+constexpr int CMD_TASK_QUEUE        = 4;
+// 转发热路径日志级别(同esp_log_level_t: 0关闭 1错误 2警告 3信息 4调试), 更详细的日志编译期去除
+constexpr int HOT_PATH_LOG_LEVEL    = 1;
+
+/* -----------离线信箱------------ */
+// 暂存发往离线设备的帧, 设备重新登录后按序投递
+constexpr bool MAILBOX_ENABLE       = true;
+// PSRAM中暂存的帧数(每帧约1KB), 占用超过3/4后把最早的帧转存到TF卡(仅扩展容量, 重启后清空)
+constexpr int MAILBOX_FRAMES        = 64;
+// 每个目标ID最多暂存的帧数(PSRAM与TF卡合计)
+constexpr uint32_t MAILBOX_PER_ID_MAX = 256;
+// 暂存帧的有效期
+constexpr uint32_t MAILBOX_TTL_S    = 600;
+
+/* -----------TF卡抓包------------ */
+// 把收到的帧(帧头, 接收时刻, 截断的负载)记录到TF卡, 供主机端解码与回放
+// 上电后即开始抓包; 否则由 record on 命令开启
+constexpr bool RECORDER_AUTOSTART   = false;
+// 每帧记录的最大负载字节数, 超出部分截断; 0为只记录帧头
+constexpr uint32_t RECORDER_SNAPLEN = 64;
+// 接收路径与写卡任务之间的环形缓冲记录数, 须为2的幂(位于PSRAM)
+constexpr uint32_t RECORDER_RING_SLOTS = 512;
+// 写卡任务的批量写入缓冲(字节), 攒满或每秒写一次
+constexpr uint32_t RECORDER_WRITE_BUF = 16 * 1024;
+// 单个抓包文件的大小上限, 超过后换新文件, 只保留最近RECORDER_FILES个
+constexpr uint32_t RECORDER_FILE_MAX = 4 * 1024 * 1024;
+constexpr uint32_t RECORDER_FILES    = 8;
+
+/* -----------电源管理------------ */
+// 动态调频范围(需CONFIG_PM_ENABLE)
+constexpr int PM_MAX_CPU_FREQ_MHZ   = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+constexpr int PM_MIN_CPU_FREQ_MHZ   = 80;
+// 空闲后第一段数据的处理耗时上限(us, 含升频), 超过时计数并告警
+constexpr uint32_t PM_FIRST_FRAME_MAX_US = 2000;
+// 最后一次收到数据后保持最高频率的时长
+constexpr int PM_BUSY_HOLD_MS       = 200;
+// 无按键操作超过该秒数后关闭屏幕与背光, 0为常亮
+constexpr int LCD_BLANK_TIMEOUT_S   = 60;
+
 /* -----------指令定义------------ */
 constexpr char JSON_KEY_STATUS[]    = "status";
 constexpr char JSON_KEY_MARK[]      = "mark";
@@ -34,5 +106,7 @@ constexpr int TF_PIN_MISO       = 8;
 constexpr int TF_PIN_MOSI       = 9;
 constexpr int TF_PIN_SCK        = 10;
 constexpr int TF_PIN_CS         = 11;
+constexpr int TF_SPI_HOST       = 2;            // SPI3_HOST, LCD占用SPI2
+constexpr char TF_MOUNT_POINT[] = "/sdcard";
 
 }
@@ -0,0 +1,181 @@
+#include "dashboard.h"
+#include "conn_stats.h"
+#include "tcp_server.h"
+#include "tcp_sender.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+
+namespace gui {
+namespace dashboard {
+
+constexpr int SPARK_POINTS = 30;            // 每条火花线的采样点数
+constexpr int SPARK_BAR = 4;                // 每个采样点的宽度(像素)
+constexpr int SPARK_HEIGHT = 11;
+constexpr int LEFT = 3;
+constexpr int TOP = 24;
+constexpr int LINE = 8;                     // 8x8字体行高
+
+enum Series : uint8_t {
+    SERIES_RX,                              // 接收字节/秒
+    SERIES_TX,                              // 发送字节/秒
+    SERIES_DEPTH,                           // 发送队列深度
+    SERIES_P99,                             // 转发延迟p99(us)
+    SERIES_COUNT,
+};
+
+static const uint16_t _colors[SERIES_COUNT] = {COLOR_GREEN, COLOR_CYAN, COLOR_YELLOW, COLOR_ORANGE};
+
+static int _slot = -1;
+static ConnStats::Snapshot _last;
+static uint32_t _last_time = 0;
+static uint32_t _history[SERIES_COUNT][SPARK_POINTS];
+static uint8_t _head = 0;                   // 下一个写入位置
+static uint8_t _filled = 0;
+
+static void draw_text(lcd_data_frame_t *image, int line, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+static void draw_text(lcd_data_frame_t *image, int line, const char *fmt, ...)
+{
+    // 补齐空格覆盖上一次的内容
+    char *text = (char *)image->data;
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(text, 16, fmt, args);
+    va_end(args);
+    if (len < 0) len = 0;
+    for (; len < 15; len++) text[len] = ' ';
+    text[15] = '\0';
+
+    image->type = LCD_STRING;
+    image->font = LCD_FONT_8X8;
+    image->color = COLOR_GREEN;
+    image->back_color = COLOR_BLACK;
+    image->x = LEFT;
+    image->y = TOP + line;
+    image->len = 15;
+    lcd_frame_display_data(image);
+}
+
+static void draw_rect(lcd_data_frame_t *image, int x, int y, int x_end, int y_end, uint16_t color)
+{
+    image->type = LCD_REC;
+    image->x = x;
+    image->y = y;
+    image->x_end = x_end;
+    image->y_end = y_end;
+    image->color = color;
+    lcd_frame_display_data(image);
+}
+
+static void draw_spark(lcd_data_frame_t *image, int line, Series series)
+{
+    uint32_t max = 1;
+    for (int i = 0; i < _filled; i++) {
+        if (_history[series][i] > max) max = _history[series][i];
+    }
+
+    int y = TOP + line;
+    draw_rect(image, LEFT, y, LEFT + SPARK_POINTS * SPARK_BAR - 1, y + SPARK_HEIGHT - 1, COLOR_BLACK);
+    // 最旧的点在左
+    for (int i = 0; i < _filled; i++) {
+        int index = (_head + SPARK_POINTS - _filled + i) % SPARK_POINTS;
+        uint32_t value = _history[series][index];
+        if (value == 0) continue;
+        int height = (uint64_t)value * SPARK_HEIGHT / max;
+        if (height < 1) height = 1;
+        int x = LEFT + (SPARK_POINTS - _filled + i) * SPARK_BAR;
+        draw_rect(image, x, y + SPARK_HEIGHT - height, x + SPARK_BAR - 2, y + SPARK_HEIGHT - 1, _colors[series]);
+    }
+}
+
+// 速率格式化为不超过5个字符
+static const char *format_rate(char *buf, uint32_t value)
+{
+    if (value >= 1000 * 1000) {
+        sprintf(buf, "%u.%uM", (unsigned)(value / 1000000), (unsigned)(value / 100000 % 10));
+    } else if (value >= 1000) {
+        sprintf(buf, "%u.%uK", (unsigned)(value / 1000), (unsigned)(value / 100 % 10));
+    } else {
+        sprintf(buf, "%u", (unsigned)value);
+    }
+    return buf;
+}
+
+static const char *format_latency(char *buf, uint32_t us)
+{
+    if (us >= 1000) {
+        sprintf(buf, "%ums", (unsigned)(us / 1000));
+    } else {
+        sprintf(buf, "%uus", (unsigned)us);
+    }
+    return buf;
+}
+
+void update(int slot, lcd_data_frame_t *image)
+{
+    ConnStats::Snapshot now;
+    TcpSender::Stats tx;
+    TcpServer::ClientInfo client;
+    uint32_t time = ConnStats::now();
+    if (slot < 0 || !TcpServer::getClient(slot, client) || !ConnStats::read(slot, now)) {
+        _slot = -1;
+        draw_rect(image, LEFT, TOP, 124, 124, COLOR_BLACK);
+        draw_text(image, 3 * LINE, "  No client");
+        return;
+    }
+    if (!TcpSender::getStats(slot, tx)) {
+        memset(&tx, 0, sizeof(tx));
+    }
+
+    /* 换了客户端时从头采样, 第一次只记录基准 */
+    if (slot != _slot) {
+        _slot = slot;
+        _head = 0;
+        _filled = 0;
+        _last = now;
+        _last_time = time;
+        draw_rect(image, LEFT, TOP, 124, 124, COLOR_BLACK);
+    }
+
+    uint32_t elapsed = time - _last_time;
+    uint32_t rx_rate = 0, tx_rate = 0, rx_fps = 0, tx_fps = 0, p50 = 0, p99 = 0;
+    if (elapsed > 0) {
+        uint32_t hist[ConnStats::LATENCY_BUCKETS];
+        rx_rate = (uint64_t)(now.rx_bytes - _last.rx_bytes) * 1000000 / elapsed;
+        tx_rate = (uint64_t)(now.tx_bytes - _last.tx_bytes) * 1000000 / elapsed;
+        rx_fps = (uint64_t)(now.rx_frames - _last.rx_frames) * 1000000 / elapsed;
+        tx_fps = (uint64_t)(now.tx_frames - _last.tx_frames) * 1000000 / elapsed;
+        for (int i = 0; i < ConnStats::LATENCY_BUCKETS; i++) {
+            hist[i] = now.latency[i] - _last.latency[i];
+        }
+        p50 = ConnStats::percentile(hist, 50);
+        p99 = ConnStats::percentile(hist, 99);
+
+        _history[SERIES_RX][_head] = rx_rate;
+        _history[SERIES_TX][_head] = tx_rate;
+        _history[SERIES_DEPTH][_head] = tx.depth;
+        _history[SERIES_P99][_head] = p99;
+        _head = (_head + 1) % SPARK_POINTS;
+        if (_filled < SPARK_POINTS) _filled++;
+    }
+    _last = now;
+    _last_time = time;
+
+    char rate[8], lat50[8], lat99[8];
+    draw_text(image, 0, "#%d %s", slot + 1, client.name[0] ? client.name : client.ip);
+    draw_text(image, 1 * LINE, "RX %s/s %uf", format_rate(rate, rx_rate), (unsigned)rx_fps);
+    draw_spark(image, 2 * LINE, SERIES_RX);
+    draw_text(image, 2 * LINE + SPARK_HEIGHT + 1, "TX %s/s %uf", format_rate(rate, tx_rate), (unsigned)tx_fps);
+    draw_spark(image, 3 * LINE + SPARK_HEIGHT + 1, SERIES_TX);
+    draw_text(image, 3 * LINE + 2 * (SPARK_HEIGHT + 1), "Q %u hw %u d %u",
+                (unsigned)tx.depth, (unsigned)tx.high_water, (unsigned)tx.drops);
+    draw_spark(image, 4 * LINE + 2 * (SPARK_HEIGHT + 1), SERIES_DEPTH);
+    draw_text(image, 4 * LINE + 3 * (SPARK_HEIGHT + 1), "p50 %s p99 %s",
+                format_latency(lat50, p50), format_latency(lat99, p99));
+    draw_spark(image, 5 * LINE + 3 * (SPARK_HEIGHT + 1), SERIES_P99);
+}
+
+}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include "lcd_st7735.h"
+
+namespace gui {
+namespace dashboard {
+
+/**
+ * 流量仪表页: 单个客户端的收发速率, 发送队列深度与转发延迟,
+ * 每次update()采样一次并追加到火花线.
+*/
+
+// 采样并重画, slot为客户端注册表槽位(-1表示无客户端); 切换槽位时清空历史
+void update(int slot, lcd_data_frame_t *image);
+
+}
+}
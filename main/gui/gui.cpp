@@ -4,17 +4,66 @@
 #include "lcd_st7735.h"
 #include "app_config.h"
 #include "key.h"
+#include "dashboard.h"
+#include "power.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
-#include "esp_heap_caps.h"
 #include <memory.h>
+#include <cstdio>
+#include <cstdarg>
 
 namespace gui {
 
 constexpr static char TAG[] = "gui";
 
+constexpr int EVENT_QUEUE_DEPTH = 8;
+constexpr int ROWS = 6;                     // 内容区行数, 行号1~6
+constexpr int COLS = 15;                    // 每行字符数(x = 3 ~ 123)
+constexpr int STATUS_REFRESH_MS = 1000;     // 状态页与仪表页的刷新周期
+
+enum EventType : uint8_t {
+    EVENT_KEY,
+    EVENT_CLIENT,
+};
+
+struct Event {
+    EventType type;
+    int32_t value;                          // 按键引脚或客户端槽位
+};
+
+enum Page : uint8_t {
+    PAGE_DEVICE,
+    PAGE_CLIENT,
+    PAGE_STATUS,
+    PAGE_DASHBOARD,                         // 流量仪表, 自绘不走页面模型
+};
+
+/* 页面模型: 每行定长文本, 不足部分以空格填充 */
+struct PageModel {
+    char rows[ROWS][COLS + 1];
+};
+
+static QueueHandle_t _events = nullptr;
+
+static void on_key(const button_event_t *key)
+{
+    // 只有上下键按住时连发, 用于快速翻页
+    bool repeat = key->type == BUTTON_REPEAT && (key->key_pin == KEY_UP_PIN || key->key_pin == KEY_DOWN_PIN);
+    if (key->type != BUTTON_PRESS && !repeat) return;
+    Event event = {EVENT_KEY, key->key_pin};
+    xQueueSend(_events, &event, 0);
+}
+
+static void on_client_event(TcpServer::ClientEvent type, int slot)
+{
+    // 队列满时已有待处理的刷新, 丢弃即可
+    Event event = {EVENT_CLIENT, slot};
+    xQueueSend(_events, &event, 0);
+}
+
 /**
  * clear a rectangle window
 */
@@ -36,64 +85,146 @@ static void lcd_clear_row(lcd_data_frame_t *image, uint8_t row)
     lcd_frame_display_data(image);
 }
 
+static void page_clear(PageModel *page)
+{
+    for (int i = 0; i < ROWS; i++) {
+        memset(page->rows[i], ' ', COLS);
+        page->rows[i][COLS] = '\0';
+    }
+}
+
 /**
- * LCD快捷显示字符串
+ * 从第row行开始写入文本, '\n'或超出行宽时转到下一行
 */
-static void lcd_printf_string(lcd_data_frame_t *image,
-                            uint8_t row, char *string)
+static void page_printf(PageModel *page, uint8_t row, const char *fmt, ...)
 {
-    if (string != NULL) {
-        uint8_t len = strlen(string);
-        strcpy((char *)image->data, string);
-        image->data[len] = '\0';
-        image->len = len;
-    } else {
-        image->len = strlen((char *)image->data);
+    char text[ROWS * COLS + ROWS];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    int col = 0;
+    for (const char *p = text; *p && row <= ROWS; p++) {
+        if (*p == '\n' || col >= COLS) {
+            row++;
+            col = 0;
+            if (*p == '\n') continue;
+            if (row > ROWS) break;
+        }
+        page->rows[row - 1][col++] = *p;
     }
-    lcd_clear_row(image, row);
-    image->type = LCD_STRING;
-    image->color = COLOR_GREEN;
-    image->back_color = COLOR_BLACK;
-    image->x = 3;
-    image->y = 24 + 16 * (row - 1);
-    lcd_frame_display_data(image);
 }
 
-void refresh_client_info(lcd_data_frame_t *image, TcpServer::ClientInfo *client, uint8_t index)
+/**
+ * 对比新旧页面, 只重画内容变化的字符段
+*/
+static void page_render(const PageModel *page, PageModel *shown, lcd_data_frame_t *image)
 {
-    sprintf((char *) image->data, "    Page:%d", index + 1);
-    lcd_printf_string(image, 1, NULL);
-
-    sprintf((char *) image->data, "Name:");
-    strcat((char *)image->data, client->name);
-    lcd_printf_string(image, 2, NULL);
+    for (int r = 0; r < ROWS; r++) {
+        int col = 0;
+        while (col < COLS) {
+            if (page->rows[r][col] == shown->rows[r][col]) {
+                col++;
+                continue;
+            }
+            int start = col;
+            while (col < COLS && page->rows[r][col] != shown->rows[r][col]) col++;
 
-    sprintf((char *) image->data, "IP:");
-    strcat((char *)image->data, client->ip);
-    lcd_printf_string(image, 3, NULL);
+            memcpy(image->data, &page->rows[r][start], col - start);
+            image->data[col - start] = '\0';
+            image->len = col - start;
+            image->type = LCD_STRING;
+            image->font = LCD_FONT_8X16;
+            image->color = COLOR_GREEN;
+            image->back_color = COLOR_BLACK;
+            image->x = 3 + 8 * start;
+            image->y = 24 + 16 * r;
+            lcd_frame_display_data(image);
+        }
+        memcpy(shown->rows[r], page->rows[r], COLS);
+    }
+    lcd_flush();
+}
 
-    sprintf((char *)image->data, "Socket: %d",client->socket);
-    lcd_printf_string(image, 4, NULL);
+void refresh_client_info(PageModel *page, TcpServer::ClientInfo *client, uint8_t index)
+{
+    page_printf(page, 1, "    Page:%d", index + 1);
+    page_printf(page, 2, "Name:%s", client->name);
+    page_printf(page, 3, "IP:%s", client->ip);
+    page_printf(page, 4, "Socket: %d", client->socket);
+    page_printf(page, 5, "Port:   %d", client->port);
+    page_printf(page, 6, "Mark:   %d", client->id);
+}
 
-    sprintf((char *)image->data, "Port:   %d", client->port);
-    lcd_printf_string(image, 5, NULL);
+/**
+ * 获取第index个在线客户端, index超出时取最后一个
+*/
+static bool get_client_by_index(uint8_t &index, TcpServer::ClientInfo &client)
+{
+    int found = -1;
+    TcpServer::ClientInfo info;
+    for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+        if (!TcpServer::getClient(i, info)) continue;
+        client = info;
+        if (++found == index) return true;
+    }
+    if (found < 0) return false;
+    index = found;
+    return true;
+}
 
-    sprintf((char *)image->data, "Mark:   %d", client->id);
-    lcd_printf_string(image, 6, NULL);
+static void build_page(PageModel *page, Page current, uint8_t &client_index)
+{
+    page_clear(page);
+    switch (current) {
+        case PAGE_CLIENT: {
+            TcpServer::ClientInfo client;
+            if (!get_client_by_index(client_index, client)) {
+                page_printf(page, 3, "   No client\n  connection");
+                client_index = 0;
+                break;
+            }
+            refresh_client_info(page, &client, client_index);
+            break;
+        }
+        case PAGE_DEVICE: {
+            page_printf(page, 1, "  Device Info");
+            page_printf(page, 3, "SID:%s", AppCfg::SOFTAP_SSID);
+            page_printf(page, 4, "PWD:%s", AppCfg::SOFTAP_PAWD);
+            page_printf(page, 5, "IP:192.168.4.1");
+            page_printf(page, 6, "TCP PORT:%d", AppCfg::SERVER_PORT);
+            break;
+        }
+        case PAGE_STATUS: {
+            page_printf(page, 1, "  sta count:%.1d", TcpServer::clientCount());
+            page_printf(page, 3, "Router SSID:\n%s", Wrapper::WiFi::Store::read_ssid().data());
+            if (Wrapper::WiFi::state() == Wrapper::WiFi::State::CONNECTED) {
+                page_printf(page, 5, "Station IP:\n%s", Wrapper::WiFi::get_ip().data());
+            } else {
+                page_printf(page, 5, "     Router\n    %s", Wrapper::WiFi::stateString(Wrapper::WiFi::state()));
+            }
+            break;
+        }
+        default: break;
+    }
 }
 
+/**
+ * 事件驱动刷新: 按键与客户端上下线/登录事件进入同一队列,
+ * 收到事件后重建页面模型, 与屏幕上的内容对比后只重画变化部分.
+*/
 static void lcd_draw_task(void *arg)
 {
-    static int32_t key = 0;
     uint8_t client_index = 0;
+    Page current = PAGE_DEVICE;
+    Page drawn = PAGE_DEVICE;
+    char text[COLS + 1];
+    static PageModel page, shown;
     lcd_data_frame_t image;
     memset(&image, 0, sizeof(image));
-    
-    image.data = (uint8_t *)heap_caps_malloc(LCD_MAX_SIZE, MALLOC_CAP_DMA);
-    if (image.data == NULL) {
-        ESP_LOGE(TAG, "malloc the image data failed");
-        goto over;
-    }
+    image.data = (uint8_t *)text;
+
     image.type = LCD_CLEAR;
     image.color = COLOR_CYAN;
     lcd_frame_display_data(&image);
@@ -103,111 +234,101 @@ static void lcd_draw_task(void *arg)
     image.back_color = COLOR_CYAN;
     image.x = 12;
     image.y = 0;
-    sprintf((char *)image.data, "SOFTAP_SERVER");
-    image.len = strlen((char *)image.data);
+    sprintf(text, "SOFTAP_SERVER");
+    image.len = strlen(text);
     lcd_frame_display_data(&image);
 
     lcd_clear_row(&image, 0);
+    page_clear(&shown);
+
+    const TickType_t blank_timeout = pdMS_TO_TICKS(AppCfg::LCD_BLANK_TIMEOUT_S * 1000);
+    TickType_t last_key = xTaskGetTickCount();
+    bool blanked = false;
 
-    key = KEY_CONFIRM_PIN;
     while (1) {
+        /* 关屏期间不绘制, 亮屏后按页面模型的差异补画 */
+        if (blanked) {
+            Event event;
+            xQueueReceive(_events, &event, portMAX_DELAY);
+            if (event.type != EVENT_KEY) continue;
+            // 唤醒屏幕的按键不执行操作
+            lcd_set_power(true);
+            Power::setDisplay(true);
+            blanked = false;
+            last_key = xTaskGetTickCount();
+        }
 
-        switch(key) {
+        /* 仪表页与文字页切换时清空内容区, 文字页重新全部绘制 */
+        if ((current == PAGE_DASHBOARD) != (drawn == PAGE_DASHBOARD)) {
+            lcd_clear_row(&image, 0);
+            page_clear(&shown);
+        }
+        drawn = current;
+        if (current == PAGE_DASHBOARD) {
+            TcpServer::ClientInfo client;
+            int slot = -1;
+            if (get_client_by_index(client_index, client)) {
+                slot = TcpServer::findSlotBySocket(client.socket);
+            }
+            dashboard::update(slot, &image);
+            lcd_flush();
+        } else {
+            build_page(&page, current, client_index);
+            page_render(&page, &shown, &image);
+        }
+
+        // 状态页的路由器状态没有事件通知, 仪表页需要周期采样, 定时刷新
+        Event event;
+        bool periodic = current == PAGE_STATUS || current == PAGE_DASHBOARD;
+        TickType_t wait = periodic ? pdMS_TO_TICKS(STATUS_REFRESH_MS) : portMAX_DELAY;
+        if (AppCfg::LCD_BLANK_TIMEOUT_S > 0) {
+            TickType_t idle = xTaskGetTickCount() - last_key;
+            TickType_t remain = idle < blank_timeout ? blank_timeout - idle : 0;
+            if (remain < wait) wait = remain;
+        }
+        if (xQueueReceive(_events, &event, wait) != pdTRUE) {
+            if (AppCfg::LCD_BLANK_TIMEOUT_S > 0 && xTaskGetTickCount() - last_key >= blank_timeout) {
+                lcd_set_power(false);
+                Power::setDisplay(false);
+                blanked = true;
+            }
+            continue;
+        }
+        if (event.type != EVENT_KEY) {
+            continue;
+        }
+        last_key = xTaskGetTickCount();
+
+        switch (event.value) {
+            // 仪表页中上下键切换客户端
             case KEY_UP_PIN: {
-                if (client_index > 0) {
+                if ((current == PAGE_CLIENT || current == PAGE_DASHBOARD) && client_index > 0) {
                     client_index --;
                 }
-                TcpServer::ClientInfo *current = TcpServer::getClientsInfo();
-                if (current == NULL) {
-                    lcd_clear_row(&image, 0);
-                    lcd_printf_string(&image, 3, "   No client\n  connection");
-                    client_index = 0;
-                    break;
-                }
-                for (int i = 0; i < client_index; i ++) {
-                    if (current->next == NULL) {
-                        client_index = i;
-                        break;
-                    }
-                    current = current->next;
-                }
-                refresh_client_info(&image, current, client_index);
-
+                if (current != PAGE_DASHBOARD) current = PAGE_CLIENT;
                 break;
             }
             case KEY_DOWN_PIN: {
-                client_index++;
-                TcpServer::ClientInfo *current = TcpServer::getClientsInfo();
-                if (current == NULL) {
-                    lcd_clear_row(&image, 0);
-                    lcd_printf_string(&image, 3, "   No client\n  connection");
-                    client_index = 0;
-                    break;
-                }
-                for (int i = 0; i < client_index; i ++) {
-                    if (current->next == NULL) {
-                        client_index = i;
-                        break;
-                    }
-                    current = current->next;
-                }
-                refresh_client_info(&image, current, client_index);
-
-                break;
-            }
-            case KEY_CONFIRM_PIN: {
-                lcd_clear_row(&image, 2);
-                lcd_printf_string(&image, 1, "  Device Info");
-
-                sprintf((char *)image.data, "SID:%s",AppCfg::SOFTAP_SSID);
-                lcd_printf_string(&image, 3, NULL);
-                sprintf((char *)image.data, "PWD:%s",AppCfg::SOFTAP_PAWD);
-                lcd_printf_string(&image, 4, NULL);
-
-                sprintf((char *)image.data, "IP:192.168.4.1");
-                lcd_printf_string(&image, 5, NULL);
-                sprintf((char *)image.data, "TCP PORT:%d", AppCfg::SERVER_PORT);
-                lcd_printf_string(&image, 6, NULL);
-                break;
-            }
-            case KEY_CANCEL_PIN: {
-                lcd_clear_row(&image, 0);
-                uint8_t sta_count = 0;
-
-                for (TcpServer::ClientInfo* list = TcpServer::getClientsInfo(); list; list = list->next) {
-                    sta_count++;
+                if (current == PAGE_CLIENT || current == PAGE_DASHBOARD) {
+                    client_index++;
                 }
-                
-                sprintf((char *)image.data, "  sta count:%.1d", sta_count);
-                lcd_printf_string(&image, 1, NULL);
-
-                sprintf((char *)image.data, "Router SSID:\n%s", Wrapper::WiFi::Store::read_ssid().data());
-                lcd_printf_string(&image, 3, NULL);
-
-                if (Wrapper::WiFi::state() == Wrapper::WiFi::State::CONNECTED) {
-                    sprintf((char *)image.data, "Station IP:\n%s", Wrapper::WiFi::get_ip().data());
-                } else {
-                    sprintf((char *)image.data, "     Router\n    %s", Wrapper::WiFi::stateString(Wrapper::WiFi::state()));
-                }
-                lcd_printf_string(&image, 5, NULL);
-                
+                if (current != PAGE_DASHBOARD) current = PAGE_CLIENT;
                 break;
             }
+            case KEY_CONFIRM_PIN: current = PAGE_DEVICE; break;
+            // 状态页再按一次进入仪表页
+            case KEY_CANCEL_PIN:  current = current == PAGE_STATUS ? PAGE_DASHBOARD : PAGE_STATUS; break;
             default : break;
         }
-        
-
-        vTaskDelay(pdMS_TO_TICKS(100));
-
-        button_get_key_value(&key);
     }
-over:
-    vTaskDelete(NULL);
 }
 
 
 void init() {
+    _events = xQueueCreate(EVENT_QUEUE_DEPTH, sizeof(Event));
     my_key_init();
+    button_register_callback(on_key);
+    TcpServer::registerEventCallback(on_client_event);
     lcd_st7735_init();
     xTaskCreate(lcd_draw_task, "lcd_draw_task", 5 * 1024, NULL, 5, NULL);
 }
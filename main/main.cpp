@@ -6,6 +6,10 @@
 #include "tcp_data_handle.h"
 #include "app_config.h"
 #include "gui.h"
+#include "power.h"
+#include "mailbox.h"
+#include "tf_card.h"
+#include "recorder.h"
 
 #include "esp_log.h"
 
@@ -19,10 +23,18 @@ extern "C" void app_main(void) {
 
     Wrapper::Shell::registerCallback(cmds::call);
 
+    Power::init();
+    // 未插卡时离线信箱只用PSRAM
+    tf_card_mount();
+
     // 创建TCP服务器
     TcpServer::init(AppCfg::SERVER_PORT);
     TcpDataHandle::init();
+    Mailbox::init();
+    Recorder::init();
     TcpServer::registerRecvCallback(TcpDataHandle::response);
+    TcpServer::registerCloseCallback(TcpDataHandle::disconnect);
+    TcpServer::registerRejectCallback(TcpDataHandle::rejectFrame);
 
     gui::init();
 }
@@ -1,114 +1,264 @@
 #include "cmds.h"
+#include "cmd_table.h"
 #include "app_config.h"
-#include "utility_wrapper.h"
-#include "json_wrapper.h"
 #include "wifi_wrapper.h"
 #include "tcp_server.h"
+#include "tcp_data_handle.h"
+#include "tcp_sender.h"
+#include "frame_pool.h"
+#include "conn_pool.h"
+#include "metrics.h"
+#include "power.h"
+#include "mailbox.h"
+#include "recorder.h"
 
 #include "esp_log.h"
 #include <cstring>
+#include <cstdlib>
 
 namespace cmds {
 
 constexpr static char TAG[] = "cmds";
 
-#define CMD_ASSERT(condition) do { if (!(condition)) { return Wrapper::Utility::snprint("assert failed, condition '" #condition "'"); } } while (0)
+#define CMD_ASSERT(condition) do { if (!(condition)) { out.printf("assert failed, condition '" #condition "'"); return; } } while (0)
 
-#define CMD_SWITCH(...) \
-CMD_ASSERT(argc >= 1); \
-switch (Wrapper::Utility::BKDR_hash(argv[0])) { \
-	__VA_ARGS__ \
-	default: return Wrapper::Utility::snprint("unknown option '%s'", argv[0]); \
+static void cmd_list(int argc, char* argv[], JsonWriter& out) {
+	// 回应客户端信息列表
+	TcpServer::ClientInfo client;
+	out.array();
+	for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+		if (!TcpServer::getClient(i, client)) continue;
+		out.object()
+			.add("name", client.name)
+			.add("ip", client.ip)
+			.add("port", client.port)
+			.add("sock", client.socket)
+			.add("mark", client.id)
+			.end();
+	}
+	out.end();
 }
 
-#define CMD_CASE_REUSE(name1, name2) \
-case #name1##_hash: { \
-	CMD_ASSERT(argc >= 1); \
-	return cmd_##name2(argc - 1, argv + 1); \
+static void cmd_mark(int argc, char* argv[], JsonWriter& out) {
+	/* 获取目标设备ID */
+	TcpServer::ClientInfo client;
+	if (!TcpServer::getClient(TcpServer::findSlotByName(argv[0]), client)) {
+		client.id = 0;
+	}
+	out.object().add(AppCfg::JSON_KEY_MARK, client.id).end();
 }
 
-#define CMD_CASE_ROOT(name) CMD_CASE_REUSE(name, name)
+static void cmd_wifi(int argc, char* argv[], JsonWriter& out) {
+	/* 设置wifi STA的路由器帐号 */
+	Wrapper::WiFi::State state = Wrapper::WiFi::Apsta::provision(argv[0], argv[1]);
+	out.object().add("status", state == Wrapper::WiFi::State::CONNECTED ? "succeed" : "failed").end();
+}
 
+static void cmd_login(int argc, char* argv[], JsonWriter& out) {
+	ESP_LOGI(TAG, "device info register");
+	// 设备名不含控制字符, list应答的长度才有上界(见AppCfg::CMD_REPLY_MAX)
+	for (const char* p = argv[0]; *p; p++) {
+		CMD_ASSERT((uint8_t)*p >= 0x20);
+	}
+	// 注册记录客户端设备名
+	bool ok = TcpServer::setClientName(TcpDataHandle::commandSource(), argv[0]);
+	out.object().add("status", ok ? "succeed" : "failed").end();
+}
 
-static OBuf cmd_list(int argc, char* argv[]) {
-	// 回应客户端信息列表
-	Wrapper::JsonObject json;
-	json.setArray();
-	for (TcpServer::ClientInfo *list = TcpServer::getClientsInfo(); list; list = list->next) {
-		Wrapper::JsonObject item;
-		item.add("name", list->name);
-		item.add("ip", list->ip);
-		item.add("port", list->port);
-		item.add("sock", list->socket);
-		item.add("mark", list->id);
-		json.addArray(item);
+static void group_subscribe(int argc, char* argv[], JsonWriter& out, bool join) {
+	char *end = nullptr;
+	long group = strtol(argv[0], &end, 10);
+	CMD_ASSERT(*end == '\0' && group >= 0 && group < TcpDataHandle::GROUP_COUNT);
+
+	int sock = TcpDataHandle::commandSource();
+	int res = join ? TcpDataHandle::subscribe(sock, group) : TcpDataHandle::unsubscribe(sock, group);
+	out.object()
+		.add("status", res == 0 ? "succeed" : "failed")
+		.add("groups", (int)TcpDataHandle::subscriptions(sock))
+		.end();
+}
+
+static void cmd_group_join(int argc, char* argv[], JsonWriter& out) {
+	/* 订阅组播组, 组n对应目标ID GROUP_ID_BASE + n */
+	group_subscribe(argc, argv, out, true);
+}
+
+static void cmd_group_leave(int argc, char* argv[], JsonWriter& out) {
+	group_subscribe(argc, argv, out, false);
+}
+
+static void cmd_stats(int argc, char* argv[], JsonWriter& out) {
+	/* 服务器运行统计, 字节/帧为[收, 发], 延迟为[p50, p99]us */
+	uint32_t hist[ConnStats::LATENCY_BUCKETS];
+	out.object()
+		.key("rx").array().value(Metrics::get(Metrics::RX_BYTES)).value(Metrics::get(Metrics::RX_FRAMES)).end()
+		.key("tx").array().value(Metrics::get(Metrics::TX_BYTES)).value(Metrics::get(Metrics::TX_FRAMES)).end()
+		.add("conn", Metrics::get(Metrics::CONNECTS))
+		.add("reject", Metrics::get(Metrics::REJECTS))
+		.add("idle", Metrics::get(Metrics::IDLE_REAPED))
+		.key("drop").object()
+			.add("resync", Metrics::get(Metrics::RESYNC_BYTES))
+			.add("dest", Metrics::get(Metrics::UNKNOWN_DEST))
+			.add("pool", Metrics::get(Metrics::POOL_EXHAUSTED))
+			.add("send", Metrics::get(Metrics::SEND_ERRORS))
+			.add("queue", Metrics::get(Metrics::TX_DROPS))
+			.end()
+		.add("hw", Metrics::get(Metrics::TX_HIGH_WATER))
+		.add("pool", FramePool::available());
+	out.key("slab").array().value(ConnPool::inUse()).value(ConnPool::capacity()).end();
+	/* 各电源状态累计时长[满频, 降频, 关屏]ms, 空闲后首帧[最长耗时us, 超限次数] */
+	Power::Report power;
+	Power::read(power);
+	out.key("power").array().value(power.cpu_max_ms).value(power.cpu_idle_ms).value(power.display_off_ms)
+		.value(power.first_frame_max_us).value(power.first_frame_over).end();
+	/* 离线信箱[存入, 送达, 过期, 丢弃, 转存TF, 待投递] */
+	Mailbox::Stats mbox;
+	Mailbox::read(mbox);
+	out.key("mbox").array()
+		.value(mbox.stored).value(mbox.delivered).value(mbox.expired)
+		.value(mbox.dropped).value(mbox.spilled).value(mbox.pending)
+		.end();
+	/* TF卡抓包[记录数, 丢弃, 写入字节] */
+	Recorder::Stats rec;
+	Recorder::read(rec);
+	out.key("rec").array().value(rec.records).value(rec.drops).value(rec.bytes).end();
+	Metrics::handlerLatency(hist);
+	out.key("cmd").array()
+		.value(ConnStats::percentile(hist, 50))
+		.value(ConnStats::percentile(hist, 99))
+		.end();
+
+	/* 每个客户端一个数组以节省应答长度:
+	   [mark, 收字节, 收帧, 发字节, 发帧, 队列深度, 队列峰值, 丢弃, 阻塞, 转发p50, 转发p99] */
+	out.key("clients").array();
+	TcpServer::ClientInfo client;
+	ConnStats::Snapshot snap;
+	TcpSender::Stats tx;
+	for (int i = 0; i < AppCfg::TCP_MAX_CLIENTS; i++) {
+		if (!TcpServer::getClient(i, client) || !ConnStats::read(i, snap)) continue;
+		if (!TcpSender::getStats(i, tx)) memset(&tx, 0, sizeof(tx));
+		out.array()
+			.value(client.id)
+			.value(snap.rx_bytes).value(snap.rx_frames)
+			.value(snap.tx_bytes).value(snap.tx_frames)
+			.value(tx.depth).value(tx.high_water).value(tx.drops).value(tx.stalls)
+			.value(ConnStats::percentile(snap.latency, 50))
+			.value(ConnStats::percentile(snap.latency, 99))
+			.end();
 	}
-	return Wrapper::Utility::snprint("%s", json.serialize().data());
+	out.end().end();
 }
 
-static OBuf cmd_mark(int argc, char* argv[]) {
-	/* 获取目标设备ID */
-	CMD_ASSERT(argc == 1);
-	Wrapper::JsonObject json;
-	TcpServer::ClientInfo *list = nullptr;
-	for (list = TcpServer::getClientsInfo(); list; list = list->next) {
-		if(strcmp (list->name, argv[0]) == 0) {
-			break;
+static void cmd_record(int argc, char* argv[], JsonWriter& out) {
+	/* TF卡抓包: record on|off, 无参数时只查询状态 */
+	if (argc > 0) {
+		CMD_ASSERT(strcmp(argv[0], "on") == 0 || strcmp(argv[0], "off") == 0);
+		if (argv[0][1] == 'n') {
+			if (Recorder::start() < 0) {
+				out.object().add("status", "failed").add("reason", "no tf card").end();
+				return;
+			}
+		} else {
+			Recorder::stop();
 		}
 	}
-	if (list == nullptr) {
-		json.add(AppCfg::JSON_KEY_MARK, 0);
-	} else {
-		json.add(AppCfg::JSON_KEY_MARK, list->id);
-	}
-	return Wrapper::Utility::snprint("%s", json.serialize().data());
+	Recorder::Stats rec;
+	Recorder::read(rec);
+	out.object()
+		.add("status", "succeed")
+		.add("active", rec.active ? 1 : 0)
+		.add("records", rec.records)
+		.add("drops", rec.drops)
+		.add("bytes", rec.bytes)
+		.end();
 }
 
-static OBuf cmd_wifi(int argc, char* argv[]) {
-	/* 设置wifi STA的路由器帐号 */
-	CMD_ASSERT(argc == 2);
-	Wrapper::JsonObject json;
-	Wrapper::WiFi::State state = Wrapper::WiFi::Apsta::provision(argv[0], argv[1]);
-	if (state == Wrapper::WiFi::State::CONNECTED) {
-		json.add("status", "succeed");
-	} else {
-		json.add("status", "failed");
+/* 命令表: 名称, 处理函数, 最少/最多参数个数, 二进制操作码, 标志 */
+CMD_SET(group_cmds, 2,
+	command("join",  cmd_group_join,  1, 1, OP_GROUP_JOIN),
+	command("leave", cmd_group_leave, 1, 1, OP_GROUP_LEAVE),
+);
+
+CMD_SET(root_cmds, 8,
+	command("login", cmd_login, 1, 1, OP_LOGIN),
+	command("wifi",  cmd_wifi,  2, 2, OP_WIFI, CMD_BLOCKING),
+	command("mark",  cmd_mark,  1, 1, OP_MARK),
+	command("list",  cmd_list,  0, -1, OP_LIST),
+	command("stats", cmd_stats, 0, 0, OP_STATS),
+	command("record", cmd_record, 0, 1, OP_RECORD),
+	group("group", group_cmds),
+);
+
+static constexpr auto _opcodes = opcodes<OP_COUNT>(root_cmds);
+static_assert(_opcodes.unique, "duplicate or out of range command opcode");
+
+const CommandSet& table() {
+	return root_cmds;
+}
+
+static const Command* find(const CommandSet& set, const char* name) {
+	uint32_t h = hash(name);
+	int8_t index = set.slots[bucket(h, set.seed, set.bits)];
+	if (index < 0 || set.cmds[index].hash != h || strcmp(set.cmds[index].name, name) != 0) {
+		return nullptr;
 	}
+	return &set.cmds[index];
+}
 
-	return Wrapper::Utility::snprint("%s", json.serialize().data());
+static void invoke(const Command& cmd, int argc, char* argv[], JsonWriter& out) {
+	if (argc < cmd.min_args || (cmd.max_args >= 0 && argc > cmd.max_args)) {
+		out.printf("'%s' expects %d~%d args, got %d", cmd.name, cmd.min_args, cmd.max_args, argc);
+		return;
+	}
+	cmd.handler(argc, argv, out);
 }
 
-static OBuf cmd_login(int argc, char* argv[]) {
-	ESP_LOGI(TAG, "device info register");
-	CMD_ASSERT(argc == 1);
-	Wrapper::JsonObject json;
-	std::string respond = "failed";
-	TcpServer::ClientInfo *current_client = TcpServer::getClientsInfo();
-    for ( ; current_client; current_client = current_client->next) {
-        if (current_client->socket == TcpServer::getSourceSock()) {
-			// 注册记录客户端设备名
-			strncpy(current_client->name, argv[0], 32);
-			respond = std::string("succeed");
-            break;
-        }
-    }
-	json.add("status", respond.data());
+static void dispatch(const CommandSet& set, int argc, char* argv[], JsonWriter& out) {
+	CMD_ASSERT(argc >= 1);
+	const Command* cmd = find(set, argv[0]);
+	if (cmd == nullptr) {
+		out.printf("unknown option '%s'", argv[0]);
+	} else if (cmd->sub) {
+		dispatch(*cmd->sub, argc - 1, argv + 1, out);
+	} else {
+		invoke(*cmd, argc - 1, argv + 1, out);
+	}
+}
 
-	return Wrapper::Utility::snprint("%s", json.serialize().data());
+bool blocking(int argc, char* argv[]) {
+	const CommandSet* set = &root_cmds;
+	for (int i = 0; i < argc; i++) {
+		const Command* cmd = find(*set, argv[i]);
+		if (cmd == nullptr) return false;
+		if (cmd->sub == nullptr) return cmd->flags & CMD_BLOCKING;
+		set = cmd->sub;
+	}
+	return false;
 }
 
+bool blocking(uint8_t opcode) {
+	return opcode < OP_COUNT && _opcodes.cmds[opcode] != nullptr && (_opcodes.cmds[opcode]->flags & CMD_BLOCKING);
+}
 
-OBuf default_cmd_bundle(int argc, char* argv[]) {
-	CMD_SWITCH(
-		CMD_CASE_ROOT(login);
-		CMD_CASE_ROOT(wifi);
-		CMD_CASE_ROOT(mark);
-		CMD_CASE_ROOT(list);
-	);
+void respond(int argc, char* argv[], JsonWriter& out) {
+	dispatch(root_cmds, argc, argv, out);
+	out.byte('\n');
 }
 
 OBuf call( int argc, char* argv[]) {
-	return default_cmd_bundle(argc, argv) + OBuf(1, '\n');
+	OBuf buf(AppCfg::CMD_REPLY_MAX, 0);
+	JsonWriter out(buf.data(), buf.size());
+	respond(argc, argv, out);
+	buf.resize(out.size());
+	return buf;
+}
+
+void exec(uint8_t opcode, int argc, char* argv[], JsonWriter& out) {
+	if (opcode >= OP_COUNT || _opcodes.cmds[opcode] == nullptr) {
+		out.printf("unknown opcode %d", opcode);
+		return;
+	}
+	invoke(*_opcodes.cmds[opcode], argc, argv, out);
 }
 
 }
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include "json_writer.h"
+
+namespace cmds {
+
+/**
+ * 编译期命令表
+ * 每级命令为一个CommandSet, 命令名哈希混入编译期搜索的种子后直接定位到桶(完美哈希),
+ * 桶冲突或操作码重复在编译期由static_assert报错; 子命令以嵌套CommandSet表示.
+*/
+
+// 处理函数把应答直接写入out
+using Handler = void (*)(int argc, char* argv[], JsonWriter& out);
+
+/* 命令标志 */
+constexpr uint8_t CMD_BLOCKING = 1 << 0;    // 处理函数会长时间阻塞(如连接路由器), 不能在网络任务中执行
+
+struct CommandSet;
+
+struct Command {
+    const char* name;
+    uint32_t hash;
+    Handler handler;            // 叶子命令的处理函数
+    const CommandSet* sub;      // 子命令表, 非空时handler为nullptr
+    int8_t min_args;            // 不含命令名的最少参数个数
+    int8_t max_args;            // 最多参数个数, -1不限
+    uint8_t opcode;             // 二进制命令操作码, 0表示无
+    uint8_t flags;              // CMD_*标志
+};
+
+struct CommandSet {
+    const Command* cmds;
+    const int8_t* slots;        // 桶 -> cmds下标, -1为空
+    uint16_t count;
+    uint8_t seed;               // 编译期搜索得到的无冲突种子
+    uint8_t bits;               // 桶数 = 1 << bits
+};
+
+// BKDR哈希, 编译期与运行期共用
+constexpr uint32_t hash(const char* str) {
+    uint32_t h = 0;
+    while (*str) {
+        h = h * 131 + (uint8_t)*str++;
+    }
+    return h & 0x7FFFFFFF;
+}
+
+// BKDR低位分布差, 混入种子后取乘法哈希的高位作为桶号
+constexpr uint32_t bucket(uint32_t h, uint8_t seed, uint8_t bits) {
+    return ((h ^ seed) * 2654435769u) >> (32 - bits);
+}
+
+constexpr Command command(const char* name, Handler handler, int8_t min_args, int8_t max_args,
+                          uint8_t opcode = 0, uint8_t flags = 0) {
+    return Command{ name, hash(name), handler, nullptr, min_args, max_args, opcode, flags };
+}
+
+constexpr Command group(const char* name, const CommandSet& sub) {
+    return Command{ name, hash(name), nullptr, &sub, 1, -1, 0, 0 };
+}
+
+constexpr uint8_t bucket_bits(size_t n) {
+    uint8_t bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    return bits;
+}
+
+// 搜索使全部命令落入不同桶的种子, 找不到返回-1
+template <size_t BUCKETS, size_t N>
+constexpr int perfect_seed(const Command (&cmds)[N]) {
+    static_assert(BUCKETS >= 2 && (BUCKETS & (BUCKETS - 1)) == 0, "BUCKETS must be a power of 2");
+    static_assert(N <= BUCKETS && N < 128, "too many commands for BUCKETS");
+    for (int seed = 0; seed < 256; seed++) {
+        bool ok = true;
+        for (size_t i = 0; i < N && ok; i++) {
+            for (size_t j = i + 1; j < N && ok; j++) {
+                ok = bucket(cmds[i].hash, seed, bucket_bits(BUCKETS)) != bucket(cmds[j].hash, seed, bucket_bits(BUCKETS));
+            }
+        }
+        if (ok) return seed;
+    }
+    return -1;
+}
+
+template <size_t BUCKETS, size_t N>
+constexpr std::array<int8_t, BUCKETS> slots(const Command (&cmds)[N], uint8_t seed) {
+    std::array<int8_t, BUCKETS> out{};
+    for (size_t i = 0; i < BUCKETS; i++) out[i] = -1;
+    for (size_t i = 0; i < N; i++) out[bucket(cmds[i].hash, seed, bucket_bits(BUCKETS))] = (int8_t)i;
+    return out;
+}
+
+/* 操作码 -> 命令, 遍历整棵命令树生成 */
+template <size_t OPS>
+struct OpcodeMap {
+    const Command* cmds[OPS] = {};
+    bool unique = true;
+};
+
+template <size_t OPS>
+constexpr void opcode_fill(OpcodeMap<OPS>& map, const CommandSet& set) {
+    for (size_t i = 0; i < set.count; i++) {
+        const Command& cmd = set.cmds[i];
+        if (cmd.sub) {
+            opcode_fill(map, *cmd.sub);
+        } else if (cmd.opcode != 0) {
+            if (cmd.opcode >= OPS || map.cmds[cmd.opcode]) {
+                map.unique = false;
+            } else {
+                map.cmds[cmd.opcode] = &cmd;
+            }
+        }
+    }
+}
+
+template <size_t OPS>
+constexpr OpcodeMap<OPS> opcodes(const CommandSet& root) {
+    OpcodeMap<OPS> map;
+    opcode_fill(map, root);
+    return map;
+}
+
+}
+
+/* 定义一级命令表: CMD_SET(名称, 桶数, cmds::command(...), ...), 无冲突种子不存在时编译报错 */
+#define CMD_SET(set, buckets, ...) \
+static constexpr cmds::Command set##_cmds[] = { __VA_ARGS__ }; \
+static constexpr int set##_seed = cmds::perfect_seed<buckets>(set##_cmds); \
+static_assert(set##_seed >= 0, "command hash collision in '" #set "', enlarge buckets"); \
+static constexpr auto set##_slots = cmds::slots<buckets>(set##_cmds, set##_seed); \
+static constexpr cmds::CommandSet set = { set##_cmds, set##_slots.data(), \
+    sizeof(set##_cmds) / sizeof(set##_cmds[0]), set##_seed, cmds::bucket_bits(buckets) }
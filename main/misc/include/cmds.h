@@ -2,9 +2,39 @@
 
 #include <stdint.h>
 #include "bufdef.h"
+#include "json_writer.h"
 
 namespace cmds {
 
+struct CommandSet;
+
+/* 二进制命令操作码 */
+enum Opcode : uint8_t {
+    OP_LOGIN = 1,
+    OP_WIFI,
+    OP_MARK,
+    OP_LIST,
+    OP_GROUP_JOIN,
+    OP_GROUP_LEAVE,
+    OP_STATS,
+    OP_RECORD,
+    OP_COUNT,
+};
+
+// 根命令表, 供遍历检查
+const CommandSet& table();
+
+// Shell回调, 应答拷贝到新申请的OBuf
 OBuf call( int argc, char* argv[]);
 
+// 执行命令行(argv[0]为命令名), 应答以换行结尾写入out
+void respond(int argc, char* argv[], JsonWriter& out);
+
+// 命令是否会长时间阻塞(参数同respond/exec), 网络任务据此把它交给命令任务执行
+bool blocking(int argc, char* argv[]);
+bool blocking(uint8_t opcode);
+
+// 按操作码直接调用命令处理函数, argv不含命令名
+void exec(uint8_t opcode, int argc, char* argv[], JsonWriter& out);
+
 }
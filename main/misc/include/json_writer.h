@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cmds {
+
+/**
+ * 流式JSON写入器
+ * 直接序列化到调用者提供的固定缓冲区(如发送帧的负载区), 不申请堆内存.
+ * 缓冲区写满后置溢出标志, 后续写入全部忽略.
+*/
+class JsonWriter {
+public:
+    static constexpr int MAX_DEPTH = 32;
+
+    JsonWriter(uint8_t* buf, uint32_t capacity) : _buf(buf), _capacity(capacity) { clear(); }
+
+    JsonWriter& object();
+    JsonWriter& array();
+    // 结束最内层的对象或数组
+    JsonWriter& end();
+    JsonWriter& key(const char* name);
+    JsonWriter& value(const char* str);
+    JsonWriter& value(int num);
+    JsonWriter& value(uint32_t num);
+    template <typename T>
+    JsonWriter& add(const char* name, T val) { key(name); return value(val); }
+
+    // 原样写入, 用于非JSON应答(错误提示, 二进制操作码等)
+    JsonWriter& raw(const char* data, uint32_t len);
+    JsonWriter& byte(uint8_t b) { return raw((const char *)&b, 1); }
+    // vsnprintf需要多一字节放结束符, 恰好写满剩余空间时也按溢出处理
+    JsonWriter& printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    // 截断到len字节并清除嵌套状态
+    void clear(uint32_t len = 0);
+    uint32_t size() const { return _len; }
+    bool overflow() const { return _overflow; }
+    const uint8_t* data() const { return _buf; }
+
+private:
+    void begin(char open, bool array);
+    void separator();
+    void put(char c);
+
+    uint8_t* _buf;
+    uint32_t _capacity;
+    uint32_t _len;
+    uint32_t _arrays;       // 每层一位, 1为数组
+    uint32_t _first;        // 每层一位, 1表示该层尚无元素
+    uint8_t  _depth;
+    bool     _after_key;
+    bool     _overflow;
+};
+
+}
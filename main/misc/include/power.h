@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Power {
+
+/* 各状态累计时长(ms), 自启动起 */
+struct Report {
+    uint32_t cpu_max_ms;        // 有转发负载, 锁定最高频率
+    uint32_t cpu_idle_ms;       // 无负载, 由DFS降到最低频率
+    uint32_t display_off_ms;    // 屏幕关闭
+    uint32_t first_frame_max_us;    // 空闲后第一段数据的最长处理耗时
+    uint32_t first_frame_over;      // 超过AppCfg::PM_FIRST_FRAME_MAX_US的次数
+};
+
+int init();
+
+// 收到网络数据时调用(热路径): 未锁定时申请最高频率锁, 并刷新最后活动时刻; 由空闲切到忙时返回true
+bool activity();
+// activity()返回true后, 这段数据处理完时调用: 记录自升频起的耗时并与上限比较
+void firstFrameDone();
+
+// 屏幕开关状态, 由GUI在关屏/亮屏时调用
+void setDisplay(bool on);
+
+void read(Report& out);
+
+}
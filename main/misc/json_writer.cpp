@@ -0,0 +1,138 @@
+#include "json_writer.h"
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <cinttypes>
+
+namespace cmds {
+
+void JsonWriter::clear(uint32_t len) {
+    _len = len < _capacity ? len : _capacity;
+    _arrays = 0;
+    _first = 1;
+    _depth = 0;
+    _after_key = false;
+    _overflow = false;
+}
+
+void JsonWriter::put(char c) {
+    if (_len >= _capacity) {
+        _overflow = true;
+        return;
+    }
+    _buf[_len++] = c;
+}
+
+JsonWriter& JsonWriter::raw(const char* data, uint32_t len) {
+    if (_len + len > _capacity) {
+        _overflow = true;
+        len = _capacity - _len;
+    }
+    memcpy(&_buf[_len], data, len);
+    _len += len;
+    return *this;
+}
+
+JsonWriter& JsonWriter::printf(const char* fmt, ...) {
+    uint32_t space = _capacity - _len;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf((char *)&_buf[_len], space, fmt, args);
+    va_end(args);
+    if (n < 0) return *this;
+    if ((uint32_t)n >= space) {
+        // vsnprintf保留了结束符位置, 缓冲区按写满处理
+        _overflow = true;
+        n = space;
+    }
+    _len += n;
+    return *this;
+}
+
+void JsonWriter::separator() {
+    if (_after_key) {
+        _after_key = false;
+        return;
+    }
+    uint32_t bit = 1u << _depth;
+    if (_first & bit) {
+        _first &= ~bit;
+    } else {
+        put(',');
+    }
+}
+
+void JsonWriter::begin(char open, bool array) {
+    separator();
+    put(open);
+    if (_depth + 1 >= MAX_DEPTH) {
+        _overflow = true;
+        return;
+    }
+    _depth++;
+    uint32_t bit = 1u << _depth;
+    _first |= bit;
+    if (array) {
+        _arrays |= bit;
+    } else {
+        _arrays &= ~bit;
+    }
+}
+
+JsonWriter& JsonWriter::object() {
+    begin('{', false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::array() {
+    begin('[', true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::end() {
+    if (_depth == 0) return *this;
+    put((_arrays & (1u << _depth)) ? ']' : '}');
+    _depth--;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* str) {
+    static const char hex[] = "0123456789abcdef";
+    separator();
+    put('"');
+    for (; *str; str++) {
+        uint8_t c = *str;
+        if (c == '"' || c == '\\') {
+            put('\\');
+            put(c);
+        } else if (c < 0x20) {
+            put('\\'); put('u'); put('0'); put('0');
+            put(hex[c >> 4]);
+            put(hex[c & 0xF]);
+        } else {
+            put(c);
+        }
+    }
+    put('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int num) {
+    separator();
+    return printf("%d", num);
+}
+
+JsonWriter& JsonWriter::value(uint32_t num) {
+    separator();
+    return printf("%" PRIu32, num);
+}
+
+JsonWriter& JsonWriter::key(const char* name) {
+    value(name);
+    put(':');
+    _after_key = true;
+    return *this;
+}
+
+}
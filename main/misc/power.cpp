@@ -0,0 +1,148 @@
+#include "power.h"
+#include "app_config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#include <atomic>
+
+namespace Power {
+
+static const char TAG[] = "power";
+constexpr int CHECK_PERIOD_MS = 50;         // 检查负载是否结束的周期
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t _cpu_lock = nullptr;
+#endif
+static std::atomic<bool> _busy = false;
+static std::atomic<uint32_t> _last_activity = 0;   // ms
+static int64_t _wake_start = 0;             // 由空闲切到忙的时刻, 只由切换的调用者读写
+static std::atomic<uint32_t> _first_frame_max_us = 0;
+static std::atomic<uint32_t> _first_frame_over = 0;
+
+/* 状态时长统计, 只在状态切换与读取时累加 */
+static portMUX_TYPE _stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t _busy_since = 0;
+static int64_t _idle_since = 0;
+static int64_t _display_off_since = -1;
+static uint64_t _busy_us = 0;
+static uint64_t _idle_us = 0;
+static uint64_t _display_off_us = 0;
+
+static uint32_t now_ms() {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void enter_busy(bool busy) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&_stats_lock);
+    if (busy) {
+        _idle_us += now - _idle_since;
+        _busy_since = now;
+    } else {
+        _busy_us += now - _busy_since;
+        _idle_since = now;
+    }
+    portEXIT_CRITICAL(&_stats_lock);
+}
+
+bool activity() {
+    _last_activity.store(now_ms(), std::memory_order_relaxed);
+    // 只有由空闲切到忙的调用者申请锁, 与check_idle()中的释放一一对应
+    if (_busy.load(std::memory_order_relaxed) || _busy.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+    _wake_start = esp_timer_get_time();
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_acquire(_cpu_lock);
+#endif
+    enter_busy(true);
+    return true;
+}
+
+void firstFrameDone() {
+    uint32_t us = (uint32_t)(esp_timer_get_time() - _wake_start);
+    uint32_t max = _first_frame_max_us.load(std::memory_order_relaxed);
+    while (us > max && !_first_frame_max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+    if (us > AppCfg::PM_FIRST_FRAME_MAX_US) {
+        _first_frame_over.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGW(TAG, "first frame after idle took %u us (max %u)", (unsigned)us, (unsigned)AppCfg::PM_FIRST_FRAME_MAX_US);
+    }
+}
+
+/**
+ * 最后一次活动后保持PM_BUSY_HOLD_MS再释放频率锁, 避免帧间隙里频繁切换频率
+*/
+static void check_idle(TimerHandle_t timer) {
+    if (!_busy.load(std::memory_order_relaxed)) return;
+    if (now_ms() - _last_activity.load(std::memory_order_relaxed) < (uint32_t)AppCfg::PM_BUSY_HOLD_MS) return;
+    if (!_busy.exchange(false, std::memory_order_release)) return;
+    enter_busy(false);
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_release(_cpu_lock);
+#endif
+}
+
+void setDisplay(bool on) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&_stats_lock);
+    if (on && _display_off_since >= 0) {
+        _display_off_us += now - _display_off_since;
+        _display_off_since = -1;
+    } else if (!on && _display_off_since < 0) {
+        _display_off_since = now;
+    }
+    portEXIT_CRITICAL(&_stats_lock);
+}
+
+void read(Report& out) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&_stats_lock);
+    uint64_t busy = _busy_us, idle = _idle_us, display_off = _display_off_us;
+    if (_busy.load(std::memory_order_relaxed)) {
+        busy += now - _busy_since;
+    } else {
+        idle += now - _idle_since;
+    }
+    if (_display_off_since >= 0) {
+        display_off += now - _display_off_since;
+    }
+    portEXIT_CRITICAL(&_stats_lock);
+    out.cpu_max_ms = busy / 1000;
+    out.cpu_idle_ms = idle / 1000;
+    out.display_off_ms = display_off / 1000;
+    out.first_frame_max_us = _first_frame_max_us.load(std::memory_order_relaxed);
+    out.first_frame_over = _first_frame_over.load(std::memory_order_relaxed);
+}
+
+int init() {
+    _idle_since = esp_timer_get_time();
+#if CONFIG_PM_ENABLE
+    /* SoftAP运行时不能进入light sleep, 只做动态调频 */
+    esp_pm_config_t config = {
+        .max_freq_mhz = AppCfg::PM_MAX_CPU_FREQ_MHZ,
+        .min_freq_mhz = AppCfg::PM_MIN_CPU_FREQ_MHZ,
+        .light_sleep_enable = false,
+    };
+    if (esp_pm_configure(&config) != ESP_OK
+        || esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "relay", &_cpu_lock) != ESP_OK) {
+        ESP_LOGE(TAG, "power management init failed");
+        return -1;
+    }
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off, CPU stays at %d MHz", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#endif
+    TimerHandle_t timer = xTimerCreate("power", pdMS_TO_TICKS(CHECK_PERIOD_MS), pdTRUE, nullptr, check_idle);
+    if (timer == nullptr || xTimerStart(timer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "power timer create failed");
+        return -1;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""
+SoftAP Server 抓包文件解码工具
+
+解码设备 record 命令写到TF卡的抓包文件(/sdcard/cap/capNNNN.bin), 按时间顺序逐帧输出,
+或给出按帧类型/源/目标的统计. 多个文件按给定顺序拼接, 文件名中的序号即写入顺序.
+
+    python3 tools/capdecode.py cap0003.bin cap0004.bin
+    python3 tools/capdecode.py --summary /media/sd/cap/*.bin
+    python3 tools/capdecode.py --jsonl cap0003.bin > cap.jsonl
+
+文件格式(小端, 见 main/comm/include/recorder.h):
+    文件头  magic "SAPC", u16 版本, u16 snaplen, u64 创建时刻(us)
+    记录    u64 接收时刻(us), u8 源客户端ID, u8 标志, u16 caplen, caplen字节的帧头与截断负载
+"""
+
+import argparse
+import collections
+import json
+import struct
+import sys
+
+MAGIC = b"SAPC"
+VERSION = 1
+FILE_HEADER = struct.Struct("<4sHHQ")
+RECORD = struct.Struct("<QBBH")
+FRAME = struct.Struct("<BBBBI")
+FRAME_HEAD = 0xAA
+
+# RecordFlag
+TRUNCATED, STREAM = 0x01, 0x02
+TYPE_NAMES = {0: "UNKNOWN", 1: "JSON", 2: "BINARY", 3: "CMD", 4: "BCMD", 5: "PING", 6: "PONG"}
+
+Record = collections.namedtuple("Record", "time_us conn flags ftype goal source length payload")
+
+
+def read_file(path):
+    """逐条读出一个抓包文件的记录; 文件尾的不完整记录(掉电或仍在写入)被忽略"""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < FILE_HEADER.size:
+        raise ValueError("%s: too short" % path)
+    magic, version, _snaplen, _start = FILE_HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("%s: not a capture file (magic %r, version %d)" % (path, magic, version))
+    offset = FILE_HEADER.size
+    while offset + RECORD.size <= len(data):
+        time_us, conn, flags, caplen = RECORD.unpack_from(data, offset)
+        offset += RECORD.size
+        if caplen < FRAME.size or offset + caplen > len(data):
+            break
+        head, ftype, goal, source, length = FRAME.unpack_from(data, offset)
+        if head != FRAME_HEAD:
+            raise ValueError("%s: bad frame head at offset %d" % (path, offset))
+        payload = data[offset + FRAME.size:offset + caplen]
+        offset += caplen
+        yield Record(time_us, conn, flags, ftype, goal, source, length, payload)
+
+
+def read_capture(paths):
+    for path in paths:
+        yield from read_file(path)
+
+
+def type_name(ftype):
+    return TYPE_NAMES.get(ftype, str(ftype))
+
+
+def payload_text(record, limit):
+    """CMD/JSON显示为文本, 其余为十六进制"""
+    data = record.payload[:limit]
+    if record.ftype in (1, 3):
+        text = data.decode("utf-8", "replace").rstrip("\n")
+        return json.dumps(text, ensure_ascii=False)
+    return data.hex()
+
+
+def dump(records, args):
+    base = None
+    for r in records:
+        if base is None:
+            base = r.time_us
+        mark = ("T" if r.flags & TRUNCATED else "-") + ("S" if r.flags & STREAM else "-")
+        print("%12.6f %3d -> %3d %-7s len %7d %s %s" % (
+            (r.time_us - base) / 1e6, r.conn, r.goal, type_name(r.ftype), r.length, mark,
+            payload_text(r, args.bytes)))
+
+
+def dump_jsonl(records):
+    for r in records:
+        print(json.dumps({
+            "time_us": r.time_us, "conn": r.conn, "flags": r.flags, "type": r.ftype,
+            "goal": r.goal, "source": r.source, "length": r.length, "payload": r.payload.hex(),
+        }))
+
+
+def summary(records):
+    count = 0
+    total = 0
+    first = last = None
+    by_type = collections.Counter()
+    by_conn = collections.Counter()
+    by_goal = collections.Counter()
+    truncated = streams = 0
+    for r in records:
+        count += 1
+        total += r.length
+        first = r.time_us if first is None else first
+        last = r.time_us
+        by_type[type_name(r.ftype)] += 1
+        by_conn[r.conn] += 1
+        by_goal[r.goal] += 1
+        truncated += bool(r.flags & TRUNCATED)
+        streams += bool(r.flags & STREAM)
+    if count == 0:
+        print("no records")
+        return
+    span = (last - first) / 1e6
+    print("records    %d over %.3f s (%.1f frames/s, %.1f KB/s payload)" % (
+        count, span, count / span if span else 0, total / 1024 / span if span else 0))
+    print("truncated  %d, large streamed %d" % (truncated, streams))
+    print("types      " + ", ".join("%s %d" % kv for kv in by_type.most_common()))
+    print("sources    " + ", ".join("%d: %d" % kv for kv in by_conn.most_common()))
+    print("goals      " + ", ".join("%d: %d" % kv for kv in by_goal.most_common()))
+
+
+def parse_args(argv):
+    parser = argparse.ArgumentParser(description="SoftAP Server capture decoder")
+    parser.add_argument("files", nargs="+", help="抓包文件, 按写入顺序给出")
+    parser.add_argument("--summary", action="store_true", help="只输出统计")
+    parser.add_argument("--jsonl", action="store_true", help="每帧一行JSON输出")
+    parser.add_argument("--bytes", type=int, default=32, help="逐帧输出时显示的负载字节数")
+    return parser.parse_args(argv)
+
+
+def main(argv):
+    args = parse_args(argv)
+    records = read_capture(args.files)
+    try:
+        if args.summary:
+            summary(records)
+        elif args.jsonl:
+            dump_jsonl(records)
+        else:
+            dump(records, args)
+    except ValueError as e:
+        sys.exit(str(e))
+    except BrokenPipeError:
+        pass
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
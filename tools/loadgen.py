@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+"""
+SoftAP Server 压测工具
+
+在主机上模拟 N 个客户端连接设备, 按给定速率与负载长度发送 CMD/JSON/BCMD/BINARY 帧,
+统计吞吐与 p50/p99/p999 延迟, 结束时读取设备端 stats 命令, 给出本轮的丢弃计数与发送队列水位.
+
+    python3 tools/loadgen.py --clients 4 --mode relay --rate 200 --size 512 --duration 10
+
+模式:
+    cmd     文本命令 "list", 测量命令往返延迟
+    json    JSON命令 {"cmd":"list"}, 测量命令往返延迟
+    bcmd    二进制命令 OP_LIST, 测量命令往返延迟
+    relay   BINARY帧发往组播组, 由其余客户端接收, 测量转发延迟
+    storm   按 --rate 每秒新建连接, 发送一条命令后断开, 统计接入/排队/拒绝数与连接到首个应答的延迟
+
+设备按IP末字节分配客户端ID, 同一主机的连接ID相同, 因此转发模式经组播组而非点对点ID.
+"""
+
+import argparse
+import asyncio
+import collections
+import json
+import struct
+import sys
+import time
+
+FRAME_HEAD = 0xAA
+SERVER_ID = 1
+GROUP_ID_BASE = 0xF0
+HEADER = struct.Struct("<BBBBI")
+
+# FrameType
+JSON, BINARY, CMD, BCMD = 1, 2, 3, 4
+# cmds::Opcode
+OP_LIST = 4
+# 转发负载头: 发送时间(ns) + 序号
+STAMP = struct.Struct("<QI")
+
+
+def pack(goal, ftype, payload):
+    return HEADER.pack(FRAME_HEAD, ftype, goal, 0, len(payload)) + payload
+
+
+async def read_frame(reader):
+    head, ftype, _goal, _source, length = HEADER.unpack(await reader.readexactly(HEADER.size))
+    if head != FRAME_HEAD:
+        raise ValueError("bad frame head 0x%02x" % head)
+    return ftype, await reader.readexactly(length)
+
+
+def percentile(samples, pct):
+    """samples须已排序"""
+    if not samples:
+        return 0.0
+    return samples[min(len(samples) - 1, int(len(samples) * pct / 100.0))]
+
+
+class Client:
+    def __init__(self, index, args):
+        self.index = index
+        self.args = args
+        self.reader = None
+        self.writer = None
+        self.sent = 0
+        self.tx_bytes = 0
+        self.received = 0
+        self.rx_bytes = 0
+        self.errors = 0
+        self.latency = []                       # 微秒
+        self.pending = collections.deque()      # 未应答命令的发送时间, 同一连接的应答按序返回
+
+    async def command(self, line):
+        self.writer.write(pack(SERVER_ID, CMD, line.encode()))
+        await self.writer.drain()
+        return (await read_frame(self.reader))[1]
+
+    async def connect(self):
+        self.reader, self.writer = await asyncio.open_connection(self.args.host, self.args.port)
+        await self.command("login loadgen-%d" % self.index)
+        if self.args.mode == "relay":
+            await self.command("group join %d" % self.args.group)
+
+    def request(self):
+        mode = self.args.mode
+        if mode == "cmd":
+            return pack(SERVER_ID, CMD, b"list")
+        if mode == "json":
+            return pack(SERVER_ID, JSON, json.dumps({"cmd": "list"}).encode())
+        if mode == "bcmd":
+            return pack(SERVER_ID, BCMD, bytes([OP_LIST]))
+        stamp = STAMP.pack(time.monotonic_ns(), self.sent)
+        return pack(GROUP_ID_BASE + self.args.group, BINARY, stamp + bytes(max(0, self.args.size - STAMP.size)))
+
+    async def load(self, deadline):
+        receiver = asyncio.ensure_future(self.receive())
+        interval = 1.0 / self.args.rate if self.args.rate > 0 else 0
+        relay = self.args.mode == "relay"
+        next_send = time.monotonic()
+        try:
+            while time.monotonic() < deadline:
+                # 命令模式限制在途请求数, 避免测到的是设备接收缓冲的排队时间
+                if not relay and len(self.pending) >= self.args.window:
+                    await asyncio.sleep(0.0005)
+                    continue
+                frame = self.request()
+                if not relay:
+                    self.pending.append(time.monotonic_ns())
+                self.writer.write(frame)
+                await self.writer.drain()
+                self.sent += 1
+                self.tx_bytes += len(frame)
+                if interval:
+                    next_send = max(next_send + interval, time.monotonic() - interval)
+                    delay = next_send - time.monotonic()
+                    if delay > 0:
+                        await asyncio.sleep(delay)
+            # 收取在途的帧
+            await asyncio.sleep(self.args.drain)
+        except ConnectionError:
+            self.errors += 1
+        finally:
+            receiver.cancel()
+            self.writer.close()
+
+    async def receive(self):
+        relay = self.args.mode == "relay"
+        try:
+            while True:
+                ftype, payload = await read_frame(self.reader)
+                now = time.monotonic_ns()
+                self.received += 1
+                self.rx_bytes += HEADER.size + len(payload)
+                if relay:
+                    if ftype == BINARY and len(payload) >= STAMP.size:
+                        sent_at, _seq = STAMP.unpack_from(payload)
+                        self.latency.append((now - sent_at) / 1000.0)
+                elif self.pending:
+                    self.latency.append((now - self.pending.popleft()) / 1000.0)
+        except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+            self.errors += 1
+
+
+async def device_stats(args):
+    """读取设备端stats计数, 失败时返回None"""
+    try:
+        reader, writer = await asyncio.open_connection(args.host, args.port)
+        writer.write(pack(SERVER_ID, CMD, b"stats"))
+        await writer.drain()
+        _, payload = await asyncio.wait_for(read_frame(reader), 2)
+        writer.close()
+        return json.loads(payload.decode())
+    except (OSError, asyncio.TimeoutError, ValueError):
+        return None
+
+
+def report(args, clients, elapsed, before, after):
+    sent = sum(c.sent for c in clients)
+    received = sum(c.received for c in clients)
+    tx_bytes = sum(c.tx_bytes for c in clients)
+    rx_bytes = sum(c.rx_bytes for c in clients)
+    latency = sorted(v for c in clients for v in c.latency)
+
+    print("mode=%s clients=%d rate=%s size=%d duration=%.1fs"
+          % (args.mode, args.clients, args.rate or "max", args.size, elapsed))
+    print("tx: %d frames %.1f frame/s %.1f KB/s" % (sent, sent / elapsed, tx_bytes / elapsed / 1024))
+    print("rx: %d frames %.1f frame/s %.1f KB/s" % (received, received / elapsed, rx_bytes / elapsed / 1024))
+    if args.mode == "relay":
+        expected = sent * (args.clients - 1)
+        print("delivered: %d/%d (%.2f%%)" % (received, expected, 100.0 * received / expected if expected else 0))
+    print("latency us: p50=%.0f p99=%.0f p999=%.0f max=%.0f"
+          % (percentile(latency, 50), percentile(latency, 99), percentile(latency, 99.9), latency[-1] if latency else 0))
+    print("client errors: %d" % sum(c.errors for c in clients))
+
+    if before is None or after is None:
+        print("device stats unavailable")
+        return
+    # 设备端计数为累计值, 取本轮差值
+    drops = {k: after["drop"][k] - before["drop"].get(k, 0) for k in after["drop"]}
+    print("device drops: " + " ".join("%s=%d" % kv for kv in drops.items()))
+    print("device tx high water: %d, pool free: %d, cmd latency us: p50=%d p99=%d"
+          % (after["hw"], after["pool"], after["cmd"][0], after["cmd"][1]))
+
+
+async def storm_connect(args, index, result):
+    begin = time.monotonic_ns()
+    try:
+        reader, writer = await asyncio.wait_for(asyncio.open_connection(args.host, args.port), args.timeout)
+    except (OSError, asyncio.TimeoutError):
+        result["failed"] += 1
+        return
+    try:
+        writer.write(pack(SERVER_ID, CMD, b"mark storm-%d" % index))
+        await writer.drain()
+        _, payload = await asyncio.wait_for(read_frame(reader), args.timeout)
+        # 服务器已满时回复带reason的应答后关闭
+        result["rejected" if b'"reason"' in payload else "accepted"] += 1
+        result["latency"].append((time.monotonic_ns() - begin) / 1000.0)
+    except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError, ValueError):
+        result["failed"] += 1
+    finally:
+        writer.close()
+
+
+async def storm(args):
+    """连接风暴: 按固定速率新建短连接, 测量服务器的接入能力"""
+    before = await device_stats(args)
+    result = {"accepted": 0, "rejected": 0, "failed": 0, "latency": []}
+    interval = 1.0 / args.rate if args.rate > 0 else 0
+    tasks = []
+    begin = time.monotonic()
+    while time.monotonic() - begin < args.duration:
+        tasks.append(asyncio.ensure_future(storm_connect(args, len(tasks), result)))
+        await asyncio.sleep(max(0, begin + len(tasks) * interval - time.monotonic()))
+    await asyncio.gather(*tasks)
+    elapsed = time.monotonic() - begin
+    after = await device_stats(args)
+
+    latency = sorted(result["latency"])
+    handled = result["accepted"] + result["rejected"]
+    print("mode=storm rate=%s duration=%.1fs" % (args.rate or "max", elapsed))
+    print("connects: %d accepted=%d rejected=%d failed=%d"
+          % (len(tasks), result["accepted"], result["rejected"], result["failed"]))
+    print("handled: %.1f conn/s" % (handled / elapsed))
+    print("connect to reply us: p50=%.0f p99=%.0f p999=%.0f max=%.0f"
+          % (percentile(latency, 50), percentile(latency, 99), percentile(latency, 99.9), latency[-1] if latency else 0))
+    if before is not None and after is not None:
+        print("device connects: %d rejects: %d"
+              % (after["conn"] - before["conn"], after.get("reject", 0) - before.get("reject", 0)))
+
+
+async def run(args):
+    if args.mode == "storm":
+        await storm(args)
+        return
+    before = await device_stats(args)
+    clients = [Client(i, args) for i in range(args.clients)]
+    await asyncio.gather(*(c.connect() for c in clients))
+
+    # 全部客户端登录并加入组后同时开始
+    begin = time.monotonic()
+    await asyncio.gather(*(c.load(begin + args.duration) for c in clients))
+    elapsed = time.monotonic() - begin - args.drain
+
+    report(args, clients, elapsed, before, await device_stats(args))
+
+
+def parse_args(argv):
+    parser = argparse.ArgumentParser(description="SoftAP Server load generator")
+    parser.add_argument("--host", default="192.168.4.1")
+    parser.add_argument("--port", type=int, default=8888)
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--mode", choices=("cmd", "json", "bcmd", "relay", "storm"), default="relay")
+    parser.add_argument("--rate", type=float, default=100, help="每客户端每秒帧数(storm模式为每秒连接数), 0为不限速")
+    parser.add_argument("--size", type=int, default=256, help="relay模式的负载字节数")
+    parser.add_argument("--duration", type=float, default=10)
+    parser.add_argument("--window", type=int, default=4, help="命令模式每连接最多在途请求数")
+    parser.add_argument("--group", type=int, default=0, help="relay模式使用的组播组")
+    parser.add_argument("--timeout", type=float, default=2.0, help="storm模式连接与等待应答的超时秒数")
+    parser.add_argument("--drain", type=float, default=1.0, help="停止发送后等待在途帧的秒数")
+    args = parser.parse_args(argv)
+    if args.size < STAMP.size:
+        parser.error("--size must be at least %d" % STAMP.size)
+    return args
+
+
+if __name__ == "__main__":
+    asyncio.run(run(parse_args(sys.argv[1:])))
@@ -0,0 +1,356 @@
+#!/usr/bin/env python3
+"""
+SoftAP Server 抓包回放工具
+
+把 record 命令录下的抓包文件(见 tools/capdecode.py)回放到设备, 每个录到的源客户端ID对应一个虚拟客户端,
+按原始时间间隔(--speed 1), 按倍速, 或尽快(--speed 0)发出各自的帧, 统计吞吐, 命令往返延迟与转发延迟.
+结果可用 --save 保存, 另一版本固件上用 --compare 回放同一抓包, 输出两次结果的差异.
+
+    python3 tools/replay.py cap0003.bin --speed 0 --save base.json
+    python3 tools/replay.py cap0003.bin --speed 0 --compare base.json
+
+目标映射: 设备按IP末字节分配客户端ID, 同一主机的连接ID相同, 因此发往单个ID的帧默认改发到为该ID分配的
+组播组(抓包中未使用的组), 目标虚拟客户端连接后先加入该组. 主机在AP网段有多个地址时, 用 --bind
+给虚拟客户端绑定不同的源地址, 则各自获得独立ID, 帧按原目标ID点对点转发.
+
+负载: 抓包只保存截断后的负载, 回放时以零补足原长度; 转发帧负载开头写入发送时间, 用于测量转发延迟.
+超过 --max-size 的帧(大帧直通转发)与会改变设备状态的 wifi/record 命令不回放.
+"""
+
+import argparse
+import asyncio
+import collections
+import json
+import struct
+import sys
+import time
+
+from capdecode import read_capture, STREAM
+
+FRAME_HEAD = 0xAA
+SERVER_ID = 1
+GROUP_ID_BASE = 0xF0
+GROUP_COUNT = 15
+BROADCAST_ID = 0xFF
+HEADER = struct.Struct("<BBBBI")
+
+# FrameType
+JSON, BINARY, CMD, BCMD, PING, PONG = 1, 2, 3, 4, 5, 6
+# cmds::Opcode
+OP_WIFI, OP_RECORD = 2, 8
+SKIP_COMMANDS = ("wifi", "record")
+# 转发负载头: 标记 + 发送时间(ns)
+STAMP = struct.Struct("<4sQ")
+STAMP_MAGIC = b"RPLY"
+
+
+def pack(goal, ftype, payload, source=0):
+    return HEADER.pack(FRAME_HEAD, ftype, goal, source, len(payload)) + payload
+
+
+async def read_frame(reader):
+    head, ftype, _goal, source, length = HEADER.unpack(await reader.readexactly(HEADER.size))
+    if head != FRAME_HEAD:
+        raise ValueError("bad frame head 0x%02x" % head)
+    return ftype, source, await reader.readexactly(length)
+
+
+def percentile(samples, pct):
+    """samples须已排序"""
+    if not samples:
+        return 0.0
+    return samples[min(len(samples) - 1, int(len(samples) * pct / 100.0))]
+
+
+def is_multicast(goal):
+    return goal >= GROUP_ID_BASE
+
+
+def skip_command(record):
+    """会改变设备配置或打断抓包的命令"""
+    if record.goal != SERVER_ID:
+        return False
+    if record.ftype == CMD:
+        words = record.payload.split(None, 1)
+        return bool(words) and words[0].decode("utf-8", "replace") in SKIP_COMMANDS
+    if record.ftype == BCMD:
+        return bool(record.payload) and record.payload[0] in (OP_WIFI, OP_RECORD)
+    if record.ftype == JSON:
+        text = record.payload.decode("utf-8", "replace")
+        return any('"%s"' % name in text for name in SKIP_COMMANDS)
+    return False
+
+
+class Client:
+    """一个录到的源/目标客户端ID对应的虚拟客户端"""
+
+    def __init__(self, conn, args):
+        self.conn = conn
+        self.args = args
+        self.local = None                       # --bind 的源地址
+        self.group = None                       # 代收单播帧的组播组
+        self.frames = []                        # (相对时间s, 帧)
+        self.reader = None
+        self.writer = None
+        self.sent = 0
+        self.tx_bytes = 0
+        self.received = 0
+        self.rx_bytes = 0
+        self.errors = 0
+        self.cmd_latency = []                   # 微秒
+        self.relay_latency = []
+        self.pending = collections.deque()      # 未应答命令的发送时间, 同一连接的应答按序返回
+
+    async def connect(self):
+        local = (self.local, 0) if self.local else None
+        self.reader, self.writer = await asyncio.open_connection(self.args.host, self.args.port, local_addr=local)
+        if self.group is not None:
+            self.writer.write(pack(SERVER_ID, CMD, b"group join %d" % self.group))
+            await self.writer.drain()
+            await read_frame(self.reader)
+
+    async def replay(self, begin, speed):
+        try:
+            for offset, goal, ftype, payload in self.frames:
+                if speed > 0:
+                    delay = begin + offset / speed - time.monotonic()
+                    if delay > 0:
+                        await asyncio.sleep(delay)
+                # 限制在途命令数, 避免测到的是设备接收缓冲的排队时间; 超时未应答的命令按错误计
+                while len(self.pending) >= self.args.window:
+                    if time.monotonic_ns() - self.pending[0] > self.args.timeout * 1e9:
+                        self.pending.popleft()
+                        self.errors += 1
+                        continue
+                    await asyncio.sleep(0.0005)
+                now = time.monotonic_ns()
+                if goal == SERVER_ID:
+                    if ftype != PONG:
+                        self.pending.append(now)
+                elif len(payload) >= STAMP.size:
+                    payload = STAMP.pack(STAMP_MAGIC, now) + payload[STAMP.size:]
+                self.writer.write(pack(goal, ftype, payload, self.conn))
+                await self.writer.drain()
+                self.sent += 1
+                self.tx_bytes += HEADER.size + len(payload)
+        except ConnectionError:
+            self.errors += 1
+
+    async def receive(self):
+        try:
+            while True:
+                _ftype, source, payload = await read_frame(self.reader)
+                now = time.monotonic_ns()
+                self.received += 1
+                self.rx_bytes += HEADER.size + len(payload)
+                # 服务器应答的源为SERVER_ID, 转发帧保留发送方填写的源(虚拟客户端ID)
+                if source == SERVER_ID:
+                    if self.pending:
+                        self.cmd_latency.append((now - self.pending.popleft()) / 1000.0)
+                elif len(payload) >= STAMP.size:
+                    magic, sent_at = STAMP.unpack_from(payload)
+                    if magic == STAMP_MAGIC:
+                        self.relay_latency.append((now - sent_at) / 1000.0)
+        except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+            self.errors += 1
+
+
+def build_clients(args):
+    """按录到的源ID拆分帧, 并把单播目标映射到组播组或--bind地址"""
+    clients = {}
+    skipped = collections.Counter()
+    used_groups = set()
+    records = []
+    for record in read_capture(args.files):
+        if record.length > args.max_size:
+            skipped["large" if record.flags & STREAM else "size"] += 1
+            continue
+        if skip_command(record):
+            skipped["command"] += 1
+            continue
+        if is_multicast(record.goal) and record.goal != BROADCAST_ID:
+            used_groups.add(record.goal - GROUP_ID_BASE)
+        elif record.goal == SERVER_ID and record.ftype == CMD:
+            # 录到的 group join N 会原样回放, 该组同样不能再分配
+            words = record.payload.split()
+            if len(words) == 3 and words[:2] == [b"group", b"join"] and words[2].isdigit():
+                used_groups.add(int(words[2]))
+        records.append(record)
+        if args.frames and len(records) >= args.frames:
+            break
+    if not records:
+        sys.exit("no frames to replay")
+
+    def client(conn):
+        if conn not in clients:
+            clients[conn] = Client(conn, args)
+        return clients[conn]
+
+    for record in records:
+        client(record.conn)
+        if record.goal != SERVER_ID and not is_multicast(record.goal):
+            client(record.goal)
+
+    if args.bind:
+        if len(args.bind) < len(clients):
+            sys.exit("--bind needs %d addresses, got %d" % (len(clients), len(args.bind)))
+        goal_of = {}
+        for c, local in zip(clients.values(), args.bind):
+            c.local = local
+            goal_of[c.conn] = int(local.rsplit(".", 1)[1])
+    else:
+        free = [g for g in range(GROUP_COUNT) if g not in used_groups]
+        goal_of = {}
+        for record in records:
+            if record.goal == SERVER_ID or is_multicast(record.goal) or record.goal in goal_of:
+                continue
+            if not free:
+                goal_of[record.goal] = None
+                continue
+            clients[record.goal].group = free.pop(0)
+            goal_of[record.goal] = GROUP_ID_BASE + clients[record.goal].group
+
+    first = records[0].time_us
+    for record in records:
+        goal = record.goal
+        if goal != SERVER_ID and not is_multicast(goal):
+            goal = goal_of[goal]
+            if goal is None:
+                skipped["no group"] += 1
+                continue
+        # 截断的负载以零补足原长度
+        payload = record.payload + bytes(record.length - len(record.payload))
+        clients[record.conn].frames.append(((record.time_us - first) / 1e6, goal, record.ftype, payload))
+    return list(clients.values()), skipped
+
+
+async def device_stats(args):
+    """读取设备端stats计数, 失败时返回None"""
+    try:
+        reader, writer = await asyncio.open_connection(args.host, args.port)
+        writer.write(pack(SERVER_ID, CMD, b"stats"))
+        await writer.drain()
+        _, _, payload = await asyncio.wait_for(read_frame(reader), 2)
+        writer.close()
+        return json.loads(payload.decode())
+    except (OSError, asyncio.TimeoutError, ValueError):
+        return None
+
+
+def summarize(args, clients, elapsed, before, after):
+    cmd = sorted(v for c in clients for v in c.cmd_latency)
+    relay = sorted(v for c in clients for v in c.relay_latency)
+    sent = sum(c.sent for c in clients)
+    received = sum(c.received for c in clients)
+    result = {
+        "speed": args.speed,
+        "clients": len(clients),
+        "elapsed": elapsed,
+        "tx_frames": sent,
+        "tx_fps": sent / elapsed,
+        "tx_kbps": sum(c.tx_bytes for c in clients) / elapsed / 1024,
+        "rx_frames": received,
+        "rx_fps": received / elapsed,
+        "rx_kbps": sum(c.rx_bytes for c in clients) / elapsed / 1024,
+        "cmd_p50": percentile(cmd, 50),
+        "cmd_p99": percentile(cmd, 99),
+        "cmd_p999": percentile(cmd, 99.9),
+        "relay_p50": percentile(relay, 50),
+        "relay_p99": percentile(relay, 99),
+        "relay_p999": percentile(relay, 99.9),
+        "errors": sum(c.errors for c in clients),
+    }
+    if before is not None and after is not None:
+        # 设备端计数为累计值, 取本轮差值
+        for key, value in after["drop"].items():
+            result["drop_" + key] = value - before["drop"].get(key, 0)
+        result["device_hw"] = after["hw"]
+    return result
+
+
+# 数值越小越好的指标, 对比时据此标出变差的项
+LOWER_IS_BETTER = ("cmd_", "relay_", "drop_", "errors", "device_hw", "elapsed")
+
+
+def report(args, result, skipped, baseline):
+    print("replay %s speed=%s clients=%d duration=%.1fs"
+          % (" ".join(args.files), args.speed or "max", result["clients"], result["elapsed"]))
+    if skipped:
+        print("skipped: " + " ".join("%s=%d" % kv for kv in skipped.items()))
+    print("tx: %d frames %.1f frame/s %.1f KB/s" % (result["tx_frames"], result["tx_fps"], result["tx_kbps"]))
+    print("rx: %d frames %.1f frame/s %.1f KB/s" % (result["rx_frames"], result["rx_fps"], result["rx_kbps"]))
+    print("cmd latency us: p50=%.0f p99=%.0f p999=%.0f" % (result["cmd_p50"], result["cmd_p99"], result["cmd_p999"]))
+    print("relay latency us: p50=%.0f p99=%.0f p999=%.0f"
+          % (result["relay_p50"], result["relay_p99"], result["relay_p999"]))
+    drops = {k[5:]: v for k, v in result.items() if k.startswith("drop_")}
+    if drops:
+        print("device drops: " + " ".join("%s=%d" % kv for kv in drops.items()))
+    else:
+        print("device stats unavailable")
+    print("client errors: %d" % result["errors"])
+
+    if baseline is None:
+        return
+    if baseline.get("speed") != result["speed"] or baseline.get("tx_frames") != result["tx_frames"]:
+        print("\nwarning: baseline used speed=%s, %s frames; deltas are not comparable"
+              % (baseline.get("speed"), baseline.get("tx_frames")))
+    print("\n%-12s %12s %12s %9s" % ("metric", "baseline", "current", "delta"))
+    for key, value in result.items():
+        if key not in baseline or key in ("speed", "clients"):
+            continue
+        old = baseline[key]
+        # 变化超过5%且变差的项标*; 基准为0时只比较大小
+        delta = (value - old) / old * 100 if old else (0.0 if value == old else float("inf"))
+        change = value - old
+        worse = change > 0 if key.startswith(LOWER_IS_BETTER) else change < 0
+        print("%-12s %12.1f %12.1f %+8.1f%%%s" % (key, old, value, delta, " *" if worse and abs(delta) >= 5 else ""))
+
+
+async def run(args):
+    clients, skipped = build_clients(args)
+    baseline = None
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+
+    before = await device_stats(args)
+    await asyncio.gather(*(c.connect() for c in clients))
+    # 全部虚拟客户端连接并加入组后同时开始
+    # 只收不发的虚拟客户端(离线目标)也要收到最后一帧, 接收在全部发送结束后统一停止
+    receivers = [asyncio.ensure_future(c.receive()) for c in clients]
+    begin = time.monotonic()
+    await asyncio.gather(*(c.replay(begin, args.speed) for c in clients))
+    elapsed = time.monotonic() - begin
+    # 收取在途的帧
+    await asyncio.sleep(args.drain)
+    for receiver in receivers:
+        receiver.cancel()
+    for c in clients:
+        c.writer.close()
+    result = summarize(args, clients, elapsed, before, await device_stats(args))
+
+    report(args, result, skipped, baseline)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(result, f, indent=1)
+
+
+def parse_args(argv):
+    parser = argparse.ArgumentParser(description="SoftAP Server capture replay")
+    parser.add_argument("files", nargs="+", help="抓包文件, 按写入顺序给出")
+    parser.add_argument("--host", default="192.168.4.1")
+    parser.add_argument("--port", type=int, default=8888)
+    parser.add_argument("--speed", type=float, default=1.0, help="相对原始时间的倍速, 0为尽快发送")
+    parser.add_argument("--frames", type=int, default=0, help="最多回放的帧数, 0为全部")
+    parser.add_argument("--max-size", type=int, default=64 * 1024, help="超过该长度的帧不回放")
+    parser.add_argument("--window", type=int, default=4, help="每个虚拟客户端最多在途命令数")
+    parser.add_argument("--bind", nargs="+", metavar="IP", help="虚拟客户端依次绑定的本机源地址")
+    parser.add_argument("--drain", type=float, default=1.0, help="发送完后等待在途帧的秒数")
+    parser.add_argument("--timeout", type=float, default=2.0, help="命令等待应答的超时秒数")
+    parser.add_argument("--save", help="把本次结果保存为JSON")
+    parser.add_argument("--compare", help="与之前保存的结果对比")
+    return parser.parse_args(argv)
+
+
+if __name__ == "__main__":
+    asyncio.run(run(parse_args(sys.argv[1:])))